@@ -26,6 +26,7 @@
 #include "fixedcapacity.hpp"
 #include "chunkedseq.hpp"
 #include "chunkedbag.hpp"
+#include "chunkalloc.hpp"
 #include "map.hpp"
 
 #ifdef USE_MALLOC_COUNT
@@ -51,6 +52,14 @@ void failwith(std::string s) {
 result_t res = 0;
 double exec_time;
 
+// chunks allocated by the calling thread, for the chunked structures
+void report_chunk_allocs() {
+  data::chunkalloc::counters_type& c = data::chunkalloc::my_counters();
+  printf("chunk_allocs %lld\n", (long long)c.nb_allocs);
+  printf("chunk_reuses %lld\n", (long long)c.nb_reuses);
+  printf("chunk_releases %lld\n", (long long)c.nb_releases);
+}
+
 /*---------------------------------------------------------------------*/
 
 /*
@@ -221,6 +230,7 @@ thunk_t scenario_lifo_with_or_without_pop() {
     // if (SkipPop)
     //  res += d.size();
     exec_time = microtime::seconds_since(start_time);
+    report_chunk_allocs();
   };
 }
 
@@ -258,10 +268,41 @@ thunk_t scenario_fifo() {
       }
     }
     exec_time = microtime::seconds_since(start_time);
+    report_chunk_allocs();
   };
 }
 
 
+/* Moves blocks of items from an array to the back of the sequence and
+ * back, by `pushn_back` and `popn_back`; reports the throughput as the
+ * number of bytes copied in either direction per second.
+ */
+template <class Datastruct>
+thunk_t scenario_bulk() {
+  typedef typename Datastruct::value_type value_type;
+  size_t nb_total = (size_t) cmdline::parse_or_default_int64("n", 100000000);
+  size_t repeat = (size_t) cmdline::parse_or_default_int64("r", 10);
+  size_t block = nb_total / repeat;
+  return [=] {
+    printf("length %lld\n",block);
+    value_type* items = new value_type[block];
+    for (size_t i = 0; i < block; i++)
+      items[i] = value_type(i);
+    uint64_t start_time = microtime::now();
+    Datastruct d;
+    res = 0;
+    for (size_t j = 0; j < repeat; j++) {
+      d.pushn_back(items, block);
+      d.popn_back(items, block);
+      res += items[block / 2].get();
+    }
+    exec_time = microtime::seconds_since(start_time);
+    double nb_bytes = 2.0 * sizeof(value_type) * block * repeat;
+    printf("throughput_gbs %.3lf\n", nb_bytes / exec_time / 1e9);
+    delete [] items;
+  };
+}
+
 // p should be 2 or more
 template <class Datastruct, bool should_push, bool should_pop>
 void _scenario_split_merge(Datastruct* ds, size_t n, size_t p, size_t r, size_t h) {
@@ -328,6 +369,7 @@ thunk_t scenario_split_merge() {
       _scenario_split_merge<Datastruct,true,false>(ds, n, p, r, h);
     else
       _scenario_split_merge<Datastruct,false,false>(ds, n, p, r, h);
+    report_chunk_allocs();
     delete [] ds;
   };
 }
@@ -532,6 +574,7 @@ void dispatch_by_scenario() {
   c.add("fifo", scenario_fifo<Sequence>());
   c.add("lifo", scenario_lifo<Sequence>());
   c.add("fill_back", scenario_fill_back<Sequence>());
+  c.add("bulk", scenario_bulk<Sequence>());
   c.add("split_merge", scenario_split_merge<Sequence>());
   c.add("filter", scenario_filter<Sequence>());
   cmdline::dispatch_by_argmap(c, "scenario");
@@ -542,20 +585,45 @@ void dispatch_by_scenario() {
 
 #include "cachedmeasure.hpp"
 #include "fixedcapacity.hpp"
+#include "fixedcapacitymmap.hpp"
+template <
+  template <
+    class Item,
+    int Chunk_capacity=512,          
+    class Cache = pasl::data::cachedmeasure::trivial<Item, size_t>,
+template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct = pasl::data::fixedcapacity::heap_allocated::ringbuffer_ptr,
+    class Item_alloc=std::allocator<Item>,
+    class Chunk_alloc=pasl::data::chunkalloc::heap >  class SeqStruct,
+  class Item, 
+  template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct,
+  int Chunk_capacity>
+void dispatch_by_chunk_alloc() {
+  using Cache = pasl::data::cachedmeasure::trivial<Item, size_t>;
+  using Item_alloc = std::allocator<Item>;
+  util::cmdline::argmap_dispatch c;
+  c.add("heap", [] { dispatch_by_scenario<SeqStruct<Item,Chunk_capacity,Cache,Chunk_struct,Item_alloc,data::chunkalloc::heap> >(); });
+  #ifndef SKIP_CHUNK_ALLOC
+  c.add("freelist", [] { dispatch_by_scenario<SeqStruct<Item,Chunk_capacity,Cache,Chunk_struct,Item_alloc,data::chunkalloc::freelist<>> >(); });
+  c.add("arena", [] { dispatch_by_scenario<SeqStruct<Item,Chunk_capacity,Cache,Chunk_struct,Item_alloc,data::chunkalloc::arena<>> >(); });
+  #endif
+  util::cmdline::dispatch_by_argmap(c, "chunk_alloc", "heap");
+}
+
 template <
   template <
     class Item,
     int Chunk_capacity=512,          
     class Cache = pasl::data::cachedmeasure::trivial<Item, size_t>,
 template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct = pasl::data::fixedcapacity::heap_allocated::ringbuffer_ptr,
-    class Item_alloc=std::allocator<Item> >  class SeqStruct,
+    class Item_alloc=std::allocator<Item>,
+    class Chunk_alloc=pasl::data::chunkalloc::heap >  class SeqStruct,
   class Item, 
   template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct>
 void dispatch_for_chunkedseq() {
   using Cache = pasl::data::cachedmeasure::trivial<Item, size_t>;
   static constexpr int default_chunksize = 512;
   util::cmdline::argmap_dispatch c;
-  c.add("512",  [] { dispatch_by_scenario<SeqStruct<Item,512,Cache,Chunk_struct> >(); });
+  c.add("512",  [] { dispatch_by_chunk_alloc<SeqStruct,Item,Chunk_struct,512>(); });
   #ifndef SKIP_CHUNKSIZE
   c.add("64",  [] { dispatch_by_scenario<SeqStruct<Item,64,Cache,Chunk_struct> >(); });
   c.add("128",  [] { dispatch_by_scenario<SeqStruct<Item,128,Cache,Chunk_struct> >(); });
@@ -573,30 +641,34 @@ template <class Item,
 int Chunk_capacity=512,
 class Cache=data::cachedmeasure::trivial<Item, size_t>,
 template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
-class Item_alloc=std::allocator<Item> >
-using mystack = chunkedseq::bootstrapped::stack<Item, Chunk_capacity, Cache>;
+class Item_alloc=std::allocator<Item>,
+class Chunk_alloc=data::chunkalloc::heap >
+using mystack = chunkedseq::bootstrapped::stack<Item, Chunk_capacity, Cache, Item_alloc, Chunk_alloc>;
 
 template <class Item,
 int Chunk_capacity=512,
 class Cache=data::cachedmeasure::trivial<Item, size_t>,
 template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
-class Item_alloc=std::allocator<Item> >
-using mybag = chunkedseq::bootstrapped::bagopt<Item, Chunk_capacity, Cache>;
+class Item_alloc=std::allocator<Item>,
+class Chunk_alloc=data::chunkalloc::heap >
+using mybag = chunkedseq::bootstrapped::bagopt<Item, Chunk_capacity, Cache, Item_alloc, Chunk_alloc>;
 
 
 template <class Item,
 int Chunk_capacity=512,
 class Cache=data::cachedmeasure::trivial<Item, size_t>,
 template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
-class Item_alloc=std::allocator<Item> >
-using myfftreestack = chunkedseq::ftree::stack<Item, Chunk_capacity, Cache>;
+class Item_alloc=std::allocator<Item>,
+class Chunk_alloc=data::chunkalloc::heap >
+using myfftreestack = chunkedseq::ftree::stack<Item, Chunk_capacity, Cache, Item_alloc, Chunk_alloc>;
 
 template <class Item,
 int Chunk_capacity=512,
 class Cache=data::cachedmeasure::trivial<Item, size_t>,
 template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
-class Item_alloc=std::allocator<Item> >
-using myfftreebag = chunkedseq::ftree::bagopt<Item, Chunk_capacity, Cache>;
+class Item_alloc=std::allocator<Item>,
+class Chunk_alloc=data::chunkalloc::heap >
+using myfftreebag = chunkedseq::ftree::bagopt<Item, Chunk_capacity, Cache, Item_alloc, Chunk_alloc>;
 
 template <class Item>
 void dispatch_by_sequence() {
@@ -620,6 +692,17 @@ void dispatch_by_sequence() {
       dispatch_for_chunkedseq<chunkedseq::bootstrapped::deque, Item, data::fixedcapacity::heap_allocated::ringbuffer_ptr>();
     });
   #endif
+  #ifndef SKIP_MMAP
+    // chunks in a file-backed mapping, e.g., for sequences larger than the memory
+    c.add("chunkedseq_mmap", [] {
+      std::string path = cmdline::parse_or_default_string("mmap_path", "chunkedseq_mmap.dat");
+      size_t max_szb = (size_t)cmdline::parse_or_default_int64("mmap_max_szb", 1ll << 40);
+      if (! data::mmapstore::the_store().open(path.c_str(), max_szb))
+        failwith("cannot map " + path);
+      dispatch_for_chunkedseq<chunkedseq::bootstrapped::deque, Item, data::fixedcapacity::mmap_allocated::ringbuffer_ptr>();
+      data::mmapstore::the_store().close();
+    });
+  #endif
   #ifndef SKIP_CHUNKEDSEQ_OPT
     c.add("chunkedseq_stack", [] {
       dispatch_for_chunkedseq<mystack, Item, data::fixedcapacity::heap_allocated::stack>();
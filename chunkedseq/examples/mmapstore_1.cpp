@@ -0,0 +1,65 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Example use of the file-backed store of chunked sequences
+ * \file mmapstore_1.cpp
+ * \example mmapstore_1.cpp
+ * \ingroup chunkedseq
+ *
+ */
+
+//! [mmapstore_example]
+#include <iostream>
+#include <assert.h>
+
+#include "chunkedseq.hpp"
+#include "fixedcapacitymmap.hpp"
+
+namespace chunkedseq = pasl::data::chunkedseq;
+namespace fixedcapacity = pasl::data::fixedcapacity;
+namespace mmapstore = pasl::data::mmapstore;
+
+const int chunk_size = 512;
+
+using mydeque_type = chunkedseq::bootstrapped::deque<long, chunk_size,
+                       pasl::data::cachedmeasure::trivial<long, size_t>,
+                       fixedcapacity::mmap_allocated::ringbuffer_ptr>;
+
+int main(int argc, const char * argv[]) {
+
+  const char* path = "mmapstore_1.dat";
+  const long n = 1000000;
+
+  // reserves 1GB of address space; the file grows as chunks are allocated
+  bool ok = mmapstore::the_store().open(path, size_t(1) << 30);
+  assert(ok);
+
+  {
+    mydeque_type mydeque;
+    for (long i = 0; i < n; i++)
+      mydeque.push_back(i);
+    for (long i = 0; i < n / 2; i++)
+      mydeque.pop_front();
+    ok = mmapstore::the_store().persist(mydeque);
+    assert(ok);
+  }
+  mmapstore::the_store().close();
+
+  // the items are read in place, from the pages of the file
+  mmapstore::view<long> myview;
+  ok = myview.open(path);
+  assert(ok);
+  long sum = 0;
+  myview.for_each([&] (long x) { sum += x; });
+  std::cout << "myview contains " << myview.size() << " items" << std::endl;
+  std::cout << "myview[0]=" << myview[0] << std::endl;
+  std::cout << "sum=" << sum << std::endl;
+
+  return 0;
+
+}
+//! [mmapstore_example]
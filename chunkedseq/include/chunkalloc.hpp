@@ -0,0 +1,284 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Allocation policies for the chunks of chunked sequences
+ * \file chunkalloc.hpp
+ *
+ */
+
+#include <assert.h>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifndef _PASL_DATA_CHUNKALLOC_H_
+#define _PASL_DATA_CHUNKALLOC_H_
+
+namespace pasl {
+namespace data {
+namespace chunkalloc {
+
+/***********************************************************************/
+
+/* A chunk-allocation policy provides:
+ *
+ *   template <class Chunk> static Chunk* alloc();
+ *   template <class Chunk> static void free(Chunk* c);
+ *   class deleter;      // Pointer_deleter for the chunks of the middle sequence
+ *   class deep_copier;  // Pointer_deep_copier for the chunks of the middle sequence
+ *
+ * `alloc` returns an empty chunk; `free` takes a chunk that may still
+ * contain items, which are then destroyed.
+ *
+ * A chunk owns a heap-allocated item buffer, which the chunked
+ * sequences exchange between chunks with `chunk::swap`. The pooled
+ * policies therefore recycle each chunk together with whatever buffer
+ * it owns at the time it is freed, so that a reused chunk costs no
+ * allocation at all.
+ */
+
+/*---------------------------------------------------------------------*/
+/* Allocation counters */
+
+//! Counters of the calling thread, summed over all chunk types
+class counters_type {
+public:
+  //! number of chunks built from fresh memory
+  uint64_t nb_allocs;
+  //! number of chunks taken from a freelist
+  uint64_t nb_reuses;
+  //! number of chunks destroyed
+  uint64_t nb_releases;
+};
+
+inline counters_type& my_counters() {
+  static thread_local counters_type counters = { 0, 0, 0 };
+  return counters;
+}
+
+/*---------------------------------------------------------------------*/
+/* Backends */
+
+//! Chunks allocated with `new`
+class system_backend {
+public:
+
+  template <class Chunk>
+  static Chunk* alloc() {
+    return new Chunk();
+  }
+
+  template <class Chunk>
+  static Chunk* copy(const Chunk* x) {
+    return new Chunk(*x);
+  }
+
+  template <class Chunk>
+  static void release(Chunk* c) {
+    delete c;
+  }
+
+};
+
+/*! \brief Chunks carved out of cache-aligned slabs
+ *
+ * Each thread allocates, for each chunk type, slabs of `nb_slots`
+ * slots, each slot being rounded up to a multiple of the cache-line
+ * size, and keeps the slots of released chunks in an intrusive list.
+ * A chunk may be released by another thread than the one that
+ * allocated it. Slabs are never returned to the system.
+ */
+class slab_backend {
+private:
+
+  static constexpr size_t cache_line_szb = 64;
+  static constexpr int nb_slots = 64;
+
+  template <class Chunk>
+  static constexpr size_t slot_szb() {
+    return (sizeof(Chunk) + cache_line_szb - 1) / cache_line_szb * cache_line_szb;
+  }
+
+  class free_slot {
+  public:
+    free_slot* next;
+  };
+
+  template <class Chunk>
+  static free_slot*& my_free_slots() {
+    static thread_local free_slot* free_slots = nullptr;
+    return free_slots;
+  }
+
+  template <class Chunk>
+  static void* alloc_slot() {
+    free_slot*& free_slots = my_free_slots<Chunk>();
+    if (free_slots == nullptr) {
+      void* slab = nullptr;
+      int r = posix_memalign(&slab, cache_line_szb, nb_slots * slot_szb<Chunk>());
+      if (r != 0)
+        throw std::bad_alloc();
+      char* p = (char*)slab;
+      for (int i = nb_slots - 1; i >= 0; i--) {
+        free_slot* s = (free_slot*)(p + i * slot_szb<Chunk>());
+        s->next = free_slots;
+        free_slots = s;
+      }
+    }
+    free_slot* s = free_slots;
+    free_slots = s->next;
+    return s;
+  }
+
+public:
+
+  template <class Chunk>
+  static Chunk* alloc() {
+    return new (alloc_slot<Chunk>()) Chunk();
+  }
+
+  template <class Chunk>
+  static Chunk* copy(const Chunk* x) {
+    return new (alloc_slot<Chunk>()) Chunk(*x);
+  }
+
+  template <class Chunk>
+  static void release(Chunk* c) {
+    c->~Chunk();
+    free_slot*& free_slots = my_free_slots<Chunk>();
+    free_slot* s = (free_slot*)c;
+    s->next = free_slots;
+    free_slots = s;
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Policies */
+
+//! Allocates and destroys a chunk at each request; the default policy
+class heap {
+public:
+
+  template <class Chunk>
+  static Chunk* alloc() {
+    my_counters().nb_allocs++;
+    return system_backend::alloc<Chunk>();
+  }
+
+  template <class Chunk>
+  static void free(Chunk* c) {
+    my_counters().nb_releases++;
+    system_backend::release(c);
+  }
+
+  class deleter {
+  public:
+    static constexpr bool should_use = true;
+    template <class Chunk>
+    static void dealloc(Chunk* x) {
+      free(x);
+    }
+  };
+
+  class deep_copier {
+  public:
+    static constexpr bool should_use = true;
+    template <class Chunk>
+    static Chunk* copy(Chunk* x) {
+      my_counters().nb_allocs++;
+      return system_backend::copy(x);
+    }
+  };
+
+};
+
+/*! \brief Keeps up to `Max_nb` freed chunks of each type per thread
+ *
+ * The freelists are plain thread-local arrays, so that they remain
+ * usable while static objects are being destroyed; the chunks that
+ * are still in the freelist of a thread when it exits are not
+ * reclaimed.
+ */
+template <class Backend, int Max_nb>
+class pooled {
+private:
+
+  template <class Chunk>
+  class freelist_type {
+  public:
+    Chunk* chunks[Max_nb];
+    int nb;
+  };
+
+  template <class Chunk>
+  static freelist_type<Chunk>& my_freelist() {
+    static thread_local freelist_type<Chunk> freelist = { { }, 0 };
+    return freelist;
+  }
+
+public:
+
+  template <class Chunk>
+  static Chunk* alloc() {
+    freelist_type<Chunk>& freelist = my_freelist<Chunk>();
+    if (freelist.nb > 0) {
+      my_counters().nb_reuses++;
+      return freelist.chunks[--freelist.nb];
+    }
+    my_counters().nb_allocs++;
+    return Backend::template alloc<Chunk>();
+  }
+
+  template <class Chunk>
+  static void free(Chunk* c) {
+    freelist_type<Chunk>& freelist = my_freelist<Chunk>();
+    if (freelist.nb < Max_nb) {
+      c->clear();
+      freelist.chunks[freelist.nb++] = c;
+      return;
+    }
+    my_counters().nb_releases++;
+    Backend::release(c);
+  }
+
+  class deleter {
+  public:
+    static constexpr bool should_use = true;
+    template <class Chunk>
+    static void dealloc(Chunk* x) {
+      free(x);
+    }
+  };
+
+  class deep_copier {
+  public:
+    static constexpr bool should_use = true;
+    template <class Chunk>
+    static Chunk* copy(Chunk* x) {
+      my_counters().nb_allocs++;
+      return Backend::copy(x);
+    }
+  };
+
+};
+
+//! Chunks allocated with `new`, recycled through per-thread freelists
+template <int Max_nb = 64>
+using freelist = pooled<system_backend, Max_nb>;
+
+//! Chunks carved out of per-thread slabs, recycled through per-thread freelists
+template <int Max_nb = 64>
+using arena = pooled<slab_backend, Max_nb>;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_DATA_CHUNKALLOC_H_ */
@@ -15,6 +15,7 @@
 
 #include "fixedcapacity.hpp"
 #include "chunk.hpp"
+#include "chunkalloc.hpp"
 #include "cachedmeasure.hpp"
 #include "bootchunkedseq.hpp"
 #include "ftree.hpp"
@@ -55,6 +56,7 @@ protected:
   using chunk_algebra_type = typename chunk_cache_type::algebra_type;
   using chunk_measure_type = typename chunk_cache_type::measure_type;
   using chunk_pointer = chunk_type*;
+  using chunk_alloc_type = typename Configuration::chunk_alloc_type;
   
   using middle_type = typename Configuration::middle_type;
   using middle_cache_type = typename Configuration::middle_cache_type;
@@ -118,13 +120,13 @@ protected:
   /*---------------------------------------------------------------------*/
 
   static inline chunk_pointer chunk_alloc() {
-    return new chunk_type();
-  } 
+    return chunk_alloc_type::template alloc<chunk_type>();
+  }
 
   // only to free empty chunks
   static inline void chunk_free(chunk_pointer c) {
     assert(c->empty());
-    delete c;
+    chunk_alloc_type::free(c);
   }
   
   template <class Pred>
@@ -814,7 +816,8 @@ template <
     class Size_access
   >
   class Middle_sequence = bootchunkedseq::cdeque,
-  class Item_alloc=std::allocator<Item>
+  class Item_alloc=std::allocator<Item>,
+  class Chunk_alloc=chunkalloc::heap
 >
 class basic_bag_configuration {
 public:
@@ -852,6 +855,10 @@ public:
 
 //  using annotation_type = annotation::annotation_builder<annotation::with_measured<middle_measured_type>>;
   using chunk_type = chunk<item_queue_type, chunk_cache_type, annotation_type>;
+
+  using chunk_alloc_type = Chunk_alloc;
+  using chunk_deleter_type = typename chunk_alloc_type::deleter;
+  using chunk_deep_copier_type = typename chunk_alloc_type::deep_copier;
   
   class middle_cache_type {
   public:
@@ -951,11 +958,11 @@ public:
   using chunk_pointer_queue_type = fixedcapacity::heap_allocated::ringbuffer_ptr<chunk_type*, middle_capacity>;
   using middle_annotation_type = annotation::annotation_builder<>;
   using middle_type = chunk<chunk_pointer_queue_type, middle_cache_type,
-                            middle_annotation_type, Pointer_deleter, Pointer_deep_copier, size_access>;
+                            middle_annotation_type, chunk_deleter_type, chunk_deep_copier_type, size_access>;
 #else
   static constexpr int middle_chunk_capacity = 32;
   using middle_type = Middle_sequence<chunk_type, middle_chunk_capacity, middle_cache_type,
-      Pointer_deleter, Pointer_deep_copier, fixedcapacity::heap_allocated::ringbuffer_ptr, size_access>;
+      chunk_deleter_type, chunk_deep_copier_type, fixedcapacity::heap_allocated::ringbuffer_ptr, size_access>;
 #endif
 
   using chunk_search_type = itemsearch::search_in_chunk<chunk_type, middle_algebra_type, size_access>;
@@ -972,8 +979,9 @@ namespace bootstrapped {
 template <class Item,
           int Chunk_capacity = 512,
           class Cache = cachedmeasure::trivial<Item, size_t>,
-          class Item_alloc = std::allocator<Item>>
-using bagopt = chunkedbagbase<basic_bag_configuration<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, bootchunkedseq::cdeque, Item_alloc>>;
+          class Item_alloc = std::allocator<Item>,
+          class Chunk_alloc = chunkalloc::heap>
+using bagopt = chunkedbagbase<basic_bag_configuration<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, bootchunkedseq::cdeque, Item_alloc, Chunk_alloc>>;
   
 } // end namespace
 
@@ -986,8 +994,9 @@ template <
   class Item,
   int Chunk_capacity = 512,
   class Cache = cachedmeasure::trivial<Item, size_t>,
-  class Item_alloc = std::allocator<Item>>
-using bagopt = chunkedbagbase<basic_bag_configuration<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, ::pasl::data::ftree::tftree, Item_alloc>>;
+  class Item_alloc = std::allocator<Item>,
+  class Chunk_alloc = chunkalloc::heap>
+using bagopt = chunkedbagbase<basic_bag_configuration<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, ::pasl::data::ftree::tftree, Item_alloc, Chunk_alloc>>;
   
 } // end namespace
 
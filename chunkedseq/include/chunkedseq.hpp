@@ -14,6 +14,7 @@
 
 #include "fixedcapacity.hpp"
 #include "chunk.hpp"
+#include "chunkalloc.hpp"
 #include "cachedmeasure.hpp"
 #include "chunkedseqbase.hpp"
 #include "bootchunkedseq.hpp"
@@ -58,7 +59,8 @@ template <
     class Size_access
   >
   class Middle_sequence = bootchunkedseq::cdeque,
-  class Item_alloc = std::allocator<Item>
+  class Item_alloc = std::allocator<Item>,
+  class Chunk_alloc = chunkalloc::heap
 >
 class basic_deque_configuration {
 public:
@@ -97,6 +99,10 @@ public:
   using annotation_type = annotation::annotation_builder<cached_prefix_type, parent_pointer_type>;
   using chunk_type = chunk<item_queue_type, chunk_cache_type, annotation_type>;
 
+  using chunk_alloc_type = Chunk_alloc;
+  using chunk_deleter_type = typename chunk_alloc_type::deleter;
+  using chunk_deep_copier_type = typename chunk_alloc_type::deep_copier;
+
   class middle_cache_type {
   public:
 
@@ -195,11 +201,11 @@ public:
   using chunk_pointer_queue_type = fixedcapacity::heap_allocated::ringbuffer_ptr<chunk_type*, middle_capacity>;
   using middle_annotation_type = annotation::annotation_builder<>;
   using middle_type = chunk<chunk_pointer_queue_type, middle_cache_type,
-                            middle_annotation_type, Pointer_deleter, Pointer_deep_copier, size_access>;
+                            middle_annotation_type, chunk_deleter_type, chunk_deep_copier_type, size_access>;
 #else
   static constexpr int middle_chunk_capacity = 32; // 32 64 128;
   using middle_type = Middle_sequence<chunk_type, middle_chunk_capacity, middle_cache_type,
-  Pointer_deleter, Pointer_deep_copier, fixedcapacity::heap_allocated::ringbuffer_ptr, size_access>;
+  chunk_deleter_type, chunk_deep_copier_type, fixedcapacity::heap_allocated::ringbuffer_ptr, size_access>;
 #endif
 
   using chunk_search_type = itemsearch::search_in_chunk<chunk_type, middle_algebra_type, size_access>;
@@ -223,9 +229,10 @@ template <
     class Chunk_item_alloc = std::allocator<Item>
   >
   class Chunk_struct = fixedcapacity::heap_allocated::ringbuffer_ptrx,
-  class Item_alloc = std::allocator<Item>
+  class Item_alloc = std::allocator<Item>,
+  class Chunk_alloc = chunkalloc::heap
 >
-using deque = chunkedseqbase<basic_deque_configuration<Item, Chunk_capacity, Cache, Chunk_struct, bootchunkedseq::cdeque, Item_alloc>>;
+using deque = chunkedseqbase<basic_deque_configuration<Item, Chunk_capacity, Cache, Chunk_struct, bootchunkedseq::cdeque, Item_alloc, Chunk_alloc>>;
 
 // Application of chunked stack to a configuration
 
@@ -233,9 +240,10 @@ template <
   class Item,
   int Chunk_capacity = 512,
   class Cache = cachedmeasure::trivial<Item, size_t>,
-  class Item_alloc = std::allocator<Item>
+  class Item_alloc = std::allocator<Item>,
+  class Chunk_alloc = chunkalloc::heap
 >
-using stack = deque<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, Item_alloc>;
+using stack = deque<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, Item_alloc, Chunk_alloc>;
 
 } // end namespace bootstrapped
 
@@ -256,9 +264,10 @@ template <
     class Chunk_item_alloc = std::allocator<Item>
   >
   class Chunk_struct = fixedcapacity::heap_allocated::ringbuffer_ptrx,
-  class Item_alloc = std::allocator<Item>
+  class Item_alloc = std::allocator<Item>,
+  class Chunk_alloc = chunkalloc::heap
 >
-using deque = chunkedseqbase<basic_deque_configuration<Item, Chunk_capacity, Cache, Chunk_struct, ::pasl::data::ftree::tftree, Item_alloc>>;
+using deque = chunkedseqbase<basic_deque_configuration<Item, Chunk_capacity, Cache, Chunk_struct, ::pasl::data::ftree::tftree, Item_alloc, Chunk_alloc>>;
 
 
 // Application of chunked finger tree to a configuration
@@ -267,9 +276,10 @@ template <
   class Item,
   int Chunk_capacity = 512,
   class Cache = cachedmeasure::trivial<Item, size_t>,
-  class Item_alloc = std::allocator<Item>
+  class Item_alloc = std::allocator<Item>,
+  class Chunk_alloc = chunkalloc::heap
 >
-using stack = deque<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, Item_alloc>;
+using stack = deque<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, Item_alloc, Chunk_alloc>;
 
 } // end namespace ftree
 
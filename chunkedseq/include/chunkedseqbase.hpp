@@ -66,6 +66,7 @@ protected:
   using chunk_algebra_type = typename chunk_cache_type::algebra_type;
   using chunk_measure_type = typename chunk_cache_type::measure_type;
   using chunk_pointer = chunk_type*;
+  using chunk_alloc_type = typename Configuration::chunk_alloc_type;
 
   using middle_type = typename Configuration::middle_type;
   using middle_cache_type = typename Configuration::middle_cache_type;
@@ -132,13 +133,13 @@ private:
   /*---------------------------------------------------------------------*/
 
   static inline chunk_pointer chunk_alloc() {
-    return new chunk_type();
+    return chunk_alloc_type::template alloc<chunk_type>();
   }
 
   // only to free empty chunks
   static inline void chunk_free(chunk_pointer c) {
     assert(c->empty());
-    delete c;
+    chunk_alloc_type::free(c);
   }
 
   template <class Pred>
@@ -182,11 +182,16 @@ void frontn(const Container& c, value_type* dst, size_type nb) {
   c.stream_frontn(cons, nb);
 }
   
+/* The items of `src` are copied one chunk at a time; the items of the
+ * next chunk are prefetched before the current ones are copied.
+ */
 template <class Container, class const_pointer, class size_type>
 void pushn_back(Container& c, const_pointer src, size_type nb) {
-  auto prod = [src] (size_type i, size_type nb) {
+  using allocator_type = typename Container::allocator_type;
+  auto prod = [src, nb] (size_type i, size_type m) {
     const_pointer lo = src + i;
-    const_pointer hi = lo + nb;
+    const_pointer hi = lo + m;
+    fixedcapacity::base::prefetch<allocator_type>(hi, std::min(m, nb - i - m));
     return std::make_pair(lo, hi);
   };
   c.stream_pushn_back(prod, nb);
@@ -194,9 +199,12 @@ void pushn_back(Container& c, const_pointer src, size_type nb) {
   
 template <class Container, class const_pointer, class size_type>
 void pushn_front(Container& c, const_pointer src, size_type nb) {
-  auto prod = [src] (size_type i, size_type nb) {
+  using allocator_type = typename Container::allocator_type;
+  auto prod = [src, nb] (size_type i, size_type m) {
     const_pointer lo = src + i;
-    const_pointer hi = lo + nb;
+    const_pointer hi = lo + m;
+    size_type next = std::min(m, i);
+    fixedcapacity::base::prefetch<allocator_type>(lo - next, next);
     return std::make_pair(lo, hi);
   };
   c.stream_pushn_front(prod, nb);
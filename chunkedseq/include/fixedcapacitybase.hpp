@@ -133,6 +133,24 @@ void copy(typename Alloc::pointer destination,
   std::copy(source, source+num, destination);
 }
 
+/*! \brief Requests the cache lines of `num` items starting at `source`
+ *
+ * Meant to be issued for the next block of items to be copied, before
+ * copying the current one; at most `prefetch_szb` bytes are requested.
+ */
+static constexpr size_t prefetch_szb = 4096;
+
+template <class Alloc>
+void prefetch(typename Alloc::const_pointer source,
+              typename Alloc::size_type num) {
+  using value_type = typename Alloc::value_type;
+  static constexpr size_t cache_line_szb = 64;
+  const char* p = (const char*)source;
+  size_t nb_bytes = std::min(prefetch_szb, sizeof(value_type) * size_t(num));
+  for (size_t k = 0; k < nb_bytes; k += cache_line_szb)
+    __builtin_prefetch(p + k, 0);
+}
+
 template <class Alloc>
 void pblit(typename Alloc::const_pointer t1, int i1,
            typename Alloc::pointer t2, int i2,
@@ -0,0 +1,50 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Fixed capacity vectors whose items live in the file-backed store
+ * \file fixedcapacitymmap.hpp
+ *
+ */
+
+#include "fixedcapacitybase.hpp"
+#include "mmapstore.hpp"
+
+#ifndef _PASL_DATA_FIXEDCAPACITYMMAP_H_
+#define _PASL_DATA_FIXEDCAPACITYMMAP_H_
+
+namespace pasl {
+namespace data {
+namespace fixedcapacity {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/* Fixed-capacity buffers allocated in the file-backed store */
+
+namespace mmap_allocated {
+
+  template <class Item, int Capacity, class Alloc = std::allocator<Item>>
+  using ringbuffer_ptr = base::ringbuffer_ptr<mmapstore::mmap_allocator<Item, Capacity+1>>;
+
+  template <class Item, int Capacity, class Alloc = std::allocator<Item>>
+  using ringbuffer_ptrx = base::ringbuffer_ptrx<mmapstore::mmap_allocator<Item, Capacity+1>>;
+
+  template <class Item, int Capacity, class Alloc = std::allocator<Item>>
+  using ringbuffer_idx = base::ringbuffer_idx<mmapstore::mmap_allocator<Item, Capacity>>;
+
+  template <class Item, int Capacity, class Alloc = std::allocator<Item>>
+  using stack = base::stack<mmapstore::mmap_allocator<Item, Capacity>>;
+
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_DATA_FIXEDCAPACITYMMAP_H_ */
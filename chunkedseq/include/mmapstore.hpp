@@ -0,0 +1,468 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief File-backed storage for the item buffers of chunked sequences
+ * \file mmapstore.hpp
+ *
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <cstring>
+#include <new>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef _PASL_DATA_MMAPSTORE_H_
+#define _PASL_DATA_MMAPSTORE_H_
+
+namespace pasl {
+namespace data {
+namespace mmapstore {
+
+/***********************************************************************/
+
+/* The store maps a file into a region of virtual memory that is
+ * reserved once and for all, at a fixed address, so that the item
+ * buffers that it hands out never move; the file grows as buffers are
+ * allocated, and the operating system pages the buffers in and out of
+ * memory as it does for any shared file mapping. Items placed in the
+ * store are therefore limited by the size of the file system rather
+ * than by the size of the memory.
+ *
+ * Every chunk of a chunked sequence whose `Chunk_struct` is one of the
+ * `fixedcapacity::mmap_allocated` buffers, declared in
+ * `fixedcapacitymmap.hpp`, takes its items from the
+ * store of the process, which must be opened before the first such
+ * chunk is created, and closed after the last one is destroyed.
+ *
+ * `persist(c)` writes to the file an index of the segments of the
+ * container `c`, as offsets in the file; a `view` then reopens the
+ * file read only and accesses the items of `c` in place, without
+ * copying them. Only containers of trivially-copyable items can be
+ * persisted.
+ *
+ * File layout: a header of `header_szb` bytes, followed by the item
+ * buffers, followed by the segment index written by the last call
+ * to `persist`.
+ */
+
+static constexpr uint64_t file_magic = 0x5041534c4d4d4150ull; // "PASLMMAP"
+
+//! Bytes reserved at the start of the file for the header
+static constexpr size_t header_szb = 4096;
+
+//! Alignment of the item buffers in the file
+static constexpr size_t buffer_alignment = 64;
+
+class file_header {
+public:
+  uint64_t magic;
+  //! `sizeof` of the items of the persisted container
+  uint64_t item_szb;
+  uint64_t nb_items;
+  //! position in the file of the first entry of the segment index
+  uint64_t index_offset;
+  uint64_t nb_segments;
+};
+
+//! Entry of the segment index
+class segment_entry {
+public:
+  //! position in the file of the first item of the segment
+  uint64_t offset;
+  //! number of items in the segment
+  uint64_t nb;
+};
+
+/*---------------------------------------------------------------------*/
+/* Store */
+
+class store {
+private:
+
+  std::mutex lock;
+  int fd = -1;
+  char* base = nullptr;
+  //! size of the reserved region
+  size_t max_szb = 0;
+  //! current size of the file
+  size_t file_szb = 0;
+  //! end of the allocated part of the file
+  size_t bump = 0;
+  //! positions of the released buffers, by size
+  std::unordered_map<size_t, std::vector<size_t>> free_buffers;
+
+  static constexpr size_t min_growth_szb = size_t(1) << 26;
+
+  static size_t align(size_t n) {
+    return (n + buffer_alignment - 1) / buffer_alignment * buffer_alignment;
+  }
+
+  // requires the lock
+  bool ensure_file_szb(size_t szb) {
+    if (szb <= file_szb)
+      return true;
+    if (szb > max_szb)
+      return false;
+    size_t new_szb = std::min(max_szb, std::max(szb, file_szb + min_growth_szb));
+    if (ftruncate(fd, (off_t)new_szb) != 0)
+      return false;
+    file_szb = new_szb;
+    return true;
+  }
+
+  // requires the lock
+  char* bump_alloc(size_t szb) {
+    size_t offset = bump;
+    if (! ensure_file_szb(offset + szb))
+      return nullptr;
+    bump = offset + szb;
+    return base + offset;
+  }
+
+public:
+
+  store() { }
+
+  store(const store&) = delete;
+  store& operator=(const store&) = delete;
+
+  bool is_open() const {
+    return base != nullptr;
+  }
+
+  /*! \brief Creates the file at `path`, or truncates it, and reserves
+   *  `max_szb` bytes of address space for it; returns false on failure.
+   */
+  bool open(const char* path, size_t max_szb) {
+    std::unique_lock<std::mutex> l(lock);
+    assert(! is_open());
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return false;
+    void* p = mmap(nullptr, max_szb, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      fd = -1;
+      return false;
+    }
+    base = (char*)p;
+    this->max_szb = max_szb;
+    file_szb = 0;
+    bump = header_szb;
+    if (! ensure_file_szb(header_szb)) {
+      l.unlock();
+      close();
+      return false;
+    }
+    file_header* h = (file_header*)base;
+    h->magic = file_magic;
+    h->item_szb = 0;
+    h->nb_items = 0;
+    h->index_offset = 0;
+    h->nb_segments = 0;
+    return true;
+  }
+
+  //! Unmaps the file, after trimming it to its used part
+  void close() {
+    std::unique_lock<std::mutex> l(lock);
+    if (! is_open())
+      return;
+    munmap(base, max_szb);
+    // on failure, the file keeps its unused tail
+    int r = ftruncate(fd, (off_t)bump);
+    (void)r;
+    ::close(fd);
+    fd = -1;
+    base = nullptr;
+    free_buffers.clear();
+  }
+
+  //! Returns a buffer of `szb` bytes; throws `std::bad_alloc` if the store is full
+  void* alloc(size_t szb) {
+    szb = align(szb);
+    std::unique_lock<std::mutex> l(lock);
+    if (! is_open())
+      throw std::bad_alloc();
+    std::vector<size_t>& fl = free_buffers[szb];
+    if (! fl.empty()) {
+      size_t offset = fl.back();
+      fl.pop_back();
+      return base + offset;
+    }
+    char* p = bump_alloc(szb);
+    if (p == nullptr)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  void free(void* p, size_t szb) {
+    szb = align(szb);
+    std::unique_lock<std::mutex> l(lock);
+    if (! is_open())
+      return;
+    assert((char*)p >= base + header_szb && (char*)p < base + bump);
+    free_buffers[szb].push_back(size_t((char*)p - base));
+  }
+
+  /*! \brief Records in the file the segments of `c`, whose item buffers
+   *  must all be in the store, and writes the file back to disk.
+   *
+   * The index of a previous call is superseded, but its space is not
+   * reclaimed. Returns false on failure.
+   */
+  template <class Container>
+  bool persist(const Container& c) {
+    using value_type = typename Container::value_type;
+    static_assert(std::is_trivially_copyable<value_type>::value,
+                  "only trivially-copyable items can be persisted");
+    std::vector<segment_entry> entries;
+    uint64_t nb_items = 0;
+    c.for_each_segment([&] (const value_type* lo, const value_type* hi) {
+      if (lo == hi)
+        return;
+      assert((const char*)lo >= base + header_szb && (const char*)hi <= base + bump);
+      segment_entry e;
+      e.offset = uint64_t((const char*)lo - base);
+      e.nb = uint64_t(hi - lo);
+      entries.push_back(e);
+      nb_items += e.nb;
+    });
+    std::unique_lock<std::mutex> l(lock);
+    if (! is_open())
+      return false;
+    size_t index_szb = std::max(size_t(1), entries.size()) * sizeof(segment_entry);
+    char* index = bump_alloc(align(index_szb));
+    if (index == nullptr)
+      return false;
+    memcpy(index, entries.data(), entries.size() * sizeof(segment_entry));
+    file_header* h = (file_header*)base;
+    h->item_szb = sizeof(value_type);
+    h->nb_items = nb_items;
+    h->index_offset = uint64_t(index - base);
+    h->nb_segments = entries.size();
+    return msync(base, bump, MS_SYNC) == 0;
+  }
+
+};
+
+//! The store of the process
+static inline store& the_store() {
+  static store s;
+  return s;
+}
+
+/*---------------------------------------------------------------------*/
+/* Array allocation */
+
+/*! \brief Allocator of item arrays in the store of the process
+ *
+ * Implements the same interface as `fixedcapacity::base::heap_allocator`.
+ */
+template <class Item, int Capacity>
+class mmap_allocator {
+private:
+
+  Item* items;
+
+  // to disable copying
+  mmap_allocator(const mmap_allocator& other);
+  mmap_allocator& operator=(const mmap_allocator& other);
+
+public:
+
+  using value_type = Item;
+  using self_type = mmap_allocator<Item, Capacity>;
+
+  static constexpr int capacity = Capacity;
+  static constexpr size_t buffer_szb = sizeof(value_type) * capacity;
+
+  mmap_allocator() {
+    items = (value_type*)the_store().alloc(buffer_szb);
+  }
+
+  mmap_allocator(self_type&& x)
+  : items(x.items) {
+    x.items = nullptr;
+  }
+
+  self_type& operator=(self_type&& a) {
+    std::swap(items, a.items);
+    return *this;
+  }
+
+  ~mmap_allocator() {
+    if (items != nullptr)
+      the_store().free(items, buffer_szb);
+  }
+
+  value_type& operator[](int i) const {
+    assert(items != nullptr);
+    assert(i >= 0);
+    return items[i];
+  }
+
+  void swap(mmap_allocator& other) {
+    std::swap(items, other.items);
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Read-only view of a persisted container */
+
+template <class Item>
+class view {
+private:
+
+  int fd = -1;
+  const char* base = nullptr;
+  size_t file_szb = 0;
+  const segment_entry* segments = nullptr;
+  size_t nb_segments = 0;
+  //! `offsets[s]` is the number of items in the segments before `s`
+  std::vector<uint64_t> offsets;
+
+  const Item* segment_begin(size_t s) const {
+    return (const Item*)(base + segments[s].offset);
+  }
+
+  /* Checks that the header and the segment index lie in the file, and
+   * that each segment holds whole items inside the item buffers; the
+   * bounds are compared by differences, as the values read from the
+   * file may be arbitrary. */
+  bool check_layout() const {
+    const file_header* h = (const file_header*)base;
+    if (h->magic != file_magic || h->item_szb != sizeof(value_type))
+      return false;
+    if (h->index_offset < header_szb || h->index_offset > file_szb ||
+        h->index_offset % alignof(segment_entry) != 0 ||
+        h->nb_segments > (file_szb - h->index_offset) / sizeof(segment_entry))
+      return false;
+    const segment_entry* entries = (const segment_entry*)(base + h->index_offset);
+    uint64_t nb_items = 0;
+    for (uint64_t s = 0; s < h->nb_segments; s++) {
+      const segment_entry& e = entries[s];
+      if (e.offset < header_szb || e.offset > h->index_offset ||
+          e.offset % alignof(value_type) != 0 ||
+          e.nb > (h->index_offset - e.offset) / sizeof(value_type))
+        return false;
+      nb_items += e.nb;
+      if (nb_items > file_szb / sizeof(value_type))
+        return false;
+    }
+    return nb_items == h->nb_items;
+  }
+
+public:
+
+  using value_type = Item;
+  using size_type = size_t;
+
+  static_assert(std::is_trivially_copyable<value_type>::value,
+                "only trivially-copyable items can be persisted");
+
+  view() { }
+
+  view(const view&) = delete;
+  view& operator=(const view&) = delete;
+
+  ~view() {
+    close();
+  }
+
+  /*! \brief Maps, read only, the file at `path`, written by
+   *  `store::persist` for a container of items of type `Item`;
+   *  returns false on failure, in particular if the file is not laid
+   *  out as `persist` writes it.
+   */
+  bool open(const char* path) {
+    assert(base == nullptr);
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < header_szb) {
+      close();
+      return false;
+    }
+    file_szb = size_t(st.st_size);
+    void* p = mmap(nullptr, file_szb, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      close();
+      return false;
+    }
+    base = (const char*)p;
+    if (! check_layout()) {
+      close();
+      return false;
+    }
+    const file_header* h = (const file_header*)base;
+    segments = (const segment_entry*)(base + h->index_offset);
+    nb_segments = h->nb_segments;
+    offsets.resize(nb_segments + 1);
+    offsets[0] = 0;
+    for (size_t s = 0; s < nb_segments; s++)
+      offsets[s + 1] = offsets[s] + segments[s].nb;
+    return true;
+  }
+
+  void close() {
+    if (base != nullptr)
+      munmap((void*)base, file_szb);
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+    base = nullptr;
+    segments = nullptr;
+    nb_segments = 0;
+    offsets.clear();
+  }
+
+  size_type size() const {
+    return offsets.empty() ? 0 : size_type(offsets.back());
+  }
+
+  //! Logarithmic in the number of segments
+  const value_type& operator[](size_type i) const {
+    assert(i < size());
+    size_t s = size_t(std::upper_bound(offsets.begin(), offsets.end(), uint64_t(i)) - offsets.begin()) - 1;
+    return segment_begin(s)[i - offsets[s]];
+  }
+
+  template <class Body>
+  void for_each_segment(const Body& f) const {
+    for (size_t s = 0; s < nb_segments; s++)
+      f(segment_begin(s), segment_begin(s) + segments[s].nb);
+  }
+
+  template <class Body>
+  void for_each(const Body& f) const {
+    for_each_segment([&] (const value_type* lo, const value_type* hi) {
+      for (const value_type* p = lo; p < hi; p++)
+        f(*p);
+    });
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_DATA_MMAPSTORE_H_ */
@@ -129,6 +129,18 @@ void seq_dispatch_by_container() {
     using deque_type = chunkedseq::bootstrapped::stack<value_type, Chunk_capacity>;
     chunkedseq_dispatch_by_property<sequence_container_properties<deque_type>>();
   });
+  c.add("chunked_bootstrapped_deque_freelist", [] {
+    using cache_type = cachedmeasure::trivial<value_type, size_t>;
+    using deque_type = chunkedseq::bootstrapped::deque<value_type, Chunk_capacity, cache_type,
+      fixedcapacity::heap_allocated::ringbuffer_ptrx, std::allocator<value_type>, chunkalloc::freelist<>>;
+    chunkedseq_dispatch_by_property<sequence_container_properties<deque_type>>();
+  });
+  c.add("chunked_bootstrapped_deque_arena", [] {
+    using cache_type = cachedmeasure::trivial<value_type, size_t>;
+    using deque_type = chunkedseq::bootstrapped::deque<value_type, Chunk_capacity, cache_type,
+      fixedcapacity::heap_allocated::ringbuffer_ptrx, std::allocator<value_type>, chunkalloc::arena<>>;
+    chunkedseq_dispatch_by_property<sequence_container_properties<deque_type>>();
+  });
 #ifndef SKIP_NON_DEQUE
   c.add("chunked_ftree_deque", [] {
     using deque_type = chunkedseq::ftree::deque<value_type, Chunk_capacity>;
@@ -138,6 +150,12 @@ void seq_dispatch_by_container() {
     using deque_type = chunkedseq::ftree::stack<value_type, Chunk_capacity>;
     chunkedseq_dispatch_by_property<sequence_container_properties<deque_type>>();
   });
+  c.add("chunked_ftree_deque_arena", [] {
+    using cache_type = cachedmeasure::trivial<value_type, size_t>;
+    using deque_type = chunkedseq::ftree::deque<value_type, Chunk_capacity, cache_type,
+      fixedcapacity::heap_allocated::ringbuffer_ptrx, std::allocator<value_type>, chunkalloc::arena<>>;
+    chunkedseq_dispatch_by_property<sequence_container_properties<deque_type>>();
+  });
   /*
   c.add("triv", [] {
     using deque_type = bootchunkedseq::triv<value_type, Chunk_capacity>;
@@ -209,6 +227,12 @@ void bag_dispatch_by_container() {
     using bag_type = chunkedseq::bootstrapped::bagopt<value_type, Chunk_capacity>;
     chunkedbag_dispatch_by_property<bag_container_properties<bag_type>>();
   });
+  c.add("chunked_bootstrapped_freelist", [] {
+    using cache_type = cachedmeasure::trivial<value_type, size_t>;
+    using bag_type = chunkedseq::bootstrapped::bagopt<value_type, Chunk_capacity, cache_type,
+      std::allocator<value_type>, chunkalloc::freelist<>>;
+    chunkedbag_dispatch_by_property<bag_container_properties<bag_type>>();
+  });
 #ifndef SKIP_NON_DEQUE
   c.add("chunked_ftree_bag", [] {
     using deque_type = chunkedseq::ftree::bagopt<value_type, Chunk_capacity>;
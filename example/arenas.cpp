@@ -0,0 +1,128 @@
+/*!
+ * \file arenas.cpp
+ * \brief Latency of small queries served next to a bulk computation.
+ * \example arenas.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-n <int>` (default=100000000)
+ *       number of iterations of the bulk loop
+ *   - `-nb_queries <int>` (default=100)
+ *       number of queries issued during the bulk loop
+ *   - `-query_size <int>` (default=10000)
+ *       number of iterations of the loop of each query
+ *   - `-arenas <string>`
+ *       sizes of the arenas, e.g., `-proc 8 -arenas 6,2`; see `arena.hpp`
+ *
+ * Implementation: the bulk loop hashes `n` integers in arena 0, from
+ * the root thread of `launch`. Meanwhile, a client OS thread submits
+ * the queries one at a time, to the last arena, and waits for each of
+ * them to complete before issuing the next. Without `-arenas`, the
+ * queries compete for the same workers as the bulk loop; with, e.g.,
+ * `-arenas 6,2`, they are served by two workers of their own. The
+ * latency of a query is the time from its submission to its
+ * completion. The program requires at least two workers.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "arena.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace arena = pasl::sched::arena;
+
+/*---------------------------------------------------------------------*/
+
+static uint64_t hash(uint64_t x) {
+  for (int k = 0; k < 16; k++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+  }
+  return x;
+}
+
+int main(int argc, char** argv) {
+  long n = 0;
+  long nb_queries = 0;
+  long query_size = 0;
+  std::vector<uint64_t> xs;
+  std::vector<uint64_t> query_results;
+  std::vector<double> latencies;
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 100000000);
+    nb_queries = (long)pasl::util::cmdline::parse_or_default_int("nb_queries", 100);
+    query_size = (long)pasl::util::cmdline::parse_or_default_int("query_size", 10000);
+    // the root thread polls for the end of the queries at the end of the run
+    if (pasl::sched::threaddag::get_nb_workers() < 2)
+      pasl::util::atomic::die("arenas requires at least two workers\n");
+    xs.resize(n);
+    query_results.resize(nb_queries);
+    latencies.resize(nb_queries);
+  };
+  auto run = [&] (bool sequential) {
+    std::atomic<bool> client_done(false);
+    std::thread client([&] {
+      int a = arena::get_nb() - 1;
+      for (long q = 0; q < nb_queries; q++) {
+        arena::job_p j = arena::submit(a, [&, q] {
+          std::atomic<uint64_t> r(0);
+          par::parallel_for(0l, query_size, [&, q] (long i) {
+            r += hash((uint64_t)(q * query_size + i));
+          });
+          query_results[q] = r.load();
+        });
+        j->wait();
+        latencies[q] = j->latency();
+      }
+      client_done = true;
+    });
+    long* p = (long*)xs.data();
+    par::parallel_for(0l, n, [p] (long i) {
+      p[i] = (long)hash((uint64_t)i);
+    });
+    // keeps worker 0 in the scheduler, as it may hold threads of the queries
+    while (! client_done.load())
+      par::yield();
+    client.join();
+  };
+  auto output = [&] {
+    bool ok = true;
+    for (long i = 0; i < n && ok; i++)
+      ok = (xs[i] == hash((uint64_t)i));
+    for (long q = 0; q < nb_queries && ok; q++) {
+      uint64_t r = 0;
+      for (long i = 0; i < query_size; i++)
+        r += hash((uint64_t)(q * query_size + i));
+      ok = (query_results[q] == r);
+    }
+    std::cout << "result " << (ok ? "ok" : "error") << std::endl;
+    std::sort(latencies.begin(), latencies.end());
+    double mean = 0.0;
+    for (double l : latencies)
+      mean += l;
+    mean = (nb_queries > 0) ? mean / nb_queries : 0.0;
+    auto percentile = [&] (double p) {
+      return (nb_queries > 0) ? latencies[std::min(nb_queries - 1, (long)(p * nb_queries))] : 0.0;
+    };
+    std::cout << "query_latency_mean_us " << 1000000. * mean << std::endl;
+    std::cout << "query_latency_p99_us " << 1000000. * percentile(0.99) << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
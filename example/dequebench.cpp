@@ -0,0 +1,144 @@
+/*!
+ * \file dequebench.cpp
+ * \brief Microbenchmark for the Chase-Lev work-stealing deque.
+ * \example dequebench.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-proc <int>` (default=4)
+ *       largest number of threads; the benchmark is run for
+ *       1, 2, 4, ... threads up to this value
+ *   - `-duration <double>` (default=1.0)
+ *       length of each run, in seconds
+ *   - `-burst <int>` (default=64)
+ *       number of items pushed by a thread between two steal attempts
+ *   - `-max_size <int>` (default=65536)
+ *       size beyond which a thread drains its own deque
+ *
+ * Each thread owns a deque. In a loop, a thread pushes `burst` items
+ * on its deque, pops back half as many, then tries to steal once from
+ * the deque of another thread chosen at random. The leftover items
+ * make the deques grow, so that buffer growth and reclamation are
+ * exercised as well. The output reports the throughput of each kind
+ * of operation, in millions of operations per second.
+ *
+ */
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "pcmdline.hpp"
+#include "microtime.hpp"
+#include "workstealing.hpp"
+
+/***********************************************************************/
+
+namespace ws = pasl::sched::workstealing;
+
+using thread_p = pasl::sched::thread_p;
+
+struct counters_t {
+  long nb_push = 0;
+  long nb_pop = 0;
+  long nb_steal = 0;
+  long nb_steal_empty = 0;
+  long nb_steal_abort = 0;
+  char padding[128];
+};
+
+/*---------------------------------------------------------------------*/
+
+static void run_with(int nb_threads, double duration, int burst, long max_size) {
+  pasl::util::epoch::manager epochs;
+  epochs.init(nb_threads);
+  std::vector<ws::chase_lev_deque> deques(nb_threads);
+  for (int i = 0; i < nb_threads; i++)
+    deques[i].init(1024l, &epochs);
+  std::vector<counters_t> counters(nb_threads);
+  std::atomic<bool> start(false);
+  std::atomic<bool> stop(false);
+  auto body = [&] (int my_id) {
+    ws::chase_lev_deque& mine = deques[my_id];
+    counters_t& c = counters[my_id];
+    unsigned seed = my_id + 1;
+    // items must not collide with the sentinels 0 and 1
+    thread_p item = (thread_p)(long)(2 + my_id);
+    while (! start.load());
+    while (! stop.load()) {
+      for (int k = 0; k < burst; k++) {
+        mine.push_back(item);
+        c.nb_push++;
+      }
+      for (int k = 0; k < burst / 2; k++)
+        if (mine.pop_back() != NULL)
+          c.nb_pop++;
+      if (nb_threads > 1) {
+        seed = seed * 1103515245 + 12345;
+        int victim = (int)((seed >> 16) % (nb_threads - 1));
+        if (victim >= my_id)
+          victim++;
+        thread_p t = deques[victim].pop_front(my_id);
+        if (t == (thread_p)0)
+          c.nb_steal_empty++;
+        else if (t == (thread_p)1)
+          c.nb_steal_abort++;
+        else
+          c.nb_steal++;
+      }
+      if ((long)mine.nb_threads() > max_size)
+        while (mine.pop_back() != NULL)
+          c.nb_pop++;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < nb_threads; i++)
+    threads.push_back(std::thread(body, i));
+  pasl::microtime_t start_time = pasl::util::microtime::now();
+  start.store(true);
+  while (pasl::util::microtime::seconds_since(start_time) < duration)
+    std::this_thread::yield();
+  stop.store(true);
+  for (int i = 0; i < nb_threads; i++)
+    threads[i].join();
+  double elapsed = pasl::util::microtime::seconds_since(start_time);
+  counters_t total;
+  for (int i = 0; i < nb_threads; i++) {
+    total.nb_push += counters[i].nb_push;
+    total.nb_pop += counters[i].nb_pop;
+    total.nb_steal += counters[i].nb_steal;
+    total.nb_steal_empty += counters[i].nb_steal_empty;
+    total.nb_steal_abort += counters[i].nb_steal_abort;
+  }
+  for (int i = 0; i < nb_threads; i++) {
+    while (deques[i].pop_back() != NULL);
+    deques[i].destroy();
+  }
+  double mops = 1000000.0 * elapsed;
+  printf("proc %d\tpush_mops %.3lf\tpop_mops %.3lf\tsteal_mops %.3lf\t"
+         "steal_empty %ld\tsteal_abort %ld\n",
+         nb_threads,
+         total.nb_push / mops, total.nb_pop / mops, total.nb_steal / mops,
+         total.nb_steal_empty, total.nb_steal_abort);
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  pasl::util::cmdline::set(argc, argv);
+  int max_proc = pasl::util::cmdline::parse_or_default_int("proc", 4);
+  double duration = pasl::util::cmdline::parse_or_default_double("duration", 1.0);
+  int burst = pasl::util::cmdline::parse_or_default_int("burst", 64);
+  long max_size = pasl::util::cmdline::parse_or_default_long("max_size", 1l << 16);
+  for (int p = 1; p < max_proc; p *= 2)
+    run_with(p, duration, burst, max_size);
+  run_with(max_proc, duration, burst, max_size);
+  return 0;
+}
+
+/***********************************************************************/
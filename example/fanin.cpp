@@ -0,0 +1,87 @@
+/*!
+ * \file fanin.cpp
+ * \brief Stress test for the join counters of finish blocks.
+ * \example fanin.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-n <int>` (default=100000)
+ *       number of tasks joined by each finish block
+ *   - `-rounds <int>` (default=10)
+ *       number of finish blocks, run one after the other
+ *   - `-finish_instrategy <string>` (default=distributed)
+ *       join counter of the finish blocks: `distributed`, `snzi` or
+ *       `fetch_add`
+ *
+ * Implementation: each finish block spawns its tasks by recursive
+ * halving, with `async`, so that all the tasks are joined at the same
+ * continuation. The tasks do next to no work, so that the running
+ * time is dominated by the updates to the join counter. The output
+ * reports the average time taken by one finish block.
+ *
+ */
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+int* visited = nullptr;
+
+/*---------------------------------------------------------------------*/
+
+static void spawn(long lo, long hi, par::multishot* join) {
+  while (hi - lo > 1) {
+    long mid = (lo + hi) / 2;
+    par::async([=] { spawn(mid, hi, join); }, join);
+    hi = mid;
+  }
+  if (lo < hi)
+    visited[lo]++;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long n = 0;
+  long rounds = 0;
+  double elapsed = 0.0;
+  bool ok = true;
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 100000);
+    rounds = (long)pasl::util::cmdline::parse_or_default_int("rounds", 10);
+    visited = (int*)calloc(std::max(1l, n), sizeof(int));
+  };
+
+  auto run = [&] (bool sequential) {
+    for (long r = 0; r < rounds; r++) {
+      uint64_t start = pasl::util::microtime::now();
+      par::finish([&] (par::multishot* join) {
+        spawn(0, n, join);
+      });
+      elapsed += pasl::util::microtime::seconds_since(start);
+    }
+  };
+
+  auto output = [&] {
+    for (long i = 0; i < n; i++)
+      ok = ok && (visited[i] == rounds);
+    std::cout << "result " << (ok ? "ok" : "error") << std::endl;
+    std::cout << "finish_latency " << (rounds > 0 ? elapsed / rounds : 0.0) << std::endl;
+  };
+
+  auto destroy = [&] {
+    free(visited);
+  };
+
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,105 @@
+/*!
+ * \file pcontainerbench.cpp
+ * \brief Parallel bulk operations over chunked sequences.
+ * \example pcontainerbench.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-n <int>` (default=100000000)
+ *       number of items in the sequence
+ *   - `-op <string>` (default=reduce)
+ *       operation to time, among `tabulate`, `for_each`, `reduce`,
+ *       `scan`, `filter` and `transfer`
+ *
+ * Implementation: except for `tabulate`, which builds it, the
+ * sequence holds the integers `0` to `n-1`, pushed sequentially
+ * during the initialization. The `transfer` operation is
+ * `pcontainer::transfer_contents_to_array`, which empties the sequence
+ * by repeated `split`; the other operations walk the segments of the
+ * sequence in place (see `pcontainer.hpp`). The output line `result`
+ * is the sum of the items of the sequence (or of the array) after the
+ * operation, so that the runs can be checked against `-proc 0`.
+ *
+ */
+
+#include <string>
+
+#include "benchmark.hpp"
+#include "pcontainer.hpp"
+
+/***********************************************************************/
+
+namespace pcontainer = pasl::data::pcontainer;
+
+using sequence_type = pcontainer::deque<long>;
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long n = 0;
+  std::string op;
+  sequence_type xs;
+  long* array = nullptr;
+  long result = 0;
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 100000000);
+    op = pasl::util::cmdline::parse_or_default_string("op", "reduce");
+    if (op != "tabulate")
+      for (long i = 0; i < n; i++)
+        xs.push_back(i);
+    if (op == "transfer")
+      array = new long[n];
+  };
+  auto plus = [] (long x, long y) {
+    return x + y;
+  };
+  auto run = [&] (bool sequential) {
+    if (op == "tabulate") {
+      pcontainer::tabulate(size_t(n), xs, [] (size_t i) {
+        return long(i);
+      });
+    } else if (op == "for_each") {
+      pcontainer::for_each(xs, [] (long& x) {
+        x = 2 * x;
+      });
+    } else if (op == "reduce") {
+      result = pcontainer::reduce(xs, 0l, plus);
+    } else if (op == "scan") {
+      pcontainer::scan(xs, 0l, plus);
+    } else if (op == "filter") {
+      sequence_type ys;
+      pcontainer::filter(xs, ys, [] (long x) {
+        return x % 2 == 0;
+      });
+      xs.swap(ys);
+    } else if (op == "transfer") {
+      pcontainer::transfer_contents_to_array(xs, array);
+    } else {
+      pasl::util::atomic::die("unknown operation %s\n", op.c_str());
+    }
+  };
+  auto output = [&] {
+    long sum = 0;
+    if (op == "transfer")
+      for (long i = 0; i < n; i++)
+        sum += array[i];
+    else if (op != "reduce")
+      xs.for_each([&] (long x) { sum += x; });
+    else
+      sum = result;
+    std::cout << "result " << sum << std::endl;
+  };
+  auto destroy = [&] {
+    if (array != nullptr)
+      delete [] array;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
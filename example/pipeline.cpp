@@ -0,0 +1,186 @@
+/*!
+ * \file pipeline.cpp
+ * \brief Streaming pipeline built from typed futures.
+ * \example pipeline.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-n <int>` (default=100000)
+ *       number of items in the stream
+ *   - `-item_size <int>` (default=64)
+ *       number of fields in each item
+ *   - `-window <int>` (default=256)
+ *       maximal number of items in flight
+ *   - `-chain <string>` (default=then)
+ *       `then` to chain the stages with `then`, `force` to run each
+ *       item in a single thread that forces the future of each stage
+ *
+ * Implementation: each item of the stream is a line of comma-separated
+ * integers, which goes through three stages: parse, which reads the
+ * integers of the line; hash, which hashes them; and aggregate, which
+ * adds the hash to a global accumulator and records the time at which
+ * the item completes. The producer issues the items in order; when
+ * `window` items are in flight, it forces the oldest one before
+ * issuing the next. The latency of an item is the time from its issue
+ * to the end of its aggregate stage. The stages of all items are
+ * collected with `when_all` at the end, and `when_any` is used to
+ * check that any completed item can be retrieved.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "future.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+using fields_type = std::vector<long>;
+
+/*---------------------------------------------------------------------*/
+/* Stages */
+
+static std::string make_item(long i, long item_size) {
+  std::string line;
+  uint64_t x = 2463534242ull + (uint64_t)i;
+  for (long k = 0; k < item_size; k++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    if (k > 0)
+      line += ',';
+    line += std::to_string((long)(x % 1000000));
+  }
+  return line;
+}
+
+static fields_type parse(const std::string& line) {
+  fields_type fields;
+  long v = 0;
+  for (char c : line) {
+    if (c == ',') {
+      fields.push_back(v);
+      v = 0;
+    } else {
+      v = 10 * v + (c - '0');
+    }
+  }
+  fields.push_back(v);
+  return fields;
+}
+
+static uint64_t hash(const fields_type& fields) {
+  uint64_t h = 14695981039346656037ull;
+  for (long v : fields) {
+    h ^= (uint64_t)v;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long n = 0;
+  long item_size = 0;
+  long window = 0;
+  bool chain_then = true;
+  std::vector<std::string> items;
+  std::vector<uint64_t> issue_times;
+  std::vector<uint64_t> completion_times;
+  std::atomic<uint64_t> accumulator(0);
+  uint64_t expected = 0;
+  uint64_t nb_collected = 0;
+  bool any_ok = false;
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 100000);
+    item_size = (long)pasl::util::cmdline::parse_or_default_int("item_size", 64);
+    window = std::max(1l, (long)pasl::util::cmdline::parse_or_default_int("window", 256));
+    std::string chain = pasl::util::cmdline::parse_or_default_string("chain", "then");
+    if (chain == "force")
+      chain_then = false;
+    else if (chain != "then")
+      pasl::util::atomic::die("unknown chain %s\n", chain.c_str());
+    items.resize(n);
+    for (long i = 0; i < n; i++)
+      items[i] = make_item(i, item_size);
+    for (long i = 0; i < n; i++)
+      expected += hash(parse(items[i]));
+    issue_times.resize(n);
+    completion_times.resize(n);
+  };
+  auto run = [&] (bool sequential) {
+    auto aggregate = [&] (long i, uint64_t h) {
+      accumulator += h;
+      completion_times[i] = pasl::util::microtime::now();
+      return h;
+    };
+    std::deque<par::future<uint64_t>> in_flight;
+    std::vector<par::future<uint64_t>> all;
+    all.reserve(n);
+    for (long i = 0; i < n; i++) {
+      if ((long)in_flight.size() >= window) {
+        in_flight.front().force();
+        in_flight.pop_front();
+      }
+      issue_times[i] = pasl::util::microtime::now();
+      par::future<uint64_t> f;
+      if (chain_then) {
+        f = par::async_future([&, i] { return parse(items[i]); })
+          .then([] (fields_type& fields) { return hash(fields); })
+          .then([&, i] (uint64_t h) { return aggregate(i, h); });
+      } else {
+        f = par::async_future([&, i] {
+          auto parsed = par::async_future([&, i] { return parse(items[i]); });
+          fields_type& fields = parsed.force();
+          auto hashed = par::async_future([&] { return hash(fields); });
+          return aggregate(i, hashed.force());
+        });
+      }
+      in_flight.push_back(f);
+      all.push_back(f);
+    }
+    auto first = par::when_any(all);
+    std::pair<size_t, uint64_t>& p = first.force();
+    any_ok = (p.first < all.size()) && (all[p.first].force() == p.second);
+    auto hashes = par::when_all(all);
+    for (uint64_t h : hashes.force()) {
+      (void)h;
+      nb_collected++;
+    }
+  };
+  auto output = [&] {
+    bool ok = (accumulator.load() == expected) && (nb_collected == (uint64_t)n) && any_ok;
+    std::cout << "result " << (ok ? "ok" : "error") << std::endl;
+    std::vector<uint64_t> latencies(n);
+    for (long i = 0; i < n; i++)
+      latencies[i] = completion_times[i] - issue_times[i];
+    std::sort(latencies.begin(), latencies.end());
+    double mean = 0.0;
+    for (uint64_t l : latencies)
+      mean += (double)l;
+    mean = (n > 0) ? mean / n : 0.0;
+    auto percentile = [&] (double p) {
+      return (n > 0) ? latencies[std::min(n - 1, (long)(p * n))] : 0;
+    };
+    std::cout << "latency_mean_us " << mean << std::endl;
+    std::cout << "latency_p50_us " << percentile(0.50) << std::endl;
+    std::cout << "latency_p99_us " << percentile(0.99) << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,108 @@
+/*!
+ * \file prioritybench.cpp
+ * \brief Latency of short tasks spawned during a large parallel loop.
+ * \example prioritybench.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-n <int>` (default=10000000)
+ *       number of iterations of the loop
+ *   - `-period <int>` (default=100000)
+ *       one short task is spawned every `period` iterations
+ *   - `-priority <string>` (default=high)
+ *       priority of the short tasks, `high` or `normal`
+ *
+ * Implementation: each iteration of the loop hashes its index. Every
+ * `period` iterations, the loop body spawns a short task with `async`,
+ * at the priority selected on the command line. The latency of a
+ * short task is the time from its spawn to the start of its body. The
+ * statistics printed at the end of the run include the queueing delay
+ * per priority lane, from the addition of a thread to its execution.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+/*---------------------------------------------------------------------*/
+
+static uint64_t hash(uint64_t x) {
+  for (int k = 0; k < 16; k++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+  }
+  return x;
+}
+
+int main(int argc, char** argv) {
+  long n = 0;
+  long period = 0;
+  pasl::sched::priority_t priority = pasl::sched::PRIORITY_HIGH;
+  std::vector<uint64_t> xs;
+  long nb_tasks = 0;
+  std::vector<uint64_t> spawn_times;
+  std::vector<uint64_t> start_times;
+  std::atomic<long> nb_done(0);
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 10000000);
+    period = std::max(1l, (long)pasl::util::cmdline::parse_or_default_int("period", 100000));
+    std::string p = pasl::util::cmdline::parse_or_default_string("priority", "high");
+    if (p == "normal")
+      priority = pasl::sched::PRIORITY_NORMAL;
+    else if (p != "high")
+      pasl::util::atomic::die("unknown priority %s\n", p.c_str());
+    xs.resize(n);
+    nb_tasks = (n + period - 1) / period;
+    spawn_times.resize(nb_tasks);
+    start_times.resize(nb_tasks);
+  };
+  auto run = [&] (bool sequential) {
+    par::finish([&] (par::multishot* join) {
+      par::parallel_for(0l, n, [&, join] (long i) {
+        xs[i] = hash((uint64_t)i);
+        if (i % period != 0)
+          return;
+        long k = i / period;
+        spawn_times[k] = pasl::util::microtime::now();
+        par::async([&, k] {
+          start_times[k] = pasl::util::microtime::now();
+          nb_done++;
+        }, join, priority);
+      });
+    });
+  };
+  auto output = [&] {
+    bool ok = (nb_done.load() == nb_tasks);
+    for (long i = 0; i < n && ok; i++)
+      ok = (xs[i] == hash((uint64_t)i));
+    std::cout << "result " << (ok ? "ok" : "error") << std::endl;
+    std::vector<uint64_t> latencies(nb_tasks);
+    for (long k = 0; k < nb_tasks; k++)
+      latencies[k] = start_times[k] - spawn_times[k];
+    std::sort(latencies.begin(), latencies.end());
+    double mean = 0.0;
+    for (uint64_t l : latencies)
+      mean += (double)l;
+    mean = (nb_tasks > 0) ? mean / nb_tasks : 0.0;
+    std::cout << "latency_mean_us " << mean << std::endl;
+    std::cout << "latency_max_us " << ((nb_tasks > 0) ? latencies.back() : 0) << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
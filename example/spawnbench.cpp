@@ -0,0 +1,102 @@
+/*!
+ * \file spawnbench.cpp
+ * \brief Start-up behavior of the spawn policies of `native::fork2`.
+ * \example spawnbench.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-algo <string>` (default=fib)
+ *       `fib` or `parallel_for`
+ *   - `-n <int>`
+ *       fib: the argument (default=30); parallel_for: the number of
+ *       iterations (default=10000000)
+ *   - `-cutoff <int>` (default=15)
+ *       fib: sequentializes fib(m) as soon as m <= cutoff
+ *   - `-spawn_policy <string>` (default=work_first)
+ *       `work_first`, `help_first` or `adaptive`; see `native.hpp`
+ *
+ * The statistics printed at the end of the run include `ramp_up`, the
+ * time in seconds from the start of the run until every worker has
+ * executed a thread, which measures how fast the policy spreads the
+ * work. The breadth-first search `our_pbfs` of `graph/bench/search`
+ * takes the same `-spawn_policy` option.
+ *
+ */
+
+#include <vector>
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+long cutoff = 0;
+
+/*---------------------------------------------------------------------*/
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  std::string algo;
+  long n = 0;
+  long result = 0;
+  std::vector<long> xs;
+
+  auto init = [&] {
+    algo = pasl::util::cmdline::parse_or_default_string("algo", "fib");
+    bool is_fib = (algo == "fib");
+    if (! is_fib && algo != "parallel_for")
+      pasl::util::atomic::die("unknown algo %s\n", algo.c_str());
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", is_fib ? 30 : 10000000);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 15);
+    if (! is_fib)
+      xs.resize(n);
+  };
+  auto run = [&] (bool sequential) {
+    if (algo == "fib") {
+      result = par_fib(n);
+    } else {
+      long* p = xs.data();
+      par::parallel_for(0l, n, [p] (long i) {
+        p[i] = 3 * i + 1;
+      });
+    }
+  };
+  auto output = [&] {
+    bool ok = true;
+    if (algo == "fib") {
+      ok = (result == seq_fib(n));
+    } else {
+      for (long i = 0; i < n; i++)
+        ok = ok && (xs[i] == 3 * i + 1);
+    }
+    std::cout << "result " << (ok ? "ok" : "error") << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
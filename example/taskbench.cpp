@@ -0,0 +1,378 @@
+/*!
+ * \file taskbench.cpp
+ * \brief Compares the coroutine front end with `native::fork2`.
+ * \example taskbench.cpp
+ * \date 2014
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-algo <string>` (default=fib)
+ *       `fib`, `mergesort` or `bfs`
+ *   - `-frontend <string>` (default=native)
+ *       `native` for `native::fork2`, `coroutine` for `task<T>`
+ *   - `-n <int>`
+ *       fib: the argument (default=30); mergesort: the number of
+ *       items (default=1000000); bfs: the number of vertices
+ *       (default=1000000)
+ *   - `-degree <int>` (default=8)
+ *       bfs: the out-degree of the vertices of the random graph
+ *   - `-cutoff <int>`
+ *       size below which the algorithm runs sequentially; fib:
+ *       (default=15); mergesort and bfs: (default=2048)
+ *
+ * The coroutine front end is available only when compiled with
+ * support for coroutines, e.g., in mode `coro`. The output reports
+ * the maximum resident set size of the process and, for the coroutine
+ * front end, the number of bytes taken by the frame pools.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <sys/resource.h>
+
+#include "benchmark.hpp"
+#include "coroutine.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+#if defined(__cpp_impl_coroutine) || defined(__cpp_coroutines)
+#define HAVE_COROUTINES
+using pasl::sched::task;
+#endif
+
+long cutoff = 0;
+
+/*---------------------------------------------------------------------*/
+/* Fibonacci */
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long native_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = native_fib(n-1); },
+             [n, &b] { b = native_fib(n-2); });
+  return a + b;
+}
+
+#ifdef HAVE_COROUTINES
+static task<long> coroutine_fib(long n) {
+  if (n <= cutoff || n < 2)
+    co_return seq_fib(n);
+  task<long> a = coroutine_fib(n-1);
+  task<long> b = coroutine_fib(n-2);
+  co_await pasl::sched::fork2(a, b);
+  co_return a.get() + b.get();
+}
+#endif
+
+/*---------------------------------------------------------------------*/
+/* Mergesort */
+
+using item_type = long;
+
+// merges the sorted ranges `[lo1, hi1)` and `[lo2, hi2)` into `dst`
+static void seq_merge(const item_type* lo1, const item_type* hi1,
+                      const item_type* lo2, const item_type* hi2, item_type* dst) {
+  std::merge(lo1, hi1, lo2, hi2, dst);
+}
+
+/* Splits the merge around the median of the larger range; returns
+ * false if the ranges are small enough to be merged sequentially.
+ */
+static bool split_merge(const item_type*& lo1, const item_type*& hi1,
+                        const item_type*& lo2, const item_type*& hi2,
+                        const item_type*& mid1, const item_type*& mid2) {
+  if ((hi1 - lo1) + (hi2 - lo2) <= cutoff)
+    return false;
+  if (hi1 - lo1 < hi2 - lo2) {
+    std::swap(lo1, lo2);
+    std::swap(hi1, hi2);
+  }
+  mid1 = lo1 + (hi1 - lo1) / 2;
+  mid2 = std::lower_bound(lo2, hi2, *mid1);
+  return true;
+}
+
+static void native_merge(const item_type* lo1, const item_type* hi1,
+                         const item_type* lo2, const item_type* hi2, item_type* dst) {
+  const item_type* mid1;
+  const item_type* mid2;
+  if (! split_merge(lo1, hi1, lo2, hi2, mid1, mid2)) {
+    seq_merge(lo1, hi1, lo2, hi2, dst);
+    return;
+  }
+  item_type* dst2 = dst + (mid1 - lo1) + (mid2 - lo2);
+  par::fork2([&] { native_merge(lo1, mid1, lo2, mid2, dst); },
+             [&] { native_merge(mid1, hi1, mid2, hi2, dst2); });
+}
+
+// sorts `xs[lo, hi)`, using `tmp[lo, hi)` as scratch space
+static void native_mergesort(item_type* xs, item_type* tmp, long lo, long hi) {
+  if (hi - lo <= cutoff) {
+    std::sort(xs + lo, xs + hi);
+    return;
+  }
+  long mid = (lo + hi) / 2;
+  par::fork2([&] { native_mergesort(xs, tmp, lo, mid); },
+             [&] { native_mergesort(xs, tmp, mid, hi); });
+  native_merge(xs + lo, xs + mid, xs + mid, xs + hi, tmp + lo);
+  std::copy(tmp + lo, tmp + hi, xs + lo);
+}
+
+#ifdef HAVE_COROUTINES
+static task<> coroutine_merge(const item_type* lo1, const item_type* hi1,
+                              const item_type* lo2, const item_type* hi2, item_type* dst) {
+  const item_type* mid1;
+  const item_type* mid2;
+  if (! split_merge(lo1, hi1, lo2, hi2, mid1, mid2)) {
+    seq_merge(lo1, hi1, lo2, hi2, dst);
+    co_return;
+  }
+  item_type* dst2 = dst + (mid1 - lo1) + (mid2 - lo2);
+  task<> a = coroutine_merge(lo1, mid1, lo2, mid2, dst);
+  task<> b = coroutine_merge(mid1, hi1, mid2, hi2, dst2);
+  co_await pasl::sched::fork2(a, b);
+}
+
+static task<> coroutine_mergesort(item_type* xs, item_type* tmp, long lo, long hi) {
+  if (hi - lo <= cutoff) {
+    std::sort(xs + lo, xs + hi);
+    co_return;
+  }
+  long mid = (lo + hi) / 2;
+  task<> a = coroutine_mergesort(xs, tmp, lo, mid);
+  task<> b = coroutine_mergesort(xs, tmp, mid, hi);
+  co_await pasl::sched::fork2(a, b);
+  co_await coroutine_merge(xs + lo, xs + mid, xs + mid, xs + hi, tmp + lo);
+  std::copy(tmp + lo, tmp + hi, xs + lo);
+}
+#endif
+
+/*---------------------------------------------------------------------*/
+/* Breadth-first search */
+
+/* The graph is stored in compressed form: the out-neighbors of vertex
+ * `v` are `edges[offsets[v], offsets[v+1])`. The search proceeds one
+ * level at a time; the vertices of the current frontier are visited in
+ * parallel, and each vertex reached for the first time is claimed with
+ * a compare-and-swap on its distance, then appended to the next
+ * frontier.
+ */
+class graph_type {
+public:
+  long nb_vertices;
+  std::vector<long> offsets;
+  std::vector<long> edges;
+};
+
+static graph_type random_graph(long nb_vertices, long degree) {
+  graph_type g;
+  g.nb_vertices = nb_vertices;
+  g.offsets.resize(nb_vertices + 1);
+  g.edges.resize(nb_vertices * degree);
+  for (long v = 0; v <= nb_vertices; v++)
+    g.offsets[v] = v * degree;
+  uint64_t x = 88172645463325252ull;
+  for (long i = 0; i < nb_vertices * degree; i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    g.edges[i] = (long)(x % (uint64_t)nb_vertices);
+  }
+  return g;
+}
+
+class bfs_state {
+public:
+  const graph_type* g;
+  std::atomic<long>* dists;
+  long* frontier;
+  long* next;
+  std::atomic<long> nb_next;
+};
+
+static void seq_visit(bfs_state& s, long lo, long hi, long dist) {
+  const graph_type& g = *s.g;
+  for (long i = lo; i < hi; i++) {
+    long u = s.frontier[i];
+    for (long k = g.offsets[u]; k < g.offsets[u+1]; k++) {
+      long v = g.edges[k];
+      long unvisited = -1;
+      if (s.dists[v].load(std::memory_order_relaxed) == -1
+          && s.dists[v].compare_exchange_strong(unvisited, dist))
+        s.next[s.nb_next++] = v;
+    }
+  }
+}
+
+static void native_visit(bfs_state& s, long lo, long hi, long dist) {
+  if (hi - lo <= std::max(1l, cutoff / 8)) {
+    seq_visit(s, lo, hi, dist);
+    return;
+  }
+  long mid = (lo + hi) / 2;
+  par::fork2([&] { native_visit(s, lo, mid, dist); },
+             [&] { native_visit(s, mid, hi, dist); });
+}
+
+#ifdef HAVE_COROUTINES
+static task<> coroutine_visit(bfs_state& s, long lo, long hi, long dist) {
+  if (hi - lo <= std::max(1l, cutoff / 8)) {
+    seq_visit(s, lo, hi, dist);
+    co_return;
+  }
+  long mid = (lo + hi) / 2;
+  task<> a = coroutine_visit(s, lo, mid, dist);
+  task<> b = coroutine_visit(s, mid, hi, dist);
+  co_await pasl::sched::fork2(a, b);
+}
+#endif
+
+// returns the number of vertices reachable from vertex 0
+template <class Visit>
+long bfs(bfs_state& s, const Visit& visit) {
+  long nb_frontier = 1;
+  long nb_reached = 1;
+  s.frontier[0] = 0;
+  s.dists[0].store(0);
+  for (long dist = 1; nb_frontier > 0; dist++) {
+    s.nb_next.store(0);
+    visit(s, nb_frontier, dist);
+    nb_frontier = s.nb_next.load();
+    nb_reached += nb_frontier;
+    std::swap(s.frontier, s.next);
+  }
+  return nb_reached;
+}
+
+/*---------------------------------------------------------------------*/
+
+static long max_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int main(int argc, char** argv) {
+  std::string algo;
+  bool coroutine = false;
+  long n = 0;
+  long degree = 0;
+  bool ok = true;
+  long result = 0;
+  std::vector<item_type> xs;
+  std::vector<item_type> tmp;
+  graph_type g;
+  std::vector<std::atomic<long>> dists;
+  std::vector<long> frontier, next;
+
+  auto init = [&] {
+    algo = pasl::util::cmdline::parse_or_default_string("algo", "fib");
+    std::string frontend = pasl::util::cmdline::parse_or_default_string("frontend", "native");
+    if (frontend == "coroutine")
+      coroutine = true;
+    else if (frontend != "native")
+      pasl::util::atomic::die("unknown frontend %s\n", frontend.c_str());
+#ifndef HAVE_COROUTINES
+    if (coroutine)
+      pasl::util::atomic::die("compile with support for coroutines to use -frontend coroutine\n");
+#endif
+    bool is_fib = (algo == "fib");
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", is_fib ? 30 : 1000000);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", is_fib ? 15 : 2048);
+    degree = (long)pasl::util::cmdline::parse_or_default_int("degree", 8);
+    if (algo == "mergesort") {
+      xs.resize(n);
+      tmp.resize(n);
+      uint64_t x = 2463534242ull;
+      for (long i = 0; i < n; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        xs[i] = (item_type)(x % (uint64_t)(4 * n));
+      }
+    } else if (algo == "bfs") {
+      g = random_graph(n, degree);
+      dists = std::vector<std::atomic<long>>(n);
+      for (long v = 0; v < n; v++)
+        dists[v].store(-1);
+      frontier.resize(n);
+      next.resize(n);
+    } else if (algo != "fib") {
+      pasl::util::atomic::die("unknown algo %s\n", algo.c_str());
+    }
+  };
+  auto run = [&] (bool sequential) {
+    if (algo == "fib") {
+      if (! coroutine) {
+        result = native_fib(n);
+      } else {
+#ifdef HAVE_COROUTINES
+        task<long> t = coroutine_fib(n);
+        result = pasl::sched::sync_wait(t);
+#endif
+      }
+    } else if (algo == "mergesort") {
+      if (! coroutine) {
+        native_mergesort(xs.data(), tmp.data(), 0, n);
+      } else {
+#ifdef HAVE_COROUTINES
+        task<> t = coroutine_mergesort(xs.data(), tmp.data(), 0, n);
+        pasl::sched::sync_wait(t);
+#endif
+      }
+    } else {
+      bfs_state s;
+      s.g = &g;
+      s.dists = dists.data();
+      s.frontier = frontier.data();
+      s.next = next.data();
+      if (! coroutine) {
+        result = bfs(s, [&] (bfs_state& s, long nb, long dist) {
+          native_visit(s, 0, nb, dist);
+        });
+      } else {
+#ifdef HAVE_COROUTINES
+        result = bfs(s, [&] (bfs_state& s, long nb, long dist) {
+          task<> t = coroutine_visit(s, 0, nb, dist);
+          pasl::sched::sync_wait(t);
+        });
+#endif
+      }
+    }
+  };
+  auto output = [&] {
+    if (algo == "fib") {
+      ok = (result == seq_fib(n));
+    } else if (algo == "mergesort") {
+      ok = std::is_sorted(xs.begin(), xs.end());
+    } else {
+      long nb_reached = 0;
+      for (long v = 0; v < n; v++)
+        if (dists[v].load() != -1)
+          nb_reached++;
+      ok = (result == nb_reached);
+      std::cout << "nb_reached " << nb_reached << std::endl;
+    }
+    std::cout << "result " << (ok ? "ok" : "error") << std::endl;
+    std::cout << "max_rss_kb " << max_rss_kb() << std::endl;
+    if (coroutine)
+      std::cout << "frame_bytes " << pasl::sched::coroutine::frame_pools_nb_bytes() << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -107,6 +107,37 @@ void report_common_results() {
 #endif
 }
   
+/* With hardware counters, reports the counts per edge of the visited
+ * vertices; the first phase, which initializes the visited array,
+ * is left out.
+ */
+template <class Adjlist, class Is_visited_fct>
+void report_hwcounters_per_edge(const Adjlist& graph,
+                                const Is_visited_fct& is_visited) {
+#ifdef HWCOUNTERS
+  using vtxid_type = typename Adjlist::vtxid_type;
+  util::hwcounters::hwcounters_t& hw = util::hwcounters::the_counters;
+  int nb_phases = hw.get_nb_phases();
+  if (! hw.is_available() || nb_phases == 0)
+    return;
+  util::hwcounters::hwcounters_data_t traversal;
+  for (int k = (nb_phases > 1) ? 1 : 0; k < nb_phases; k++)
+    traversal.add(hw.get_phase(k));
+  vtxid_type nb_vertices = graph.get_nb_vertices();
+  long nb_edges = pbbs::sequence::plusReduce((long*)nullptr, nb_vertices, [&] (vtxid_type i) {
+    return is_visited(i) ? (long)graph.adjlists[i].get_out_degree() : 0l;
+  });
+  std::cout << "nb_edges_traversed\t" << nb_edges << std::endl;
+  if (nb_edges == 0)
+    return;
+  for (int i = 0; i < util::hwcounters::NB_HWCOUNTERS; i++) {
+    auto type = (util::hwcounters::hwcounter_type_t)i;
+    std::cout << "hw_" << util::hwcounters::name_of_type(type) << "_per_edge\t"
+              << ((double)traversal.values[i] / (double)nb_edges) << std::endl;
+  }
+#endif
+}
+
 template <class Adjlist, class Load_visited_fct>
 void report_dfs_results(const Adjlist& graph,
                         const Load_visited_fct& load_visited_fct) {
@@ -114,6 +145,7 @@ void report_dfs_results(const Adjlist& graph,
   vtxid_type nb_vertices = graph.get_nb_vertices();
   vtxid_type nb_visited = pbbs::sequence::plusReduce((vtxid_type*)nullptr, nb_vertices, load_visited_fct);
   std::cout << "nb_visited\t" << nb_visited << std::endl;
+  report_hwcounters_per_edge(graph, [&] (vtxid_type i) { return load_visited_fct(i) != 0; });
   report_common_results();
 }
   
@@ -128,6 +160,7 @@ void report_bfs_results(const Adjlist& graph,
   vtxid_type nb_visited = pbbs::sequence::plusReduce((vtxid_type*)nullptr, nb_vertices, is_visited);
   std::cout << "max_dist\t" << max_dist << std::endl;
   std::cout << "nb_visited\t" << nb_visited << std::endl;
+  report_hwcounters_per_edge(graph, [&] (vtxid_type i) { return is_visited(i) != 0; });
   report_common_results();
 }
 
@@ -244,6 +277,9 @@ void search_benchmark_parallel_select_algo() {
   m.add("our_pbfs_with_swap",    [&] (const adjlist_type& graph, vtxid_type source) {
     our_bfs_cutoff = util::cmdline::parse_or_default_int("our_pbfs_cutoff", 1024);
     dists = our_bfs<idempotent>::template main_with_swap<adjlist_type, frontiersegbag<adjlist_alias_type>>(graph, source); });
+  m.add("our_pbfs_concurrent",    [&] (const adjlist_type& graph, vtxid_type source) {
+    our_bfs_cutoff = util::cmdline::parse_or_default_int("our_pbfs_cutoff", 1024);
+    dists = our_bfs<idempotent>::template main_with_concurrent_frontier<adjlist_type, frontiersegbag<adjlist_alias_type>>(graph, source); });
   m.add("our_lazy_pbfs",    [&] (const adjlist_type& graph, vtxid_type source) {
     our_lazy_bfs_cutoff = util::cmdline::parse_or_default_int("our_lazy_pbfs_cutoff", 1024);
     dists = our_lazy_bfs<idempotent>::template main<adjlist_type, frontiersegbag<adjlist_alias_type>>(graph, source); });
@@ -318,6 +354,7 @@ static bool is_parallel_algo() {
   if (algo == "ls_pbfs")               return true;
   if (algo == "our_pbfs")              return true;
   if (algo == "our_pbfs_with_swap")    return true;
+  if (algo == "our_pbfs_concurrent")   return true;
   if (algo == "our_lazy_pbfs")         return true;
   if (algo == "our_pseudodfs")         return true;
   if (algo == "cong_pseudodfs")        return true;
@@ -528,6 +528,42 @@ public:
       prev.clear();
     });
   }
+  // Same as process_layer, except that all the leaves push into the
+  // shared frontier `next`, rather than into frontiers of their own
+  // that are concatenated on the way back up the forkjoin
+  template <class Adjlist_alias, class Frontier>
+  static void process_layer_concurrent(Adjlist_alias graph_alias,
+                                       std::atomic<typename Adjlist_alias::vtxid_type>* dists,
+                                       typename Adjlist_alias::vtxid_type& dist_of_next,
+                                       typename Adjlist_alias::vtxid_type source,
+                                       Frontier& prev,
+                                       typename Frontier::concurrent_type& next) {
+    using vtxid_type = typename Adjlist_alias::vtxid_type;
+    vtxid_type unknown = graph_constants<vtxid_type>::unknown_vtxid;
+    class no_output { };
+    no_output out;
+    auto cutoff = [] (Frontier& f) {
+      return f.nb_outedges() <= vtxid_type(our_bfs_cutoff);
+    };
+    auto split = [] (Frontier& src, Frontier& dst) {
+      assert(src.nb_outedges() > 1);
+      src.split(src.nb_outedges() / 2, dst);
+    };
+    auto join = [] (no_output&, no_output&) { };
+    auto set_in_env = [graph_alias] (Frontier& f) {
+      f.set_graph(graph_alias);
+    };
+    auto set_out_env = [] (no_output&) { };
+    sched::native::forkjoin(prev, out, cutoff, split, join, set_in_env, set_out_env,
+                          [&] (Frontier& prev, no_output&) {
+      prev.for_each_outedge([&] (vtxid_type other) {
+        if (ls_pbfs<idempotent>::try_to_set_dist(other, unknown, dist_of_next, dists))
+          next.push_vertex_back(other);
+      });
+      prev.clear();
+    });
+  }
+  
   /*
   template <class Adjlist_alias, class Frontier>
   static void process_layer_sequentially(Adjlist_alias graph_alias,
@@ -587,6 +623,40 @@ public:
     return dists;
   }
   
+  template <class Adjlist, class Frontier>
+  static std::atomic<typename Adjlist::vtxid_type>*
+  main_with_concurrent_frontier(const Adjlist& graph,
+                                typename Adjlist::vtxid_type source) {
+    using vtxid_type = typename Adjlist::vtxid_type;
+    vtxid_type unknown = graph_constants<vtxid_type>::unknown_vtxid;
+    vtxid_type nb_vertices = graph.get_nb_vertices();
+    std::atomic<vtxid_type>* dists = data::mynew_array<std::atomic<vtxid_type>>(nb_vertices);
+    fill_array_par(dists, nb_vertices, unknown);
+    LOG_BASIC(ALGO_PHASE);
+    auto graph_alias = get_alias_of_adjlist(graph);
+    vtxid_type dist = 0;
+    dists[source].store(dist);
+    Frontier prev(graph_alias);
+    Frontier next(graph_alias);
+    typename Frontier::concurrent_type shared_next(graph_alias);
+    prev.push_vertex_back(source);
+    while (! prev.empty()) {
+      dist++;
+      if (prev.nb_outedges() <= our_bfs_cutoff) {
+        prev.for_each_outedge_when_front_and_back_empty([&] (vtxid_type other) {
+          if (ls_pbfs<true>::try_to_set_dist(other, unknown, dist, dists))
+            next.push_vertex_back(other);
+        });
+        prev.clear_when_front_and_back_empty();
+      } else {
+        self_type::process_layer_concurrent(graph_alias, dists, dist, source, prev, shared_next);
+        shared_next.seal(next);
+      }
+      prev.swap(next);
+    }
+    return dists;
+  }
+  
   template <class Adjlist, class Frontier>
   static std::atomic<typename Adjlist::vtxid_type>*
   main_with_swap(const Adjlist& graph,
@@ -15,6 +15,7 @@
 #define _PASL_GRAPH_FRONTIERSEG_H_
 
 #include "chunkedseq.hpp"
+#include "concurrentbag.hpp"
 
 namespace pasl {
 namespace graph {
@@ -446,6 +447,53 @@ public:
     m.set_measure(meas);
   }
   
+  /*---------------------------------------------------------------------*/
+  
+  /* Frontier into which tasks running on different workers may push
+   * vertices at the same time, e.g., all the leaves of the traversal
+   * of a layer of a BFS; `seal` then moves the vertices into a regular
+   * frontier at a cost that depends on the number of workers but not
+   * on the number of vertices.
+   */
+  class concurrent_type {
+  private:
+    
+    graph_type g;
+    data::concurrent_bag<seq_type> vertices;
+    
+  public:
+    
+    concurrent_type(graph_type g)
+    : g(g) {
+      using measure_type = typename cache_type::measure_type;
+      graph_env env(g);
+      measure_type meas(env);
+      vertices.for_each_shard([&] (seq_type& s) {
+        s.set_measure(meas);
+      });
+    }
+    
+    bool empty() const {
+      return vertices.empty();
+    }
+    
+    // same invariant as for frontiersegbase::push_vertex_back
+    void push_vertex_back(vtxid_type v) {
+      if (out_degree_of_vertex(g, v) > 0)
+        vertices.push_back(v);
+    }
+    
+    // moves the vertices into the middle sequence of `dst`, leaving this
+    // frontier empty
+    // pre: back edgelist of `dst` empty
+    void seal(self_type& dst) {
+      assert(dst.b.size() == 0);
+      vertices.seal(dst.m);
+      dst.check();
+    }
+    
+  };
+  
 };
   
 /*---------------------------------------------------------------------*/
@@ -292,6 +292,18 @@ void check_bfs() {
     typeof(get_visited_seq), typeof(get_visited_par), vtxid_type>;
     prop_fpbfs (trusted_bfs, by_fpbfs, get_visited_seq, get_visited_par).check(nb_tests);
   });
+  c.add("our_pbfs_concurrent", [&] {
+    auto by_fpbfs = [&] (const adjlist_type& graph, vtxid_type source) -> std::atomic<vtxid_type>* {
+      vtxid_type nb_vertices = graph.get_nb_vertices();
+      if (nb_vertices == 0)
+        return NULL;
+      return our_bfs<false>::main_with_concurrent_frontier<adjlist_type, frontiersegbag_type>(graph, source);
+    };
+    using prop_fpbfs =
+    prop_search_same<adjlist_type, typeof(trusted_bfs), typeof(by_fpbfs),
+    typeof(get_visited_seq), typeof(get_visited_par), vtxid_type>;
+    prop_fpbfs (trusted_bfs, by_fpbfs, get_visited_seq, get_visited_par).check(nb_tests);
+  });
   c.add("our_lazy_pbfs", [&] {
     auto by_fpbfs = [&] (const adjlist_type& graph, vtxid_type source) -> std::atomic<vtxid_type>* {
       vtxid_type nb_vertices = graph.get_nb_vertices();
@@ -145,6 +145,89 @@ benchmark_type map_incr_bench(bool student_soln = false) {
   return make_benchmark(init, bench, output, destroy);
 }
 
+/* Versions of map_incr and reduce that are scheduled by the loop
+ * engine of the native interface, e.g., to compare the eager and the
+ * lazy splitting of loops with the option `-loop_mode`. The option
+ * `-leaf range` selects the range-based loops, whose leaves are plain
+ * loops, instead of the per-index loops.
+ */
+
+bool native_leaf_by_range() {
+  pasl::util::cmdline::argmap<bool> leaves;
+  leaves.add("index", false);
+  leaves.add("range", true);
+  return leaves.find_by_arg_or_default_key("leaf", "index");
+}
+
+benchmark_type map_incr_native_bench() {
+  long n = pasl::util::cmdline::parse_or_default_long("n", 1l<<20);
+  bool by_range = native_leaf_by_range();
+  sparray* inp = new sparray(0);
+  sparray* outp = new sparray(0);
+  auto init = [=] {
+    *inp = fill(n, 1);
+  };
+  auto bench = [=] {
+    sparray& in = *inp;
+    sparray& out = *outp;
+    out = sparray(in.size());
+    if (by_range) {
+      pasl::sched::native::parallel_for_range(0l, in.size(), [&] (long lo, long hi) {
+        map_seq([] (value_type x) { return x+1; }, &in[lo], &out[lo], hi-lo);
+      });
+    } else {
+      pasl::sched::native::parallel_for(0l, in.size(), [&] (long i) {
+        out[i] = in[i] + 1;
+      });
+    }
+  };
+  auto output = [=] {
+    std::cout << "result " << (*outp)[outp->size()-1] << std::endl;
+  };
+  auto destroy = [=] {
+    delete inp;
+    delete outp;
+  };
+  return make_benchmark(init, bench, output, destroy);
+}
+
+benchmark_type reduce_native_bench() {
+  long n = pasl::util::cmdline::parse_or_default_long("n", 1l<<20);
+  bool by_range = native_leaf_by_range();
+  sparray* inp = new sparray(0);
+  value_type* result = new value_type;
+  auto init = [=] {
+    *inp = fill(n, 1);
+  };
+  auto bench = [=] {
+    sparray& in = *inp;
+    // the loop engine default-constructs the outputs of the subranges
+    struct sum_type { value_type v = 0; };
+    sum_type sum;
+    auto join = [] (sum_type& x, sum_type y) {
+      x.v += y.v;
+    };
+    if (by_range) {
+      pasl::sched::native::combine_range(0l, in.size(), sum, join, [&] (long lo, long hi, sum_type& acc) {
+        acc.v = reduce_seq(plus_fct, identity_fct, acc.v, in, lo, hi);
+      });
+    } else {
+      pasl::sched::native::combine(0l, in.size(), sum, join, [&] (long i, sum_type& acc) {
+        acc.v += in[i];
+      });
+    }
+    *result = sum.v;
+  };
+  auto output = [=] {
+    std::cout << "result " << *result << std::endl;
+  };
+  auto destroy = [=] {
+    delete inp;
+    delete result;
+  };
+  return make_benchmark(init, bench, output, destroy);
+}
+
 benchmark_type duplicate_bench(bool ex = false) {
   long n = pasl::util::cmdline::parse_or_default_long("n", 1l<<20);
   sparray* inp = new sparray(0);
@@ -406,6 +489,8 @@ int main(int argc, char** argv) {
     m.add("mfib",                 [&] { return mfib_bench(); });
     m.add("map_incr",             [&] { return map_incr_bench(); });
     m.add("reduce",               [&] { return reduce_bench(); });
+    m.add("map_incr_native",      [&] { return map_incr_native_bench(); });
+    m.add("reduce_native",        [&] { return reduce_native_bench(); });
     m.add("scan",                 [&] { return scan_bench(); });
     m.add("mcss",                 [&] { return mcss_bench(); });
     m.add("dmdvmult",             [&] { return dmdvmult_bench(); });
@@ -27,7 +27,11 @@ void todo() {
 }
 
 using cmeasure_type = data::estimator::complexity_type;
+#ifdef ESTIMATOR_DISTRIBUTED
 using estimator_type = data::estimator::distributed;
+#else
+using estimator_type = data::estimator::online;
+#endif
 
 class control {};
 
@@ -253,8 +257,12 @@ void cstmt(control_by_prediction& contr,
     c = Sequential;
   else if (m == data::estimator::complexity::undefined)
     c = Parallel;
-  else
-    c = (estimator.predict(std::max(1l, m)) <= kappa) ? Sequential : Parallel;
+  else {
+    // sequentialize only if the task is likely to take less than kappa
+    cost_type bound = estimator.predict_upper(std::max(1l, m));
+    c = (bound <= kappa) ? Sequential : Parallel;
+    LOG_ESTIM_DECIDE(&estimator, m, bound, c == Sequential);
+  }
   if (c == Sequential)
     cstmt_sequential_with_reporting(m, seq_body_fct, estimator);
   else
@@ -358,18 +366,22 @@ public:
   }
 };
 
+/* The body of `parallel_for_range` is applied to whole subranges
+ * `[lo, hi)`, so that the sequential leaves are plain loops that the
+ * compiler can vectorize.
+ */
 template <
   class Granularity_control_policy,
   class Loop_complexity_measure_fct,
   class Number,
   class Body
 >
-void parallel_for(loop_by_eager_binary_splitting<Granularity_control_policy>& lpalgo,
-                  const Loop_complexity_measure_fct& loop_compl_fct,
-                  Number lo, Number hi, const Body& body) {
+void parallel_for_range(loop_by_eager_binary_splitting<Granularity_control_policy>& lpalgo,
+                        const Loop_complexity_measure_fct& loop_compl_fct,
+                        Number lo, Number hi, const Body& body) {
   auto seq_fct = [&] {
-    for (Number i = lo; i < hi; i++)
-      body(i);
+    if (lo < hi)
+      body(lo, hi);
   };
   if (hi - lo < 2) {
     seq_fct();
@@ -379,11 +391,37 @@ void parallel_for(loop_by_eager_binary_splitting<Granularity_control_policy>& lp
     };
     Number mid = (lo + hi) / 2;
     cstmt(lpalgo.gcpolicy, compl_fct,
-          [&]{fork2([&] {parallel_for(lpalgo, loop_compl_fct, lo, mid, body);},
-                    [&] {parallel_for(lpalgo, loop_compl_fct, mid, hi, body);} );},
+          [&]{fork2([&] {parallel_for_range(lpalgo, loop_compl_fct, lo, mid, body);},
+                    [&] {parallel_for_range(lpalgo, loop_compl_fct, mid, hi, body);} );},
           seq_fct);
   }
 }
+
+template <
+  class Granularity_control_policy,
+  class Number,
+  class Body
+>
+void parallel_for_range(loop_by_eager_binary_splitting<Granularity_control_policy>& lpalgo,
+                        Number lo, Number hi, const Body& body) {
+  auto loop_compl_fct = [] (Number lo, Number hi) { return hi-lo; };
+  parallel_for_range(lpalgo, loop_compl_fct, lo, hi, body);
+}
+
+template <
+  class Granularity_control_policy,
+  class Loop_complexity_measure_fct,
+  class Number,
+  class Body
+>
+void parallel_for(loop_by_eager_binary_splitting<Granularity_control_policy>& lpalgo,
+                  const Loop_complexity_measure_fct& loop_compl_fct,
+                  Number lo, Number hi, const Body& body) {
+  parallel_for_range(lpalgo, loop_compl_fct, lo, hi, [&body] (Number lo, Number hi) {
+    for (Number i = lo; i < hi; i++)
+      body(i);
+  });
+}
   
 template <
   class Granularity_control_policy,
@@ -22,6 +22,13 @@ value_type ddotprod(const sparray& m, long r, const sparray& v) {
   return sum(tabulate([&] (long i) { return m[r*n+i] * v[i];}, n));
 }
 
+value_type ddotprod_seq(const value_type* __restrict row, const value_type* __restrict v, long n) {
+  value_type x = 0;
+  for (long i = 0; i < n; i++)
+    x += row[i] * v[i];
+  return x;
+}
+
 loop_controller_type dmdvmult_contr("dmdvmult");
 
 sparray dmdvmult(const sparray& m, const sparray& v) {
@@ -30,8 +37,10 @@ sparray dmdvmult(const sparray& m, const sparray& v) {
   auto compl_fct = [n] (long lo, long hi) {
     return (hi-lo)*n;
   };
-  par::parallel_for(dmdvmult_contr, compl_fct, 0l, n, [&] (long i) {
-    result[i] = ddotprod(m, i, v);
+  par::parallel_for_range(dmdvmult_contr, compl_fct, 0l, n, [&] (long lo, long hi) {
+    const value_type* vs = &v[0];
+    for (long i = lo; i < hi; i++)
+      result[i] = ddotprod_seq(&m[i*n], vs, n);
   });
   return result;
 }
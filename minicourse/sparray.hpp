@@ -370,18 +370,44 @@ template <class Func>
 loop_controller_type tabulate_controller_type<Func>::contr("tabulate"+
                                                            par::string_of_template_arg<Func>());
 
+/* The leaves of the loops below work on raw pointers to the ranges
+ * they are given, so that the inner loops can be vectorized.
+ */
+
 template <class Func>
 sparray tabulate(const Func& f, long n) {
   sparray tmp = sparray(n);
-  par::parallel_for(tabulate_controller_type<Func>::contr, 0l, n, [&] (long i) {
-    tmp[i] = f(i);
+  par::parallel_for_range(tabulate_controller_type<Func>::contr, 0l, n, [&] (long lo, long hi) {
+    value_type* __restrict dst = &tmp[lo];
+    for (long i = lo; i < hi; i++)
+      dst[i-lo] = f(i);
   });
   return tmp;
 }
 
+template <class Func>
+void map_seq(const Func& f, const value_type* __restrict src, value_type* __restrict dst, long n) {
+  for (long i = 0; i < n; i++)
+    dst[i] = f(src[i]);
+}
+
+template <class Func>
+class map_controller_type {
+public:
+  static loop_controller_type contr;
+};
+template <class Func>
+loop_controller_type map_controller_type<Func>::contr("map"+
+                                                      par::string_of_template_arg<Func>());
+
 template <class Func>
 sparray map(const Func& f, const sparray& xs) {
-  return tabulate([&] (long i) { return f(xs[i]); }, xs.size());
+  long n = xs.size();
+  sparray tmp = sparray(n);
+  par::parallel_for_range(map_controller_type<Func>::contr, 0l, n, [&] (long lo, long hi) {
+    map_seq(f, &xs[lo], &tmp[lo], hi-lo);
+  });
+  return tmp;
 }
 
 template <class Func>
@@ -394,8 +420,12 @@ template <class Assoc_op, class Lift_func>
 value_type reduce_seq(const Assoc_op& op, const Lift_func& lift, value_type id, const sparray& xs,
                       long lo, long hi) {
   value_type x = id;
-  for (long i = lo; i < hi; i++)
-    x = op(x, lift(xs[i]));
+  if (hi <= lo)
+    return x;
+  const value_type* __restrict src = &xs[lo];
+  long n = hi - lo;
+  for (long i = 0; i < n; i++)
+    x = op(x, lift(src[i]));
   return x;
 }
 
@@ -512,15 +542,20 @@ template <class Assoc_op, class Lift_func>
 value_type scan_seq(const Assoc_op& op, const Lift_func& lift, value_type id, const sparray& xs,
                     sparray& dest, long lo, long hi, const bool is_excl) {
   value_type x = id;
+  if (hi <= lo)
+    return x;
+  const value_type* __restrict src = &xs[lo];
+  value_type* __restrict dst = &dest[lo];
+  long n = hi - lo;
   if (is_excl) {
-    for (long i = lo; i < hi; i++) {
-      dest[i] = x;
-      x = op(x, lift(xs[i]));
+    for (long i = 0; i < n; i++) {
+      dst[i] = x;
+      x = op(x, lift(src[i]));
     }
   } else {
-    for (long i = lo; i < hi; i++) {
-      x = op(x, lift(xs[i]));
-      dest[i] = x;
+    for (long i = 0; i < n; i++) {
+      x = op(x, lift(src[i]));
+      dst[i] = x;
     }
   }
   return x;
@@ -548,18 +583,22 @@ scan_excl_result scan_rec(const Assoc_op& op, const Lift_func& lift, value_type
       seq();
     } else {
       sparray sums = sparray(m);
-      par::parallel_for(contr_type::lp1, 0l, m, [&] (long i) {
-        long lo = i * k;
-        long hi = std::min(lo + k, n);
-        sums[i] = reduce_seq(op, lift, id, xs, lo, hi);
+      par::parallel_for_range(contr_type::lp1, 0l, m, [&] (long blo, long bhi) {
+        for (long i = blo; i < bhi; i++) {
+          long lo = i * k;
+          long hi = std::min(lo + k, n);
+          sums[i] = reduce_seq(op, lift, id, xs, lo, hi);
+        }
       });
       scan_excl_result scans = scan_rec(op, identity_fct, id, sums, true);
       sums = {};
       result.partials = sparray(n);
-      par::parallel_for(contr_type::lp2, 0l, m, [&] (long i) {
-        long lo = i * k;
-        long hi = std::min(lo + k, n);
-        scan_seq(op, lift, scans.partials[i], xs, result.partials, lo, hi, is_excl);
+      par::parallel_for_range(contr_type::lp2, 0l, m, [&] (long blo, long bhi) {
+        for (long i = blo; i < bhi; i++) {
+          long lo = i * k;
+          long hi = std::min(lo + k, n);
+          scan_seq(op, lift, scans.partials[i], xs, result.partials, lo, hi, is_excl);
+        }
       });
       result.total = scans.total;
     }
@@ -0,0 +1,111 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file concurrentbag.hpp
+ * \brief Bag into which the workers can push items at the same time
+ *
+ */
+
+#include <assert.h>
+#include <memory>
+
+#include "worker.hpp"
+
+#ifndef _PASL_CONCURRENTBAG_H_
+#define _PASL_CONCURRENTBAG_H_
+
+namespace pasl {
+namespace data {
+
+/***********************************************************************/
+
+/*! \brief Multi-producer bag built on a sequential chunked bag
+ *
+ * Each worker pushes into a bag of type `Bag` of its own, so that
+ * pushes take no lock and touch no shared cache line: full chunks
+ * go to the middle sequence of the bag of the worker. `seal` then
+ * concatenates the bags of the workers into a regular `Bag`, in time
+ * proportional to the number of workers (times the logarithmic cost
+ * of `concat` on the middle sequences), independently of the number
+ * of items.
+ *
+ * The bag must be created after the workers are, and `seal` must not
+ * run concurrently with `push_back`.
+ */
+template <class Bag>
+class concurrent_bag {
+public:
+
+  using bag_type = Bag;
+  using value_type = typename bag_type::value_type;
+  using size_type = typename bag_type::size_type;
+
+private:
+
+  static constexpr int cache_line_szb = 64;
+
+  class shard_type {
+  public:
+    bag_type bag;
+    // keeps the buffers of neighboring shards on distinct cache lines
+    char padding[cache_line_szb];
+  };
+
+  int nb_shards;
+  std::unique_ptr<shard_type[]> shards;
+
+public:
+
+  concurrent_bag()
+  : nb_shards(util::worker::get_nb()),
+    shards(new shard_type[nb_shards]) { }
+
+  //! Bag of the calling worker
+  bag_type& mine() {
+    int id = util::worker::get_my_id();
+    assert(id >= 0 && id < nb_shards);
+    return shards[id].bag;
+  }
+
+  //! May be called concurrently by tasks running on different workers
+  void push_back(const value_type& x) {
+    mine().push_back(x);
+  }
+
+  bool empty() const {
+    for (int i = 0; i < nb_shards; i++)
+      if (! shards[i].bag.empty())
+        return false;
+    return true;
+  }
+
+  size_type size() const {
+    size_type sz = 0;
+    for (int i = 0; i < nb_shards; i++)
+      sz += shards[i].bag.size();
+    return sz;
+  }
+
+  //! Applies `f` to the bag of each worker, e.g., to set its measure
+  template <class Body>
+  void for_each_shard(const Body& f) {
+    for (int i = 0; i < nb_shards; i++)
+      f(shards[i].bag);
+  }
+
+  //! Moves all the items into the back of `dst`, leaving this bag empty
+  void seal(bag_type& dst) {
+    for (int i = 0; i < nb_shards; i++)
+      dst.concat(shards[i].bag);
+    assert(empty());
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_CONCURRENTBAG_H_ */
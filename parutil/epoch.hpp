@@ -0,0 +1,113 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file epoch.hpp
+ * \brief Epoch-based reclamation of memory shared between threads
+ *
+ */
+
+#ifndef _PASL_UTIL_EPOCH_H_
+#define _PASL_UTIL_EPOCH_H_
+
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace pasl {
+namespace util {
+namespace epoch {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/*! \class manager
+ *  \brief Tracks which participants may hold references to retired
+ *  memory.
+ *
+ * A participant that is about to read a shared pointer whose target
+ * may be retired concurrently brackets the access with `enter` and
+ * `exit`. A block of memory that is unlinked at global epoch `e`
+ * (as returned by `advance`) can be freed as soon as `safe(e)`
+ * returns true, that is, once every participant is either outside
+ * of its critical section or has entered it after the unlink.
+ *
+ * Participants are identified by integers in `[0, nb_participants)`.
+ */
+class manager {
+public:
+
+  using epoch_type = uint64_t;
+
+  static constexpr epoch_type quiescent = std::numeric_limits<epoch_type>::max();
+
+private:
+
+  static constexpr int padding_szb = 128;
+
+  struct slot_type {
+    std::atomic<epoch_type> e;
+    char padding[padding_szb - sizeof(std::atomic<epoch_type>)];
+  };
+
+  char padding1[padding_szb];
+  std::atomic<epoch_type> global;
+  char padding2[padding_szb];
+  std::vector<slot_type> slots;
+
+public:
+
+  manager() {
+    global.store(1);
+  }
+
+  void init(int nb_participants) {
+    slots = std::vector<slot_type>(nb_participants);
+    for (int i = 0; i < nb_participants; i++)
+      slots[i].e.store(quiescent);
+  }
+
+  int get_nb_participants() const {
+    return (int)slots.size();
+  }
+
+  //! Announces that participant `id` may start reading shared pointers
+  void enter(int id) {
+    assert(id >= 0 && id < get_nb_participants());
+    slots[id].e.store(global.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // the announcement must be visible before any shared pointer is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  //! Announces that participant `id` holds no more shared pointers
+  void exit(int id) {
+    slots[id].e.store(quiescent, std::memory_order_release);
+  }
+
+  /*! \brief To be called after a block has been unlinked; returns the
+   *  epoch to pass to `safe`.
+   */
+  epoch_type advance() {
+    return global.fetch_add(1, std::memory_order_seq_cst) + 1;
+  }
+
+  //! Returns true if no participant can still see a block retired at `e`
+  bool safe(epoch_type e) const {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (size_t i = 0; i < slots.size(); i++)
+      if (slots[i].e.load(std::memory_order_acquire) < e)
+        return false;
+    return true;
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_UTIL_EPOCH_H_ */
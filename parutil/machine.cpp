@@ -27,6 +27,7 @@ struct cpuinfo_t {
   float cpu_frequency_mhz;
   int   nb_cpus;
   int   cache_line_szb;
+  char  model[256];
 };
 
 /*---------------------------------------------------------------------*/
@@ -34,6 +35,7 @@ struct cpuinfo_t {
 
 int              cache_line_szb = 0;
 double           cpu_frequency_ghz;
+std::string      cpu_model;
 #ifdef HAVE_HWLOC
 hwloc_topology_t topology;
 #endif
@@ -61,7 +63,7 @@ hyperthreading_mode_t htmode_of_string(std::string s) {
 }
 
 static struct cpuinfo_t mine_cpuinfo () {
-  struct cpuinfo_t cpuinfo = { 0., 0, 0 };
+  struct cpuinfo_t cpuinfo = { 0., 0, 0, "unknown" };
 #ifdef TARGET_LINUX
   /* Get information from /proc/cpuinfo.  The interesting
    * fields are:
@@ -69,6 +71,8 @@ static struct cpuinfo_t mine_cpuinfo () {
    * cpu MHz         : <float>             # cpu frequency in MHz
    *
    * cache_alignment : <int>               # cache alignment in bytes
+   *
+   * model name      : <string>            # cpu model
    */
   FILE *cpuinfo_file = fopen("/proc/cpuinfo", "r");
   char buf[1024];
@@ -79,6 +83,8 @@ static struct cpuinfo_t mine_cpuinfo () {
         cpuinfo.nb_cpus++;
       } else if (sscanf(buf, "cache_alignment : %d", &cache_line_szb) == 1) {
         cpuinfo.cache_line_szb = cache_line_szb;
+      } else if (sscanf(buf, "model name : %255[^\n]", cpuinfo.model) == 1) {
+        // keep the name
       }
     }
     fclose (cpuinfo_file);
@@ -104,6 +110,10 @@ static struct cpuinfo_t mine_cpuinfo () {
     perror("sysctl");
   }
   cpuinfo.cache_line_szb = (int)cache_lineszb;
+  size = sizeof(cpuinfo.model);
+  if (sysctlbyname("machdep.cpu.brand_string", cpuinfo.model, &size, NULL, 0) < 0) {
+    perror("sysctl");
+  }
 #endif
   if (cpuinfo.cpu_frequency_mhz == 0.) {
     atomic::die("Failed to read CPU frequency\n");
@@ -142,6 +152,7 @@ void init(hyperthreading_mode_t _htmode) {
   struct cpuinfo_t cpuinfo = mine_cpuinfo ();
   cache_line_szb = cpuinfo.cache_line_szb;
   cpu_frequency_ghz = (double)(cpuinfo.cpu_frequency_mhz / 1000.0);
+  cpu_model = std::string(cpuinfo.model);
   ticks::set_ticks_per_seconds(cpuinfo.cpu_frequency_mhz * 1000000.);
 
 #ifdef HAVE_HWLOC
@@ -391,6 +402,13 @@ hwloc_nodeset_t binding_policy::nodeset_of_worker(worker_id_t my_id_or_undef) {
   hwloc_cpuset_to_nodeset(topology, cpuset, nodeset);
   return nodeset;
 }
+
+int binding_policy::core_of_worker(worker_id_t my_id) {
+  hwloc_obj_t obj = hwloc_get_obj_covering_cpuset(topology, cpusets[(int)my_id]);
+  while (obj != NULL && obj->type != HWLOC_OBJ_CORE)
+    obj = obj->parent;
+  return (obj == NULL) ? -1 : (int)obj->logical_index;
+}
 #endif
 
 /*---------------------------------------------------------------------*/
@@ -425,6 +443,11 @@ void numa::init(int nb_workers) {
     nodes[id] = node_id;
     max_node_id = std::max(node_id, max_node_id);
   }
+  cores.assign(nb_workers, core_undef);
+#ifdef HAVE_HWLOC
+  for (worker_id_t id = 0; id < nb_workers; id++)
+    cores[id] = bpol->core_of_worker(id);
+#endif
   nb_nodes = max_node_id + 1;
   //-----------------
   nb_workers_per_node = new int[nb_nodes];
@@ -487,6 +510,10 @@ int numa::rank_of_worker(worker_id_t id) {
   return node_ranks[id];
 }
 
+core_id_t numa::core_of_worker(worker_id_t id) {
+  return cores[id];
+}
+
 worker_id_t numa::worker_of_rank(node_id_t node, int rank) {
   worker_set_t& set = node_info[node];
   return set[rank];
@@ -11,6 +11,7 @@
 #define _PASL_UTIL_MACHINE_H_
 
 #include <vector>
+#include <string>
 #ifdef HAVE_HWLOC
 #include <hwloc.h>
 #else
@@ -34,6 +35,9 @@ extern int cache_line_szb;
 /* \brief CPU frequency in gigaherz */
 extern double cpu_frequency_ghz;
 
+/* \brief CPU model name, as reported by the operating system */
+extern std::string cpu_model;
+
 #ifdef HAVE_HWLOC
 extern hwloc_topology_t    topology;
 #endif
@@ -92,6 +96,10 @@ public:
    * by calling hwloc_bitmap_free().
    */
   hwloc_nodeset_t nodeset_of_worker(worker_id_t my_id_or_undef);
+  /* \brief Returns the logical index of the core to which the given
+   * worker is bound, or -1 if the worker may execute on several cores.
+   */
+  int core_of_worker(worker_id_t my_id);
 #endif
 
 protected:
@@ -119,6 +127,11 @@ typedef int node_id_t;
   
 const node_id_t node_undef = -1;
 
+//! Core id
+typedef int core_id_t;
+
+const core_id_t core_undef = -1;
+
   //! \todo document
 
 /*! \class numa
@@ -138,6 +151,7 @@ private:
   typedef std::vector<worker_id_t> worker_set_t;
   typedef std::vector<worker_set_t> node_info_t;
   node_info_t node_info;
+  std::vector<core_id_t> cores;
   
 public:
   /*! \note Equivalent to `numa(the_bindpolicy)` */
@@ -163,6 +177,14 @@ public:
    *  node. 
    */
   int rank_of_worker(worker_id_t id);
+  /*! \brief Returns the core to which the given worker is bound.
+   *
+   * The return value is `core_undef` if the worker is not bound to a
+   * single core, which is always the case when PASL is built without
+   * hwloc. Two workers that are bound to the same core are
+   * hyperthread siblings.
+   */
+  core_id_t core_of_worker(worker_id_t id);
   /*! \brief Returns the id of the worker at the given position */
   worker_id_t worker_of_rank(node_id_t node, int rank);
   /*! \brief Returns the number of workers bound to the given node.
@@ -8,8 +8,15 @@
  */
 
 #include <utility>
+#include <typeinfo>
+#include <vector>
+#include <algorithm>
 
 #include "native.hpp"
+#include "estimator.hpp"
+#include "ticks.hpp"
+#include "stats.hpp"
+#include "logging.hpp"
 #include "container.hpp"
 #include "chunkedseq.hpp"
 #include "chunkedbag.hpp"
@@ -54,47 +61,389 @@ using ftree_bag = chunkedseq::ftree::bagopt<Item, chunk_capacity>;
   
 //--------------------------
   
+/*---------------------------------------------------------------------*/
+/* Granularity control */
+
+/* The parallel traversals below are controlled by prediction, in the
+ * same way as `cstmt`: a range of items is processed sequentially if
+ * its predicted running time is below `kappa`, and the time taken by
+ * each sequential run is reported to the estimator.
+ *
+ * There is one estimator for each operation, type of container and
+ * type of body. The complexity of a range is its number of items plus
+ * the number of segments that it spans, so that the constant learned
+ * by the estimator accounts for both the cost per item and the cost
+ * per chunk. Where the segments are not known yet, their number is
+ * bounded using the chunk capacity of the container itself.
+ */
+
+using estimator_type = estimator::online;
+using complexity_type = estimator::complexity_type;
+using cost_type = estimator::cost_type;
+
+template <class Operation, class Container, class Body>
+class controller_type {
+public:
+  static estimator_type estim;
+};
+template <class Operation, class Container, class Body>
+estimator_type controller_type<Operation,Container,Body>::estim(std::string(Operation::name())+
+                                                               std::string(typeid(Container).name())+
+                                                               std::string(typeid(Body).name()));
+
+static inline complexity_type complexity_of(size_t nb_items, size_t nb_segments) {
+  return (complexity_type)(nb_items + nb_segments);
+}
+
+//! Number of chunks of `Container` needed to store `nb` items
+template <class Container>
+size_t nb_segments_of_nb_items(size_t nb) {
+  size_t capacity = size_t(Container::config_type::chunk_capacity);
+  return (nb + capacity - 1) / capacity;
+}
+
+static inline bool is_sequential(estimator_type& estim, size_t nb_items, size_t nb_segments) {
+  if (nb_items <= 1)
+    return true;
+  complexity_type comp = complexity_of(nb_items, nb_segments);
+  cost_type bound = estim.predict_upper(comp);
+  bool sequential = (bound <= kappa);
+  LOG_ESTIM_DECIDE(&estim, comp, bound, sequential);
+  return sequential;
+}
+
+template <class Seq_body>
+void run_sequential_with_reporting(estimator_type& estim, size_t nb_items, size_t nb_segments,
+                                   const Seq_body& seq_body) {
+  if (nb_items == 0) {
+    seq_body();
+    return;
+  }
+  cost_type start = util::ticks::now();
+  seq_body();
+  cost_type elapsed = util::ticks::since(start);
+  estim.report(std::max(complexity_type(1), complexity_of(nb_items, nb_segments)), elapsed);
+  STAT_COUNT(MEASURED_RUN);
+}
+
+/*---------------------------------------------------------------------*/
+/* Splitting by item index */
+
+/* The parallel traversals split ranges of item indices, as `split`
+ * does on the container: the iterator `cont.begin() + i` is found by a
+ * search that descends the middle sequence guided by its cached sizes,
+ * in time logarithmic in the number of chunks. Each sequential piece
+ * then visits the segments of its own range, and no chunk is ever
+ * copied or rebalanced, as a `split` of the container would do.
+ */
+
+//! Applies `body(lo, hi)` to the segments of the items `[lo, hi)` of `cont`
 template <class Container, class Body>
-void for_each_segment(const Container& cont, const Body& body) {
-  using size_type = typename Container::size_type;
-  using iterator_type = typename Container::iterator;
-  using segment_type = typename Container::segment_type;
-  using input_type = std::pair<iterator_type, iterator_type>;
-  auto cutoff = [] (const input_type& in) {
-    size_type sz_beg = in.first.size();
-    size_type sz_end = in.second.size();
-    return sz_end - sz_beg <= size_type(native::loop_cutoff);
+void for_each_segment_in_range(const Container& cont, size_t lo, size_t hi, const Body& body) {
+  if (lo >= hi)
+    return;
+  cont.for_each_segment(cont.begin() + lo, cont.begin() + hi, body);
+}
+
+/*! \brief Applies `body(b, lo, hi)` to the pieces of the segments of
+ *  the items `[lo, hi)` of `cont`, cut at multiples of `block`, where
+ *  `b` is the index of the block of the piece; the segments are
+ *  visited in a single walk.
+ */
+template <class Container, class Body>
+void for_each_block_piece(const Container& cont, size_t block, size_t lo, size_t hi,
+                          const Body& body) {
+  using value_type = typename Container::value_type;
+  size_t i = lo;
+  for_each_segment_in_range(cont, lo, hi, [&] (value_type* p, value_type* end) {
+    while (p < end) {
+      size_t b = i / block;
+      size_t m = std::min(size_t(end - p), (b + 1) * block - i);
+      body(b, p, p + m);
+      i += m;
+      p += m;
+    }
+  });
+}
+
+/*! \brief Splits the range of item indices `[0, nb)` in halves, at
+ *  multiples of `grain`, until the halves are predicted to be small,
+ *  then applies `body(lo, hi, out)` to each range `[lo, hi)` obtained
+ *  this way; `lo` is always a multiple of `grain`.
+ */
+template <class Container, class Output, class Set_out_env, class Join_output, class Body>
+void forkjoin_over_items(estimator_type& estim, size_t nb, size_t grain, Output& out,
+                         const Set_out_env& set_out_env, const Join_output& join,
+                         const Body& body) {
+  using input_type = std::pair<size_t, size_t>;
+  auto cutoff = [&] (const input_type& in) {
+    size_t nb = in.second - in.first;
+    return nb <= grain || is_sequential(estim, nb, nb_segments_of_nb_items<Container>(nb));
   };
   auto split = [&] (input_type& src, input_type& dst) {
-    size_type sz_beg = src.first.size();
-    size_type sz_end = src.second.size();
-    iterator_type mid = cont.begin() + ((sz_beg + sz_end) / 2);
+    size_t nb_grains = (src.second - src.first + grain - 1) / grain;
+    size_t mid = src.first + (nb_grains / 2) * grain;
     dst.first = mid;
     dst.second = src.second;
     src.second = mid;
   };
+  auto set_in_env = [] (input_type&) { };
+  auto _body = [&] (input_type& in, Output& out) {
+    size_t nb = in.second - in.first;
+    run_sequential_with_reporting(estim, nb, nb_segments_of_nb_items<Container>(nb), [&] {
+      body(in.first, in.second, out);
+    });
+  };
+  input_type in(0, nb);
+  native::forkjoin(in, out, cutoff, split, join, set_in_env, set_out_env, _body);
+}
+
+/* Applies `body(lo, hi, out)` to the segments `[lo, hi)` of `cont`, in
+ * parallel; if the whole container is predicted to be small, its
+ * segments are visited in one pass, without any search.
+ */
+template <class Container, class Output, class Set_out_env, class Join_output, class Body>
+void forkjoin_by_prediction(estimator_type& estim, const Container& cont, Output& out,
+                            const Set_out_env& set_out_env, const Join_output& join,
+                            const Body& body) {
+  using value_type = typename Container::value_type;
+  size_t nb = size_t(cont.size());
+  size_t nb_segments = nb_segments_of_nb_items<Container>(nb);
+  if (is_sequential(estim, nb, nb_segments)) {
+    run_sequential_with_reporting(estim, nb, nb_segments, [&] {
+      cont.for_each_segment([&] (value_type* lo, value_type* hi) {
+        body(lo, hi, out);
+      });
+    });
+    return;
+  }
+  forkjoin_over_items<Container>(estim, nb, 1, out, set_out_env, join,
+                                 [&] (size_t lo, size_t hi, Output& out) {
+    for_each_segment_in_range(cont, lo, hi, [&] (value_type* lo, value_type* hi) {
+      body(lo, hi, out);
+    });
+  });
+}
+
+class for_each_segment_operation {
+public:
+  static const char* name() { return "pcontainer_for_each_segment"; }
+};
+
+class reduce_operation {
+public:
+  static const char* name() { return "pcontainer_reduce"; }
+};
+
+class scan_operation {
+public:
+  static const char* name() { return "pcontainer_scan"; }
+};
+
+class filter_operation {
+public:
+  static const char* name() { return "pcontainer_filter"; }
+};
+
+class tabulate_operation {
+public:
+  static const char* name() { return "pcontainer_tabulate"; }
+};
+
+class transfer_operation {
+public:
+  static const char* name() { return "pcontainer_transfer"; }
+};
+
+/*---------------------------------------------------------------------*/
+/* Parallel traversals */
+
+template <class Container, class Body>
+void for_each_segment(const Container& cont, const Body& body) {
+  using value_type = typename Container::value_type;
+  using contr_type = controller_type<for_each_segment_operation, Container, Body>;
   struct { } dummy;
   using dummy_type = typeof(dummy);
+  auto set_out_env = [] (dummy_type&) { };
   auto join = [] (dummy_type, dummy_type) { };
-  auto _body = [&] (input_type& in, dummy_type& out) {
-    iterator_type beg = in.first;
-    iterator_type end = in.second;
-    cont.for_each_segment(beg, end, body);
-  };
-  input_type in(cont.begin(), cont.end());
-  native::forkjoin(in, dummy, cutoff, split, join, _body);
+  forkjoin_by_prediction(contr_type::estim, cont, dummy, set_out_env, join,
+                         [&] (value_type* lo, value_type* hi, dummy_type&) {
+    body(lo, hi);
+  });
 }
 
 template <class Container, class Body>
 void for_each(const Container& cont, const Body& body) {
-  using size_type = typename Container::size_type;
   using value_type = typename Container::value_type;
-  using segment_type = typename Container::segment_type;
   for_each_segment(cont, [&] (value_type* lo, value_type* hi) {
-    for (value_type* p = lo; lo < hi; p++)
+    for (value_type* p = lo; p < hi; p++)
       body(*p);
   });
 }
+
+/*! \brief Returns the combination of the items of `cont` by the
+ *  associative operator `combine`, whose identity is `id`.
+ */
+template <class Container, class Result, class Combine>
+Result reduce(const Container& cont, Result id, const Combine& combine) {
+  using value_type = typename Container::value_type;
+  using contr_type = controller_type<reduce_operation, Container, Combine>;
+  Result result = id;
+  auto set_out_env = [&] (Result& out) {
+    out = id;
+  };
+  auto join = [&] (Result& out1, Result& out2) {
+    out1 = combine(out1, out2);
+  };
+  forkjoin_by_prediction(contr_type::estim, cont, result, set_out_env, join,
+                         [&] (value_type* lo, value_type* hi, Result& out) {
+    for (value_type* p = lo; p < hi; p++)
+      out = combine(out, *p);
+  });
+  return result;
+}
+
+/*! \brief Replaces, in place, each item of `cont` by the combination
+ *  of the items that precede it, and returns the combination of all
+ *  the items; `combine` is associative and its identity is `id`.
+ *
+ * Like `pbbs::sequence::scan`, the scan is exclusive. The items are
+ * cut into blocks of equal size, the largest that is predicted to be
+ * small but no smaller than a chunk, and the scan takes two passes over the blocks: the first
+ * computes the combination of each block, and the second, after a
+ * sequential scan of these combinations, rewrites the items of each
+ * block.
+ */
+template <class Container, class Combine>
+typename Container::value_type scan(Container& cont, typename Container::value_type id,
+                                    const Combine& combine) {
+  using value_type = typename Container::value_type;
+  using contr_type = controller_type<scan_operation, Container, Combine>;
+  estimator_type& estim = contr_type::estim;
+  auto scan_segment = [&] (value_type* lo, value_type* hi, value_type acc) {
+    for (value_type* p = lo; p < hi; p++) {
+      value_type v = *p;
+      *p = acc;
+      acc = combine(acc, v);
+    }
+    return acc;
+  };
+  size_t nb = size_t(cont.size());
+  if (is_sequential(estim, nb, nb_segments_of_nb_items<Container>(nb))) {
+    value_type acc = id;
+    run_sequential_with_reporting(estim, nb, nb_segments_of_nb_items<Container>(nb), [&] {
+      cont.for_each_segment([&] (value_type* lo, value_type* hi) {
+        acc = scan_segment(lo, hi, acc);
+      });
+    });
+    return acc;
+  }
+  // a block spans at least one chunk, even if the estimator does not
+  // know its constant yet
+  size_t min_block = size_t(Container::config_type::chunk_capacity);
+  size_t block = nb;
+  while (block > min_block && ! is_sequential(estim, block, nb_segments_of_nb_items<Container>(block)))
+    block = std::max(min_block, (block + 1) / 2);
+  size_t nb_blocks = (nb + block - 1) / block;
+  std::vector<value_type> sums(nb_blocks, id);
+  struct { } dummy;
+  using dummy_type = typeof(dummy);
+  auto set_out_env = [] (dummy_type&) { };
+  auto join = [] (dummy_type, dummy_type) { };
+  forkjoin_over_items<Container>(estim, nb, block, dummy, set_out_env, join,
+                                 [&] (size_t lo, size_t hi, dummy_type&) {
+    for_each_block_piece(cont, block, lo, hi, [&] (size_t b, value_type* lo, value_type* hi) {
+      value_type acc = sums[b];
+      for (value_type* p = lo; p < hi; p++)
+        acc = combine(acc, *p);
+      sums[b] = acc;
+    });
+  });
+  value_type total = id;
+  for (size_t b = 0; b < nb_blocks; b++) {
+    value_type v = sums[b];
+    sums[b] = total;
+    total = combine(total, v);
+  }
+  forkjoin_over_items<Container>(estim, nb, block, dummy, set_out_env, join,
+                                 [&] (size_t lo, size_t hi, dummy_type&) {
+    for_each_block_piece(cont, block, lo, hi, [&] (size_t b, value_type* lo, value_type* hi) {
+      sums[b] = scan_segment(lo, hi, sums[b]);
+    });
+  });
+  return total;
+}
+
+/*! \brief Pushes on the back of `dst` the items of `src` that satisfy
+ *  `pred`; if the container is a sequence, the items keep the order
+ *  in which they appear in `src`.
+ */
+template <class Container, class Pred>
+void filter(const Container& src, Container& dst, const Pred& pred) {
+  using value_type = typename Container::value_type;
+  using contr_type = controller_type<filter_operation, Container, Pred>;
+  Container kept;
+  auto set_out_env = [] (Container&) { };
+  auto join = [] (Container& out1, Container& out2) {
+    out1.concat(out2);
+  };
+  forkjoin_by_prediction(contr_type::estim, src, kept, set_out_env, join,
+                         [&] (value_type* lo, value_type* hi, Container& out) {
+    for (value_type* p = lo; p < hi; p++)
+      if (pred(*p))
+        out.push_back(*p);
+  });
+  dst.concat(kept);
+}
+
+/*! \brief Pushes on the back of `dst` the items `body(0)`, ...,
+ *  `body(n-1)`, in this order.
+ *
+ * The range of indices is split in halves until the halves are
+ * predicted to be small; each half is built in a container of its own
+ * by whole chunks, and the containers are joined by `concat`, so that
+ * the middle sequence of the result is assembled in logarithmic time
+ * per join. The items must be default constructible.
+ */
+template <class Container, class Body>
+void tabulate(size_t n, Container& dst, const Body& body) {
+  using value_type = typename Container::value_type;
+  using const_pointer = typename Container::const_pointer;
+  using contr_type = controller_type<tabulate_operation, Container, Body>;
+  using input_type = std::pair<size_t, size_t>;
+  estimator_type& estim = contr_type::estim;
+  auto cutoff = [&] (const input_type& in) {
+    size_t nb = in.second - in.first;
+    return is_sequential(estim, nb, nb_segments_of_nb_items<Container>(nb));
+  };
+  auto split = [] (input_type& src, input_type& dst) {
+    size_t mid = (src.first + src.second) / 2;
+    dst.first = mid;
+    dst.second = src.second;
+    src.second = mid;
+  };
+  auto join = [] (Container& out1, Container& out2) {
+    out1.concat(out2);
+  };
+  auto _body = [&] (input_type& in, Container& out) {
+    size_t nb = in.second - in.first;
+    run_sequential_with_reporting(estim, nb, nb_segments_of_nb_items<Container>(nb), [&] {
+      // `m` is bounded by the chunk capacity of `Container`
+      std::vector<value_type> buffer;
+      out.stream_pushn_back([&] (size_t i, size_t m) {
+        if (buffer.size() < m)
+          buffer.resize(m);
+        for (size_t k = 0; k < m; k++)
+          buffer[k] = body(in.first + i + k);
+        return std::pair<const_pointer, const_pointer>(buffer.data(), buffer.data() + m);
+      }, nb);
+    });
+  };
+  Container built;
+  input_type in(0, n);
+  native::forkjoin(in, built, cutoff, split, join, _body);
+  dst.concat(built);
+}
   
 template <class Item, class Body>
 void for_each(const stl::deque_seq<Item>& cont, const Body& body) {
@@ -133,8 +482,11 @@ void transfer_contents_to_array(Container_src& src, Pointer dst) {
   };
   struct { } dummy;
   using dummy_type = typeof(dummy);
-  auto cutoff = [] (input_type& f) {
-    return f.first->size() <= size_type(native::loop_cutoff);
+  using contr_type = controller_type<transfer_operation, Container_src, Pointer>;
+  estimator_type& estim = contr_type::estim;
+  auto cutoff = [&] (input_type& f) {
+    size_t nb = size_t(f.first->size());
+    return is_sequential(estim, nb, nb_segments_of_nb_items<Container_src>(nb));
   };
   auto split = [] (input_type& src, input_type& dst) {
     size_type m = src.first->size() / 2;
@@ -143,7 +495,11 @@ void transfer_contents_to_array(Container_src& src, Pointer dst) {
   };
   auto join = [] (dummy_type, dummy_type) { };
   auto body = [&] (input_type& in, dummy_type& out) {
-    in.first->popn_back(in.second, in.first->size());
+    size_type nb = in.first->size();
+    run_sequential_with_reporting(estim, size_t(nb),
+                                  nb_segments_of_nb_items<Container_src>(size_t(nb)), [&] {
+      in.first->popn_back(in.second, nb);
+    });
   };
   input_type in(&src, dst);
   native::forkjoin(in, dummy, cutoff, split, join, body);
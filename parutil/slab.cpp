@@ -0,0 +1,109 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file slab.cpp
+ *
+ */
+
+#include <assert.h>
+
+#include "slab.hpp"
+#include "atomic.hpp"
+
+namespace pasl {
+namespace util {
+namespace slab {
+
+/***********************************************************************/
+
+data::perworker::extra<heap> heaps;
+
+heap::heap() {
+  for (int c = 0; c < nb_classes; c++) {
+    local[c] = nullptr;
+    remote[c].store(nullptr);
+  }
+  chunk_cur = nullptr;
+  chunk_end = nullptr;
+  counters = { 0, 0, 0, 0, 0 };
+}
+
+void* heap::refill(worker_id_t my_id, int size_class) {
+  free_block* b = remote[size_class].exchange(nullptr, std::memory_order_acquire);
+  if (b != nullptr) {
+    local[size_class] = b->next;
+    return b;
+  }
+  size_t szb = sizeof(header_t) + granularity * (size_class + 1);
+  if (chunk_cur + szb > chunk_end) {
+    // the tail of the previous chunk is lost
+    chunk_cur = (char*)malloc(chunk_szb);
+    if (chunk_cur == nullptr)
+      atomic::die("slab: failed to allocate a chunk\n");
+    chunk_end = chunk_cur + chunk_szb;
+    counters.nb_chunks++;
+  }
+  header_t* h = (header_t*)chunk_cur;
+  chunk_cur += szb;
+  h->owner = my_id;
+  h->size_class = size_class;
+  return h + 1;
+}
+
+void heap::free_remote(free_block* b, int size_class) {
+  std::atomic<free_block*>& r = remote[size_class];
+  free_block* head = r.load(std::memory_order_relaxed);
+  do {
+    b->next = head;
+  } while (! r.compare_exchange_weak(head, b, std::memory_order_release,
+                                     std::memory_order_relaxed));
+}
+
+void* heap::alloc_large(worker_id_t my_id, size_t szb) {
+  counters.nb_large++;
+  header_t* h = (header_t*)malloc(sizeof(header_t) + szb);
+  if (h == nullptr)
+    atomic::die("slab: failed to allocate %lu bytes\n", (unsigned long)szb);
+  h->owner = my_id;
+  h->size_class = large_class;
+  return h + 1;
+}
+
+void* alloc_system(size_t szb) {
+  heap::header_t* h = (heap::header_t*)malloc(sizeof(heap::header_t) + szb);
+  if (h == nullptr)
+    atomic::die("slab: failed to allocate %lu bytes\n", (unsigned long)szb);
+  h->owner = worker::undef;
+  h->size_class = heap::large_class;
+  return h + 1;
+}
+
+/*---------------------------------------------------------------------*/
+
+heap::counters_t sum_counters() {
+  heap::counters_t total = { 0, 0, 0, 0, 0 };
+  heaps.for_each([&] (worker_id_t, heap& h) {
+    total.nb_alloc += h.counters.nb_alloc;
+    total.nb_free_local += h.counters.nb_free_local;
+    total.nb_free_remote += h.counters.nb_free_remote;
+    total.nb_large += h.counters.nb_large;
+    total.nb_chunks += h.counters.nb_chunks;
+  });
+  return total;
+}
+
+void print_counters(FILE* f) {
+  heap::counters_t total = sum_counters();
+  fprintf(f, "slab_alloc\t%ld\n", (long)total.nb_alloc);
+  fprintf(f, "slab_free_local\t%ld\n", (long)total.nb_free_local);
+  fprintf(f, "slab_free_remote\t%ld\n", (long)total.nb_free_remote);
+  fprintf(f, "slab_large\t%ld\n", (long)total.nb_large);
+  fprintf(f, "slab_chunks\t%ld\n", (long)total.nb_chunks);
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
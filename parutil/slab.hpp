@@ -0,0 +1,213 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file slab.hpp
+ * \brief Per-worker size-class allocator for small, short-lived objects
+ *
+ */
+
+#ifndef _PASL_UTIL_SLAB_H_
+#define _PASL_UTIL_SLAB_H_
+
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "worker.hpp"
+#include "workerlocal.hpp"
+
+namespace pasl {
+namespace util {
+namespace slab {
+
+/***********************************************************************/
+
+//! Block sizes are multiples of this number of bytes
+static constexpr size_t granularity = 16;
+//! Number of size classes; larger requests go to the system allocator
+static constexpr int nb_classes = 32;
+//! Largest request that is served from a size class
+static constexpr size_t max_block_szb = granularity * nb_classes;
+//! Number of bytes requested to the system allocator at once
+static constexpr size_t chunk_szb = 64 * 1024;
+
+/*---------------------------------------------------------------------*/
+/*! \class heap
+ *  \brief The blocks owned by one worker.
+ *
+ * Every block is preceded by a header that stores the id of the
+ * worker whose heap the block was carved from, called its owner, and
+ * its size class. A block that is freed by its owner is pushed on the
+ * local free list of its class. A block that is freed by another
+ * worker is pushed on the remote free list of its class, with a
+ * compare-and-swap; the owner takes the whole remote list at once
+ * when its local list runs dry, so that only the owner ever pops from
+ * a remote list.
+ *
+ * The memory of a heap is never given back to the system.
+ */
+class heap {
+public:
+
+  struct header_t {
+    worker_id_t owner;
+    int64_t size_class;
+  };
+
+  struct free_block {
+    free_block* next;
+  };
+
+  struct counters_t {
+    uint64_t nb_alloc;
+    uint64_t nb_free_local;
+    uint64_t nb_free_remote;
+    uint64_t nb_large;
+    uint64_t nb_chunks;
+  };
+
+  static constexpr int64_t large_class = -1;
+
+private:
+
+  free_block* local[nb_classes];
+  std::atomic<free_block*> remote[nb_classes];
+  char* chunk_cur;
+  char* chunk_end;
+
+  void* refill(worker_id_t my_id, int size_class);
+
+public:
+
+  counters_t counters;
+
+  heap();
+
+  void* alloc(worker_id_t my_id, int size_class) {
+    counters.nb_alloc++;
+    free_block* b = local[size_class];
+    if (b == nullptr)
+      return refill(my_id, size_class);
+    local[size_class] = b->next;
+    return b;
+  }
+
+  void free_local(free_block* b, int size_class) {
+    counters.nb_free_local++;
+    b->next = local[size_class];
+    local[size_class] = b;
+  }
+
+  void free_remote(free_block* b, int size_class);
+
+  void* alloc_large(worker_id_t my_id, size_t szb);
+
+};
+
+static_assert(sizeof(heap::header_t) == granularity,
+              "slab header must keep blocks aligned");
+
+/* The heap of a thread is selected by the worker id stored in its
+ * thread-local storage. The threads that are not workers, e.g., the
+ * thread that initializes PASL, before the launch of the workers, or
+ * helper threads, get the id `worker::undef`; they have no heap, and
+ * take their blocks from the system allocator.
+ */
+extern data::perworker::extra<heap> heaps;
+
+//! Returns a block from the system allocator, for a thread that is not a worker
+void* alloc_system(size_t szb);
+
+/*---------------------------------------------------------------------*/
+
+/*! \brief Returns a block of at least `szb` bytes, aligned on
+ *  `granularity` bytes
+ */
+static inline void* alloc(size_t szb) {
+  worker_id_t my_id = worker::get_my_id();
+  if (my_id == worker::undef)
+    return alloc_system(szb);
+  heap& mine = heaps[my_id];
+  if (szb == 0 || szb > max_block_szb)
+    return mine.alloc_large(my_id, szb);
+  return mine.alloc(my_id, (int)((szb + granularity - 1) / granularity) - 1);
+}
+
+//! Frees a block returned by `alloc`; may be called by any thread
+static inline void free(void* p) {
+  if (p == nullptr)
+    return;
+  heap::header_t* h = (heap::header_t*)p - 1;
+  if (h->size_class == heap::large_class) {
+    ::free(h);
+    return;
+  }
+  worker_id_t my_id = worker::get_my_id();
+  heap::free_block* b = (heap::free_block*)p;
+  if (h->owner == my_id) {
+    heaps[my_id].free_local(b, (int)h->size_class);
+  } else {
+    if (my_id != worker::undef)
+      heaps[my_id].counters.nb_free_remote++;
+    heaps[h->owner].free_remote(b, (int)h->size_class);
+  }
+}
+
+//! Returns the sum of the counters of all the heaps
+heap::counters_t sum_counters();
+
+//! Prints the sum of the counters of all the heaps
+void print_counters(FILE* f);
+
+/*---------------------------------------------------------------------*/
+/*! \class allocated
+ *  \brief Base class for objects that are allocated from the slabs.
+ *
+ * Defining `DISABLE_SLAB_ALLOC` makes these objects use the system
+ * allocator instead, e.g., for comparison purposes. Blocks are aligned
+ * on `granularity` bytes only, so that over-aligned objects, e.g.,
+ * those declared `alignas(64)`, take the aligned system allocator
+ * when the compiler supports aligned `new` (C++17).
+ */
+class allocated {
+public:
+
+  void* operator new(size_t szb) {
+#ifdef DISABLE_SLAB_ALLOC
+    return ::operator new(szb);
+#else
+    return alloc(szb);
+#endif
+  }
+
+  void operator delete(void* p) {
+#ifdef DISABLE_SLAB_ALLOC
+    ::operator delete(p);
+#else
+    free(p);
+#endif
+  }
+
+#ifdef __cpp_aligned_new
+  void* operator new(size_t szb, std::align_val_t al) {
+    return ::operator new(szb, al);
+  }
+
+  void operator delete(void* p, std::align_val_t al) {
+    ::operator delete(p, al);
+  }
+#endif
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_UTIL_SLAB_H_ */
@@ -0,0 +1,92 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file stackpool.cpp
+ *
+ */
+
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "stackpool.hpp"
+#include "atomic.hpp"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_STACK
+#define MAP_STACK 0
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+namespace pasl {
+namespace util {
+namespace stackpool {
+
+/***********************************************************************/
+
+size_t pool::page_szb() {
+  static size_t szb = 0;
+  if (szb == 0)
+    szb = (size_t)sysconf(_SC_PAGESIZE);
+  return szb;
+}
+
+void pool::init(size_t stack_szb, int max_nb_cached) {
+  size_t pg = page_szb();
+  this->stack_szb = ((stack_szb + pg - 1) / pg) * pg;
+  this->max_nb_cached = max_nb_cached;
+  cached.reserve(max_nb_cached);
+}
+
+void pool::destroy() {
+  for (size_t i = 0; i < cached.size(); i++)
+    unmap_stack(cached[i]);
+  cached.clear();
+}
+
+char* pool::map_stack() {
+  size_t guard_szb = page_szb();
+  size_t szb = guard_szb + stack_szb;
+  void* p = mmap(NULL, szb, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (p == MAP_FAILED)
+    atomic::die("stackpool: failed to map a stack of %lu bytes\n", (unsigned long)szb);
+  // stacks grow downwards, so the guard goes at the low end
+  if (mprotect(p, guard_szb, PROT_NONE) != 0)
+    atomic::die("stackpool: failed to protect guard page\n");
+  return (char*)p + guard_szb;
+}
+
+void pool::unmap_stack(char* stack) {
+  size_t guard_szb = page_szb();
+  munmap(stack - guard_szb, guard_szb + stack_szb);
+}
+
+char* pool::alloc(bool& hit) {
+  assert(stack_szb > 0);
+  hit = ! cached.empty();
+  if (! hit)
+    return map_stack();
+  char* stack = cached.back();
+  cached.pop_back();
+  return stack;
+}
+
+void pool::free(char* stack) {
+  assert(stack != nullptr);
+  if ((int)cached.size() >= max_nb_cached)
+    unmap_stack(stack);
+  else
+    cached.push_back(stack);
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
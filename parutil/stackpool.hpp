@@ -0,0 +1,91 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file stackpool.hpp
+ * \brief Pool of call stacks for multi-shot threads
+ *
+ */
+
+#ifndef _PASL_UTIL_STACKPOOL_H_
+#define _PASL_UTIL_STACKPOOL_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace pasl {
+namespace util {
+namespace stackpool {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/*! \class pool
+ *  \brief A bounded cache of call stacks, to be owned by one worker.
+ *
+ * Each stack is allocated by `mmap` and is preceded, at its low end,
+ * by a guard page that is mapped with no access rights, so that an
+ * overflow faults instead of silently corrupting a neighbouring
+ * stack. A stack that is returned to the pool is kept for later reuse,
+ * unless the pool already caches `max_nb_cached` stacks, in which case
+ * the stack is unmapped.
+ *
+ * A stack may be returned to a pool other than the one from which it
+ * was taken, provided that both pools use the same stack size.
+ *
+ * Access to a pool is not synchronized.
+ */
+class pool {
+private:
+
+  std::vector<char*> cached;
+  size_t stack_szb;
+  int max_nb_cached;
+
+  char* map_stack();
+  void unmap_stack(char* stack);
+
+public:
+
+  pool() : stack_szb(0), max_nb_cached(0) { }
+
+  /*! \brief Initializes the pool
+   *  \param stack_szb number of usable bytes per stack; rounded up
+   *  to a multiple of the page size
+   *  \param max_nb_cached maximum number of unused stacks to keep
+   */
+  void init(size_t stack_szb, int max_nb_cached);
+
+  //! Unmaps all cached stacks
+  void destroy();
+
+  /*! \brief Returns a pointer to the lowest usable byte of a stack
+   *  \param hit set to true if the stack was taken from the cache
+   */
+  char* alloc(bool& hit);
+
+  //! Returns to the pool a stack obtained from `alloc`
+  void free(char* stack);
+
+  //! Returns the number of usable bytes in each stack
+  size_t get_stack_szb() const {
+    return stack_szb;
+  }
+
+  //! Returns the number of stacks currently held by the cache
+  size_t nb_cached() const {
+    return cached.size();
+  }
+
+  //! Returns the size of a page of memory
+  static size_t page_szb();
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_UTIL_STACKPOOL_H_ */
@@ -44,7 +44,7 @@ void group_t::init(int nb_workers, machine::binding_policy_p bindpolicy) {
   factory = NULL;
   controllers = new controller_p[nb_workers];
   tls_alloc(worker_id_t, worker_id);
-  tls_setter(worker_id_t, worker_id, undef);
+  set_my_id(undef);
   interrupts = cmdline::parse_or_default_bool("interrupts", false, false);
 }
 
@@ -150,7 +150,7 @@ void controller_t::interrupt_handled() {
    *  allocator and the freelist allocator is not signal safe.
    */
   double elapsed = ticks::microseconds_since(controller->date_of_last_interrupt);
-  LOG_EVENT(COMM, new util::logging::interrupt_event_t(elapsed));
+  LOG_INTERRUPT(elapsed);
 #endif
 }
 
@@ -343,7 +343,7 @@ void* group_t::build_thread(void* arg) {
   worker_id_t my_id = worker_init->first;
   group_p group = worker_init->second;
   delete worker_init;
-  tls_setter(worker_id_t, worker_id, my_id);
+  set_my_id(my_id);
   group->get_bindpolicy()->pin_calling_thread(my_id);
   controller_p controller = group->factory->create_controller();
   group->controllers[my_id] = controller;
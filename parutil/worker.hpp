@@ -32,19 +32,29 @@ namespace worker {
 /*---------------------------------------------------------------------*/
 /* Worker ID */
 
+/* The thread-local storage holds the id of the worker plus one, so
+ * that the threads that are not workers, whose storage is never set
+ * and thus reads zero, get the id `undef`.
+ */
 tls_extern_declare(worker_id_t, worker_id);
 
+//! A special worker id code returned when threads don't exist yet,
+//! and to threads that are not workers
+const worker_id_t undef = -1l;
+
 //! Returns the id of calling worker.
 static inline worker_id_t get_my_id () {
 #ifdef USE_CILK_RUNTIME
   return __cilkrts_get_worker_number();
 #else
-  return tls_getter(worker_id_t, worker_id);
+  return tls_getter(worker_id_t, worker_id) - 1;
 #endif
 }
 
-//! A special worker id code returned when threads don't exist yet 
-const worker_id_t undef = -1l;
+//! Sets the id of the calling thread.
+static inline void set_my_id (worker_id_t id) {
+  tls_setter(worker_id_t, worker_id, id + 1);
+}
   
 /*---------------------------------------------------------------------*/
 
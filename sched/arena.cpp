@@ -0,0 +1,209 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file arena.cpp
+ *
+ */
+
+#include <atomic>
+#include <deque>
+#include <sstream>
+#include <algorithm>
+
+#include "arena.hpp"
+#include "pcmdline.hpp"
+#include "native.hpp"
+#include "idle.hpp"
+
+namespace pasl {
+namespace sched {
+namespace arena {
+
+/***********************************************************************/
+
+static int nb_arenas = 1;
+// arena `a` holds the workers of ids in `[first_workers[a], first_workers[a+1])`
+static worker_id_t first_workers[max_nb + 1];
+static std::vector<int> arena_of_worker;
+static bool cross_steal = false;
+
+void init(int nb_workers) {
+  std::string sizes = util::cmdline::parse_or_default_string("arenas", "", false);
+  first_workers[0] = 0;
+  nb_arenas = 0;
+  if (sizes == "") {
+    nb_arenas = 1;
+    first_workers[1] = nb_workers;
+  } else {
+    std::stringstream ss(sizes);
+    std::string size;
+    while (std::getline(ss, size, ',')) {
+      if (nb_arenas == max_nb)
+        util::atomic::die("too many arenas (at most %d)\n", max_nb);
+      int nb = atoi(size.c_str());
+      if (nb < 1)
+        util::atomic::die("bogus arena size %s\n", size.c_str());
+      first_workers[nb_arenas + 1] = first_workers[nb_arenas] + nb;
+      nb_arenas++;
+    }
+    if (first_workers[nb_arenas] != nb_workers)
+      util::atomic::die("the arenas have %d workers in total instead of %d\n",
+                        (int)first_workers[nb_arenas], nb_workers);
+  }
+  arena_of_worker.resize(nb_workers);
+  for (int a = 0; a < nb_arenas; a++)
+    for (worker_id_t id = first_workers[a]; id < first_workers[a + 1]; id++)
+      arena_of_worker[id] = a;
+  cross_steal = util::cmdline::parse_or_default_bool("arena_cross_steal", false, false);
+}
+
+int get_nb() {
+  return nb_arenas;
+}
+
+int of_worker(worker_id_t id) {
+  if (id < 0 || id >= (worker_id_t)arena_of_worker.size())
+    return 0;
+  return arena_of_worker[id];
+}
+
+int get_nb_workers(int a) {
+  return (int)(first_workers[a + 1] - first_workers[a]);
+}
+
+worker_id_t get_first_worker(int a) {
+  return first_workers[a];
+}
+
+bool is_isolated() {
+  return nb_arenas > 1 && ! cross_steal;
+}
+
+worker_id_t random_peer(worker_id_t my_id, unsigned r) {
+  int a = of_worker(my_id);
+  int nb = get_nb_workers(a);
+  if (nb < 2)
+    return util::worker::undef;
+  worker_id_t id = first_workers[a] + (worker_id_t)(r % (unsigned)(nb - 1));
+  if (id >= my_id)
+    id++;
+  return id;
+}
+
+/*---------------------------------------------------------------------*/
+/* Jobs */
+
+class inbox_t {
+public:
+  std::mutex lock;
+  std::deque<job_p> jobs;
+  std::atomic<int> nb_pending;
+  uint64_t nb_done;
+  double total_latency;
+  double max_latency;
+
+  inbox_t() : nb_pending(0), nb_done(0), total_latency(0.0), max_latency(0.0) { }
+};
+
+static inbox_t inboxes[max_nb];
+
+job::job(int arena, const std::function<void()>& body)
+: done(false), arena(arena), body(body),
+  submit_date(util::microtime::now()), finish_date(0) { }
+
+bool job::is_done() {
+  std::unique_lock<std::mutex> l(lock);
+  return done;
+}
+
+void job::wait() {
+  std::unique_lock<std::mutex> l(lock);
+  cv.wait(l, [&] { return done; });
+}
+
+double job::latency() {
+  return util::microtime::seconds(util::microtime::diff(submit_date, finish_date));
+}
+
+void job::complete() {
+  finish_date = util::microtime::now();
+  inbox_t& b = inboxes[arena];
+  double l = latency();
+  {
+    std::unique_lock<std::mutex> bl(b.lock);
+    b.nb_done++;
+    b.total_latency += l;
+    b.max_latency = std::max(b.max_latency, l);
+  }
+  std::unique_lock<std::mutex> jl(lock);
+  done = true;
+  cv.notify_all();
+}
+
+job_p submit(int a, const std::function<void()>& body) {
+  if (a < 0 || a >= nb_arenas)
+    util::atomic::die("bogus arena %d\n", a);
+  job_p j = std::make_shared<job>(a, body);
+  inbox_t& b = inboxes[a];
+  {
+    std::unique_lock<std::mutex> l(b.lock);
+    b.jobs.push_back(j);
+    b.nb_pending++;
+  }
+  idle::the_lot.notify_all();
+  return j;
+}
+
+//! Outstrategy of the root thread of a job
+class job_end : public outstrategy::noop {
+private:
+  job_p j;
+
+public:
+  job_end(const job_p& j) : j(j) { }
+
+  void finished() {
+    j->complete();
+    noop::finished();
+  }
+};
+
+bool start_next(int a) {
+  inbox_t& b = inboxes[a];
+  if (b.nb_pending.load(std::memory_order_relaxed) == 0)
+    return false;
+  job_p j;
+  {
+    std::unique_lock<std::mutex> l(b.lock);
+    if (b.jobs.empty())
+      return false;
+    j = b.jobs.front();
+    b.jobs.pop_front();
+    b.nb_pending--;
+  }
+  thread_p t = native::new_multishot_by_lambda([j] { j->body(); });
+  t->set_instrategy(instrategy::ready_new());
+  t->set_outstrategy(new job_end(j));
+  threaddag::add_thread(t);
+  return true;
+}
+
+void print_stats(FILE* f) {
+  if (nb_arenas < 2)
+    return;
+  for (int a = 0; a < nb_arenas; a++) {
+    inbox_t& b = inboxes[a];
+    std::unique_lock<std::mutex> l(b.lock);
+    double mean = (b.nb_done > 0) ? b.total_latency / b.nb_done : 0.0;
+    fprintf(f, "arena%d_nb_jobs %ld\n", a, (long)b.nb_done);
+    fprintf(f, "arena%d_job_latency_mean %.6lf\n", a, mean);
+    fprintf(f, "arena%d_job_latency_max %.6lf\n", a, b.max_latency);
+  }
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
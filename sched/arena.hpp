@@ -0,0 +1,141 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file arena.hpp
+ * \brief Partition of the workers into arenas that run independent jobs
+ *
+ */
+
+#ifndef _PASL_SCHED_ARENA_H_
+#define _PASL_SCHED_ARENA_H_
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "worker.hpp"
+#include "microtime.hpp"
+
+/***********************************************************************/
+
+namespace pasl {
+namespace sched {
+namespace arena {
+
+/* The command-line option `-arenas` splits the workers into arenas of
+ * consecutive ids, e.g., `-proc 32 -arenas 8,24` makes an arena of
+ * workers 0 to 7 and an arena of workers 8 to 31; with the binding
+ * policy, each arena thereby runs on its own set of cores. By default,
+ * all the workers belong to arena 0.
+ *
+ * A worker steals only from the workers of its own arena, unless the
+ * option `-arena_cross_steal` is set. The shared constants of the
+ * estimators and the statistics are kept per arena. All the arenas
+ * share the scheduler built by `threaddag::init`, so that the workers
+ * of different arenas can steal from one another when allowed; an
+ * arena with a scheduler of its own is not supported.
+ *
+ * `submit(a, body)` runs `body` in a new thread of the native layer
+ * on the workers of arena `a`, and can be called concurrently from
+ * any OS thread. The job is picked up by the next worker of the arena
+ * that runs out of work. `launch` keeps running its root thread on
+ * worker 0, which belongs to arena 0. A thread should not block its
+ * worker while waiting for a job, as the worker then stops serving
+ * steal requests; it should rather `yield` until `is_done`.
+ */
+
+//! Maximal number of arenas
+static constexpr int max_nb = 8;
+
+/*! \brief Cell of an array indexed by arena, padded like the cells of
+ *  `perworker::array`, so that the workers of different arenas never
+ *  write to the same cache line.
+ */
+template <class Item>
+class padded {
+public:
+  __attribute__ ((aligned (64))) Item item;
+  int padding[64*2/4];
+};
+
+//! Reads the command-line parameters of the module
+void init(int nb_workers);
+
+//! Number of arenas
+int get_nb();
+
+//! Arena of worker `id`; 0 for threads that are not workers
+int of_worker(worker_id_t id);
+
+//! Arena of the calling worker
+static inline int get_mine() {
+  return of_worker(util::worker::get_my_id());
+}
+
+int get_nb_workers(int a);
+worker_id_t get_first_worker(int a);
+
+//! True if the workers steal only within their own arena
+bool is_isolated();
+
+/*! \brief Returns a worker chosen uniformly at random among the other
+ *  workers of the arena of `my_id`, or `util::worker::undef` if it is
+ *  alone in its arena.
+ *  \param r a random number
+ */
+worker_id_t random_peer(worker_id_t my_id, unsigned r);
+
+/*---------------------------------------------------------------------*/
+/* Jobs */
+
+class job {
+private:
+  std::mutex lock;
+  std::condition_variable cv;
+  bool done;
+
+public:
+  const int arena;
+  const std::function<void()> body;
+  const util::microtime::microtime_t submit_date;
+  util::microtime::microtime_t finish_date;
+
+  job(int arena, const std::function<void()>& body);
+
+  bool is_done();
+
+  /*! \brief Blocks the calling OS thread until the job completes;
+   *  not to be called from a worker of the arena of the job.
+   */
+  void wait();
+
+  //! Seconds from the submission of a completed job to its completion
+  double latency();
+
+  //! To be called once, by the worker that completes the job
+  void complete();
+};
+
+using job_p = std::shared_ptr<job>;
+
+job_p submit(int a, const std::function<void()>& body);
+
+/*! \brief Starts the next job submitted to arena `a`, if any, on the
+ *  calling worker; returns false if there was none.
+ */
+bool start_next(int a);
+
+//! Prints, for each arena, the number of completed jobs and their latency
+void print_stats(FILE* f);
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_ARENA_H_ */
@@ -17,6 +17,7 @@
 #include "pcmdline.hpp"
 #include "threaddag.hpp"
 #include "native.hpp"
+#include "slab.hpp"
 
 #ifndef _PASL_BENCHMARK_H_
 #define _PASL_BENCHMARK_H_
@@ -68,7 +69,11 @@ void launch(const Init& init, const Run& run, const Output& output,
     printf ("exectime %.3lf\n", exec_time);
   STAT_IDLE(sum());
   STAT(dump(stdout));
+#ifndef DISABLE_SLAB_ALLOC
+  STAT_ONLY(util::slab::print_counters(stdout));
+#endif
   STAT_IDLE(print_idle(stdout));
+  HWCOUNTERS(print(stdout));
 #ifdef DUMP_JEMALLOC_STATS
   // Dump allocator statistics to stderr.
   malloc_stats_print(NULL, NULL, NULL);
@@ -28,6 +28,20 @@ extern double kappa;
   
 class thread;
 typedef thread* thread_p;
+
+/*! \brief Priority of a thread.
+ *
+ * The work-stealing schedulers keep one deque, or lane, per priority.
+ * A worker runs the threads of its highest nonempty lane first, and
+ * thieves steal from the highest nonempty lane of their victim.
+ */
+typedef enum {
+  PRIORITY_NORMAL = 0,
+  PRIORITY_HIGH = 1
+} priority_t;
+
+//! Number of priority lanes
+static constexpr int nb_priorities = 2;
   
 /*---------------------------------------------------------------------*/
 
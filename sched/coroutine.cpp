@@ -0,0 +1,96 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file coroutine.cpp
+ *
+ */
+
+#include "coroutine.hpp"
+
+namespace pasl {
+namespace sched {
+namespace coroutine {
+
+/***********************************************************************/
+
+frame_pool::frame_pool() : nb_bytes(0) {
+  for (int i = 0; i < nb_classes; i++)
+    free_lists[i] = nullptr;
+}
+
+static inline int class_of(size_t szb) {
+  return (int)((szb + frame_pool::class_szb - 1) / frame_pool::class_szb) - 1;
+}
+
+/* Small frames always take the full size of their class, so that a
+ * frame allocated from outside the workers can be released into a
+ * pool.
+ */
+static inline size_t malloc_szb(size_t szb) {
+  int c = class_of(szb);
+  return (c >= frame_pool::nb_classes) ? szb : (c + 1) * frame_pool::class_szb;
+}
+
+void* frame_pool::alloc(size_t szb) {
+  int c = class_of(szb);
+  if (c >= nb_classes)
+    return malloc(szb);
+  free_frame* f = free_lists[c];
+  if (f != nullptr) {
+    free_lists[c] = f->next;
+    return f;
+  }
+  nb_bytes += malloc_szb(szb);
+  return malloc(malloc_szb(szb));
+}
+
+void frame_pool::free(void* p, size_t szb) {
+  int c = class_of(szb);
+  if (c >= nb_classes) {
+    ::free(p);
+    return;
+  }
+  free_frame* f = (free_frame*)p;
+  f->next = free_lists[c];
+  free_lists[c] = f;
+}
+
+/*---------------------------------------------------------------------*/
+
+static data::perworker::array<frame_pool> pools;
+
+// threads that are not workers read `worker::undef` and use malloc
+static inline bool is_worker(worker_id_t id) {
+  return id >= 0 && id < util::worker::get_nb();
+}
+
+void* alloc_frame(size_t szb) {
+  worker_id_t id = util::worker::get_my_id();
+  if (! is_worker(id))
+    return malloc(malloc_szb(szb));
+  return pools[id].alloc(szb);
+}
+
+void free_frame(void* p, size_t szb) {
+  worker_id_t id = util::worker::get_my_id();
+  if (! is_worker(id)) {
+    ::free(p);
+    return;
+  }
+  pools[id].free(p, szb);
+}
+
+size_t frame_pools_nb_bytes() {
+  size_t nb = 0;
+  pools.for_each([&] (worker_id_t, frame_pool& pool) {
+    nb += pool.nb_bytes;
+  });
+  return nb;
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
@@ -0,0 +1,465 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file coroutine.hpp
+ * \brief Coroutine front end to the work-stealing schedulers
+ *
+ */
+
+#ifndef _PASL_SCHED_COROUTINE_H_
+#define _PASL_SCHED_COROUTINE_H_
+
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+
+#include "workerlocal.hpp"
+#include "native.hpp"
+
+/***********************************************************************/
+
+namespace pasl {
+namespace sched {
+namespace coroutine {
+
+/*---------------------------------------------------------------------*/
+/* Frame pool */
+
+/*! \class frame_pool
+ *  \brief Per-worker pool of coroutine frames.
+ *
+ * Frames are grouped by size classes of `class_szb` bytes. A frame
+ * goes back to the pool of the worker that releases it, which need
+ * not be the one that allocated it. Frames larger than the largest
+ * class, and frames allocated from outside the workers, are taken
+ * from `malloc`.
+ */
+class frame_pool {
+public:
+  static constexpr size_t class_szb = 64;
+  static constexpr int nb_classes = 32;
+
+private:
+  struct free_frame {
+    free_frame* next;
+  };
+
+  free_frame* free_lists[nb_classes];
+
+public:
+  //! Number of bytes obtained from `malloc` by this pool
+  size_t nb_bytes;
+
+  frame_pool();
+  void* alloc(size_t szb);
+  void free(void* p, size_t szb);
+};
+
+void* alloc_frame(size_t szb);
+void free_frame(void* p, size_t szb);
+
+//! Returns the number of bytes held by the frame pools of all the workers
+size_t frame_pools_nb_bytes();
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+/***********************************************************************/
+
+#if defined(__cpp_impl_coroutine) || defined(__cpp_coroutines)
+
+#include <coroutine>
+
+namespace pasl {
+namespace sched {
+
+/*---------------------------------------------------------------------*/
+/* Tasks */
+
+/* A `task<T>` is a coroutine that starts when it is first awaited.
+ * There are three ways to run a task from the body of another task:
+ *
+ * - `co_await t` runs `t` to completion, then returns its result;
+ * - `co_await fork2(t1, t2)` runs `t1` and `t2` in parallel, and
+ *   returns when both have completed;
+ * - `co_await spawn(t)` makes `t` available to the other workers and
+ *   returns immediately; `co_await sync()` returns when all the tasks
+ *   spawned so far by the calling task have completed.
+ *
+ * A task that spawns must sync before it returns. The results of the
+ * tasks run by `fork2` or `spawn` are read with `get()`.
+ *
+ * In `fork2`, the second task is pushed on the deque of the worker as
+ * a thread of the scheduler, and the first one runs immediately, as
+ * with `native::fork2`. The frames are allocated from the frame pool
+ * of the worker instead of on a call stack of their own. The body of a
+ * task must not call the operations of the `native` layer, because it
+ * does not run in a `multishot` thread.
+ *
+ * `sync_wait(t)` runs the task `t` from the native layer, and returns
+ * its result.
+ */
+
+template <class T>
+class task;
+
+namespace coroutine {
+
+using join_counter_type = std::atomic<long>;
+
+/* A task is joined with its parent either directly, when the parent
+ * awaits it, or through the join counter of the parent, when it is run
+ * by `fork2` or `spawn`. The join counter of a task holds one for each
+ * of its children that have not completed, plus one until the task
+ * itself reaches its next sync point. The task whose decrement brings
+ * the counter to zero resumes the parent.
+ *
+ * A root task instead calls `on_complete`.
+ */
+class promise_base {
+public:
+  std::coroutine_handle<> continuation;
+  join_counter_type* parent_join;
+  join_counter_type join;
+  void (*on_complete)(void*);
+  void* on_complete_arg;
+
+  promise_base()
+  : parent_join(nullptr), join(1), on_complete(nullptr), on_complete_arg(nullptr) { }
+
+  static void* operator new(size_t szb) {
+    return alloc_frame(szb);
+  }
+
+  static void operator delete(void* p, size_t szb) {
+    free_frame(p, szb);
+  }
+
+  std::suspend_always initial_suspend() noexcept {
+    return { };
+  }
+
+  class final_awaiter {
+  public:
+    bool await_ready() noexcept {
+      return false;
+    }
+
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+      promise_base& p = h.promise();
+      assert(p.join.load() == 1);
+      // the frame may be destroyed as soon as the parent is notified
+      std::coroutine_handle<> continuation = p.continuation;
+      join_counter_type* parent_join = p.parent_join;
+      if (parent_join != nullptr) {
+        if (parent_join->fetch_sub(1) == 1) {
+          parent_join->store(1, std::memory_order_relaxed);
+          return continuation;
+        }
+        return std::noop_coroutine();
+      }
+      if (continuation)
+        return continuation;
+      if (p.on_complete != nullptr)
+        p.on_complete(p.on_complete_arg);
+      return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept { }
+  };
+
+  final_awaiter final_suspend() noexcept {
+    return { };
+  }
+
+  void unhandled_exception() {
+    util::atomic::die("uncaught exception in coroutine task\n");
+  }
+};
+
+//! Thread of the scheduler that resumes a suspended task
+class resume_thread : public thread {
+private:
+  std::coroutine_handle<> h;
+
+public:
+  resume_thread(std::coroutine_handle<> h) : h(h) { }
+
+  void run() {
+    h.resume();
+  }
+
+  THREAD_COST_UNKNOWN
+};
+
+//! Makes the task `h` available to the other workers
+static inline void schedule(std::coroutine_handle<> h) {
+#if defined(SEQUENTIAL_ELISION)
+  h.resume();
+#elif defined(USE_CILK_RUNTIME)
+  util::atomic::die("coroutine tasks are not supported with the cilk runtime\n");
+#else
+  thread_p t = new resume_thread(h);
+  t->set_instrategy(instrategy::ready_new());
+  t->set_outstrategy(outstrategy::noop_new());
+  threaddag::add_thread(t);
+#endif
+}
+
+//! Decrements the token of the calling task; returns true if it has to wait
+static inline bool release_and_test(join_counter_type& join) {
+  if (join.fetch_sub(1) == 1) {
+    join.store(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+template <class T>
+class promise : public promise_base {
+public:
+  T value;
+
+  task<T> get_return_object();
+
+  void return_value(T v) {
+    value = std::move(v);
+  }
+
+  T& result() {
+    return value;
+  }
+};
+
+template <>
+class promise<void> : public promise_base {
+public:
+  task<void> get_return_object();
+
+  void return_void() { }
+
+  void result() { }
+};
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+
+template <class T = void>
+class task {
+public:
+  using promise_type = coroutine::promise<T>;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  handle_type h;
+
+  task() : h(nullptr) { }
+
+  explicit task(handle_type h) : h(h) { }
+
+  task(const task&) = delete;
+  task& operator=(const task&) = delete;
+
+  task(task&& other) : h(other.h) {
+    other.h = nullptr;
+  }
+
+  task& operator=(task&& other) {
+    if (this != &other) {
+      if (h)
+        h.destroy();
+      h = other.h;
+      other.h = nullptr;
+    }
+    return *this;
+  }
+
+  ~task() {
+    if (h)
+      h.destroy();
+  }
+
+  //! Returns the result of a completed task
+  decltype(auto) get() {
+    assert(h && h.done());
+    return h.promise().result();
+  }
+
+  class awaiter {
+  public:
+    handle_type h;
+
+    bool await_ready() {
+      return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) {
+      h.promise().continuation = parent;
+      return h;
+    }
+
+    decltype(auto) await_resume() {
+      return h.promise().result();
+    }
+  };
+
+  awaiter operator co_await() {
+    return awaiter{ h };
+  }
+};
+
+namespace coroutine {
+
+template <class T>
+task<T> promise<T>::get_return_object() {
+  return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() {
+  return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+template <class Promise>
+void attach_to_parent(std::coroutine_handle<Promise> child, std::coroutine_handle<> parent,
+                      join_counter_type& parent_join) {
+  child.promise().continuation = parent;
+  child.promise().parent_join = &parent_join;
+}
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+/* Fork join */
+
+template <class T1, class T2>
+class fork2_awaiter {
+public:
+  task<T1>& t1;
+  task<T2>& t2;
+
+  bool await_ready() {
+    return false;
+  }
+
+  template <class Promise>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> parent) {
+    coroutine::join_counter_type& join = parent.promise().join;
+    auto h1 = t1.h;
+    coroutine::attach_to_parent(h1, parent, join);
+    coroutine::attach_to_parent(t2.h, parent, join);
+    join.fetch_add(2);
+    coroutine::schedule(t2.h);
+    // the children keep the counter above zero until `h1` completes
+    coroutine::release_and_test(join);
+    return h1;
+  }
+
+  void await_resume() { }
+};
+
+template <class T1, class T2>
+fork2_awaiter<T1, T2> fork2(task<T1>& t1, task<T2>& t2) {
+  return fork2_awaiter<T1, T2>{ t1, t2 };
+}
+
+template <class T>
+class spawn_awaiter {
+public:
+  task<T>& t;
+
+  bool await_ready() {
+    return false;
+  }
+
+  template <class Promise>
+  bool await_suspend(std::coroutine_handle<Promise> parent) {
+    coroutine::join_counter_type& join = parent.promise().join;
+    coroutine::attach_to_parent(t.h, parent, join);
+    join.fetch_add(1);
+    coroutine::schedule(t.h);
+    return false;
+  }
+
+  void await_resume() { }
+};
+
+template <class T>
+spawn_awaiter<T> spawn(task<T>& t) {
+  return spawn_awaiter<T>{ t };
+}
+
+class sync_awaiter {
+public:
+  bool await_ready() {
+    return false;
+  }
+
+  template <class Promise>
+  bool await_suspend(std::coroutine_handle<Promise> parent) {
+    return coroutine::release_and_test(parent.promise().join);
+  }
+
+  void await_resume() { }
+};
+
+static inline sync_awaiter sync() {
+  return sync_awaiter();
+}
+
+/*---------------------------------------------------------------------*/
+/* Entry point from the native layer */
+
+namespace coroutine {
+
+/* The root task runs in a thread of the scheduler that captures its
+ * own outstrategy, so that the thread that waits for the root task is
+ * released only when the root task completes, possibly on another
+ * worker.
+ */
+static inline void complete_root(void* out) {
+  outstrategy::finished(nullptr, (outstrategy_p)out);
+}
+
+template <class T>
+class root_thread : public thread {
+private:
+  std::coroutine_handle<promise<T>> h;
+
+public:
+  root_thread(std::coroutine_handle<promise<T>> h) : h(h) { }
+
+  void run() {
+    h.promise().on_complete = &complete_root;
+    h.promise().on_complete_arg = (void*)threaddag::capture_outstrategy();
+    h.resume();
+  }
+
+  THREAD_COST_UNKNOWN
+};
+
+} // end namespace
+
+template <class T>
+decltype(auto) sync_wait(task<T>& t) {
+#if defined(SEQUENTIAL_ELISION)
+  t.h.resume();
+#else
+  native::finish([&] (native::multishot* join) {
+    thread_p root = new coroutine::root_thread<T>(t.h);
+    threaddag::fork(root, join);
+  });
+#endif
+  return t.get();
+}
+
+} // end namespace
+} // end namespace
+
+#endif
+
+/***********************************************************************/
+
+#endif /*! _PASL_SCHED_COROUTINE_H_ */
@@ -8,7 +8,15 @@
  */
 
 #include <fstream>
+#include <sstream>
 #include <map>
+#include <tuple>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
 #ifndef NDEBUG
 #include <unordered_set>
 #endif
@@ -25,17 +33,24 @@ namespace data {
 namespace estimator {
   
 static double local_ticks_per_microsec;
+// number of standard deviations added to the mean by `predict_upper`
+static double confidence_nb_stddevs = 1.0;
 
 static void try_write_constants_to_file();
 static void try_read_constants_from_file();
+static void try_load_constants_from_store(int nb_workers);
+static void try_save_constants_to_store();
 
-void init() {
+void init(int nb_workers) {
   local_ticks_per_microsec = util::machine::cpu_frequency_ghz * 1000.;
+  confidence_nb_stddevs = util::cmdline::parse_or_default_double("estim_confidence", 1.0, false);
   try_read_constants_from_file();
+  try_load_constants_from_store(nb_workers);
 }
 
 void destroy() {
   try_write_constants_to_file();
+  try_save_constants_to_store();
 }
   
 #if 1
@@ -55,6 +70,10 @@ void check_estimator_name(std::string name) {
 }
 #endif
 
+bool cost::regular(cost_type cost) {
+  return cost != cost::undefined && cost != cost::unknown && cost != cost::tiny;
+}
+
 /*---------------------------------------------------------------------*/
 /* Reading and writing constants to file */
 
@@ -62,8 +81,12 @@ typedef std::map<std::string, double> constant_map_t;
 
 // values of constants which are read from a file
 static constant_map_t preloaded_constants;
+// values of constants which are read from the constant store
+static constant_map_t warm_constants;
 // values of constants which are to be written to a file
 static constant_map_t recorded_constants;
+// values of the constants that were measured during the run
+static constant_map_t measured_constants;
 
 static void print_constant(FILE* out, std::string name, double cst) {
   fprintf(out,         "%s %lf\n", name.c_str(), cst);
@@ -117,15 +140,179 @@ static void try_write_constants_to_file() {
   fclose(outfile);
 }
 
+/*---------------------------------------------------------------------*/
+/* Constant store
+ *
+ * The store is a file that is shared by the successive, and possibly
+ * concurrent, runs of a binary. It keeps one constant per estimator
+ * name, CPU model, number of workers and size bucket, so that a run
+ * starts with the constants measured by the previous runs on the same
+ * configuration, rather than with pessimistic constants.
+ *
+ * The first line of the file gives the version of the format; each
+ * other line is an entry, made of tab-separated fields:
+ *
+ *   name  cpu_model  nb_workers  bucket  constant  nb_runs
+ *
+ * At the end of a run, the constants of the run are merged into the
+ * store: the new value of an entry is `decay * old + (1 - decay) * cst`,
+ * where `cst` is the value measured by the run. The merge holds an
+ * exclusive lock on `<store>.lock`, and the new contents are renamed
+ * over the store, so that concurrent runs neither lose updates nor
+ * read partial files.
+ */
+
+static const int store_version = 1;
+
+// name, cpu model, number of workers, bucket
+typedef std::tuple<std::string, std::string, int, std::string> store_key_t;
+
+typedef struct {
+  double cst;
+  long nb_runs;
+} store_entry_t;
+
+typedef std::map<store_key_t, store_entry_t> store_t;
+
+static std::string store_path;
+static std::string store_bucket;
+static int store_nb_workers;
+
+static bool storable(cost_type cst) {
+  return cost::regular(cst) && std::isfinite(cst) && cst > 0.;
+}
+
+static std::string get_store_path_from_cmdline() {
+  if (util::cmdline::parse_or_default_bool("csts_store", false, false))
+    return util::cmdline::name_of_my_executable() + ".cstdb";
+  else
+    return util::cmdline::parse_or_default_string("csts_store_in", "", false);
+}
+
+// returns false if the file is missing or has another version
+static bool read_store(std::string path, store_t& store) {
+  std::ifstream infile(path.c_str());
+  if (! infile.is_open())
+    return false;
+  std::string line;
+  getline(infile, line);
+  int version = -1;
+  if (sscanf(line.c_str(), "pasl_constants %d", &version) != 1 || version != store_version)
+    return false;
+  while (getline(infile, line)) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (getline(ss, field, '\t'))
+      fields.push_back(field);
+    if (fields.size() != 6)
+      continue; // ignore malformed entries
+    store_key_t key(fields[0], fields[1], atoi(fields[2].c_str()), fields[3]);
+    store_entry_t entry;
+    entry.cst = atof(fields[4].c_str());
+    entry.nb_runs = atol(fields[5].c_str());
+    if (storable(entry.cst))
+      store[key] = entry;
+  }
+  return true;
+}
+
+static void write_store(std::string path, const store_t& store) {
+  std::string tmp_path = path + ".tmp." + std::to_string((long)getpid());
+  FILE* f = fopen(tmp_path.c_str(), "w");
+  if (f == nullptr) {
+    util::atomic::msg([&] { std::cerr << "Warning: cannot write " << tmp_path << std::endl; });
+    return;
+  }
+  fprintf(f, "pasl_constants %d\n", store_version);
+  for (auto& it : store) {
+    const store_key_t& key = it.first;
+    fprintf(f, "%s\t%s\t%d\t%s\t%.17g\t%ld\n",
+            std::get<0>(key).c_str(), std::get<1>(key).c_str(), std::get<2>(key),
+            std::get<3>(key).c_str(), it.second.cst, it.second.nb_runs);
+  }
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    util::atomic::msg([&] { std::cerr << "Warning: cannot write " << path << std::endl; });
+    unlink(tmp_path.c_str());
+  }
+}
+
+/* For each estimator, takes the entry of the store for the same CPU
+ * model and bucket whose number of workers is the closest to ours.
+ * Constants given by `-read_csts` take precedence.
+ */
+static void try_load_constants_from_store(int nb_workers) {
+  store_path = get_store_path_from_cmdline();
+  if (store_path == "")
+    return;
+  store_bucket = util::cmdline::parse_or_default_string("csts_bucket", "-", false);
+  store_nb_workers = nb_workers;
+  store_t store;
+  read_store(store_path, store);
+  std::map<std::string, int> best_distance;
+  for (auto& it : store) {
+    const store_key_t& key = it.first;
+    const std::string& name = std::get<0>(key);
+    if (std::get<1>(key) != util::machine::cpu_model || std::get<3>(key) != store_bucket)
+      continue;
+    int distance = std::abs(std::get<2>(key) - nb_workers);
+    auto best = best_distance.find(name);
+    if (best != best_distance.end() && best->second <= distance)
+      continue;
+    best_distance[name] = distance;
+    warm_constants[name] = it.second.cst;
+  }
+  for (auto& it : preloaded_constants)
+    warm_constants.erase(it.first);
+}
+
+static void try_save_constants_to_store() {
+  if (store_path == "")
+    return;
+  double decay = util::cmdline::parse_or_default_double("csts_decay", 0.5, false);
+  decay = std::min(1.0, std::max(0.0, decay));
+  std::string lock_path = store_path + ".lock";
+  int lock_fd = open(lock_path.c_str(), O_CREAT | O_RDWR, 0644);
+  if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0) {
+    util::atomic::msg([&] { std::cerr << "Warning: cannot lock " << lock_path << std::endl; });
+    if (lock_fd >= 0)
+      close(lock_fd);
+    return;
+  }
+  // read the store again, to take into account the runs that ended since we started
+  store_t store;
+  read_store(store_path, store);
+  for (auto& it : measured_constants) {
+    if (! storable(it.second))
+      continue;
+    store_key_t key(it.first, util::machine::cpu_model, store_nb_workers, store_bucket);
+    auto entry = store.find(key);
+    if (entry == store.end()) {
+      store[key] = { it.second, 1 };
+    } else {
+      entry->second.cst = decay * entry->second.cst + (1.0 - decay) * it.second;
+      entry->second.nb_runs++;
+    }
+  }
+  write_store(store_path, store);
+  flock(lock_fd, LOCK_UN);
+  close(lock_fd);
+}
+
 /*---------------------------------------------------------------------*/
 // common
 
 void common::init() {
-  LOG_ESTIM(new util::logging::estim_name_event_t(this, name));
+  LOG_ESTIM_NAME(this, name);
 }
 
 void common::output() {
   recorded_constants[name] = get_constant();
+  if (reported.load(std::memory_order_relaxed))
+    measured_constants[name] = get_constant();
 }
 
 void common::destroy() {
@@ -139,8 +326,10 @@ std::string common::get_name() {
 cost_type common::get_constant_or_pessimistic() {
   cost_type cst = get_constant();
   assert (cst != 0.);
-  if (cst == cost::undefined)
+  if (cst == cost::undefined) {
+    STAT_COUNT(ESTIM_UNKNOWN);
     return cost::pessimistic;
+  }
   else
     return cst;
 }
@@ -160,10 +349,14 @@ cost_type common::predict_impl(complexity_type comp) {
 
 cost_type common::predict(complexity_type comp) {
   cost_type t = predict_impl(comp);
-  LOG_ESTIM(new util::logging::estim_predict_event_t(this, comp, t));
+  LOG_ESTIM_PREDICT(this, comp, t);
   return t;
 }
 
+cost_type common::predict_upper(complexity_type comp) {
+  return predict(comp);
+}
+
 uint64_t common::predict_nb_iterations() {
   double cst = get_constant_or_pessimistic();
   assert (cst != 0);
@@ -174,7 +367,7 @@ uint64_t common::predict_nb_iterations() {
 }
 
 void common::log_update(cost_type new_cst) {
-  LOG_CSTS(new util::logging::estim_update_event_t(this, new_cst));
+  LOG_ESTIM_UPDATE(this, new_cst);
 }
   
 void common::check() {
@@ -184,8 +377,11 @@ void common::check() {
 void common::report(complexity_type comp, cost_type elapsed_ticks) {
   double elapsed_time = elapsed_ticks / (double) local_ticks_per_microsec;
   cost_type measured_cst = elapsed_time / comp;
-  LOG_ESTIM(new util::logging::estim_report_event_t(this, comp, elapsed_time, measured_cst));
+  LOG_ESTIM_REPORT(this, comp, elapsed_time, measured_cst);
   STAT_COUNT(ESTIM_REPORT);
+  // a load first, so that later reports do not write the shared flag
+  if (! reported.load(std::memory_order_relaxed))
+    reported.store(true, std::memory_order_relaxed);
   analyse(measured_cst);
 }
 
@@ -194,10 +390,18 @@ void common::report(complexity_type comp, cost_type elapsed_ticks) {
 
 void distributed::init() {
   common::init();
-  shared_cst = cost::undefined;
+  set_shared_csts(cost::undefined);
   constant_map_t::iterator preloaded = preloaded_constants.find(common::name);
   if (preloaded != preloaded_constants.end())
     set_init_constant(preloaded->second);
+  constant_map_t::iterator warm = warm_constants.find(common::name);
+  if (warm != warm_constants.end())
+    set_shared_csts(warm->second);
+}
+
+void distributed::set_shared_csts(cost_type cst) {
+  for (int a = 0; a < sched::arena::max_nb; a++)
+    shared_csts[a].item = cst;
 }
 
 void distributed::destroy() {
@@ -213,7 +417,7 @@ cost_type distributed::get_constant() {
   
   // if local constant is undefined, use shared cst
   if (cst == cost::undefined)
-    return shared_cst;
+    return shared_cst();
   
   // (optional) if local constant is way above the shared cst, use shared cst
   // if (cst > max_decrease_factor * shared_cst)
@@ -224,7 +428,7 @@ cost_type distributed::get_constant() {
 }
 
 void distributed::set_init_constant(cost_type init_cst) {
-  shared_cst = init_cst;
+  set_shared_csts(init_cst);
   init_constant_provided_flg = true;
 }
 
@@ -233,7 +437,7 @@ bool distributed::init_constant_provided() {
 }
 
 void distributed::update_shared(cost_type new_cst) {
-  shared_cst = new_cst;
+  shared_cst() = new_cst;
   LOG_ONLY(log_update(new_cst));
   STAT_COUNT(ESTIM_UPDATE);
 }
@@ -241,7 +445,7 @@ void distributed::update_shared(cost_type new_cst) {
 void distributed::update(cost_type new_cst) {
   // if decrease is significant, report it to the shared constant;
   // (note that the shared constant never increases)
-  cost_type shared = shared_cst;
+  cost_type shared = shared_cst();
   if (shared == cost::undefined) {
     update_shared(new_cst);
   } else {
@@ -266,9 +470,161 @@ void distributed::analyse(cost_type measured_cst) {
 }
 
 bool distributed::constant_is_known() {
-  return (shared_cst != cost::unknown);
+  return (shared_cst() != cost::unknown);
 }
 
+
+/*---------------------------------------------------------------------*/
+// online
+
+constexpr const double online::min_weight;
+constexpr const double online::shared_merge_weight;
+constexpr const double online::outlier_nb_stddevs;
+constexpr const double online::min_relative_stddev;
+constexpr const long online::min_nb_for_outliers;
+
+uint64_t online::pack(double mean, double var) {
+  float fs[2] = { (float)mean, (float)var };
+  uint64_t w;
+  memcpy(&w, fs, sizeof(w));
+  return w;
+}
+
+void online::unpack(uint64_t w, double& mean, double& var) {
+  float fs[2];
+  memcpy(fs, &w, sizeof(w));
+  mean = (double)fs[0];
+  var = (double)fs[1];
+}
+
+void online::store_shared_moments(double mean, double var) {
+  for (int a = 0; a < sched::arena::max_nb; a++)
+    shared_moments_of[a].item.store(pack(mean, var));
+}
+
+void online::init() {
+  common::init();
+  store_shared_moments(cost::undefined, 0.);
+  constant_map_t::iterator preloaded = preloaded_constants.find(common::name);
+  if (preloaded != preloaded_constants.end())
+    set_init_constant(preloaded->second);
+  constant_map_t::iterator warm = warm_constants.find(common::name);
+  if (warm != warm_constants.end())
+    store_shared_moments(warm->second, 0.);
+}
+
+void online::destroy() {
+  common::destroy();
+}
+
+void online::output() {
+  common::output();
+}
+
+void online::set_init_constant(cost_type init_cst) {
+  store_shared_moments(init_cst, 0.);
+  init_constant_provided_flg = true;
+}
+
+bool online::init_constant_provided() {
+  return init_constant_provided_flg;
+}
+
+bool online::constant_is_known() {
+  double mean, var;
+  unpack(shared_moments().load(), mean, var);
+  return mean != cost::undefined;
+}
+
+// moments of the calling worker, or shared moments if it has no measure yet
+void online::get_moments(double& mean, double& var) {
+  moments_t& m = private_moments.mine();
+  if (m.nb > 0) {
+    mean = m.mean;
+    var = m.var;
+  } else {
+    unpack(shared_moments().load(), mean, var);
+  }
+}
+
+cost_type online::get_constant() {
+  double mean, var;
+  get_moments(mean, var);
+  return mean;
+}
+
+cost_type online::predict_upper(complexity_type comp) {
+  if (comp == complexity::tiny)
+    return cost::tiny;
+  assert (comp >= 0);
+  double mean, var;
+  get_moments(mean, var);
+  if (mean == cost::undefined) {
+    STAT_COUNT(ESTIM_UNKNOWN);
+    mean = cost::pessimistic;
+    var = 0.;
+  }
+  LOG_ESTIM_PREDICT(this, comp, mean * (double)comp);
+  double stddev = sqrt(std::max(0., var));
+  return (mean + confidence_nb_stddevs * stddev) * (double)comp;
+}
+
+void online::update_shared(const moments_t& m) {
+  const double w = shared_merge_weight;
+  uint64_t orig = shared_moments().load();
+  uint64_t next;
+  double new_mean;
+  do {
+    double mean, var;
+    unpack(orig, mean, var);
+    if (mean == cost::undefined) {
+      new_mean = m.mean;
+      next = pack(m.mean, m.var);
+    } else {
+      // moments of the mixture of the shared and of the private distributions
+      double d = m.mean - mean;
+      new_mean = (1.0 - w) * mean + w * m.mean;
+      double new_var = (1.0 - w) * var + w * m.var + w * (1.0 - w) * d * d;
+      next = pack(new_mean, new_var);
+    }
+  } while (! shared_moments().compare_exchange_weak(orig, next));
+  LOG_ONLY(log_update(new_mean));
+  STAT_COUNT(ESTIM_UPDATE);
+}
+
+void online::analyse(cost_type measured_cst) {
+  moments_t& m = private_moments.mine();
+  double x = measured_cst;
+  if (m.nb == 0) {
+    double mean, var;
+    unpack(shared_moments().load(), mean, var);
+    // start from the shared moments, if any
+    if (mean == cost::undefined) {
+      m.mean = x;
+      m.var = 0.;
+      m.nb = 1;
+      update_shared(m);
+      return;
+    }
+    m.mean = mean;
+    m.var = var;
+    m.nb = 1;
+  }
+  if (m.nb >= min_nb_for_outliers) {
+    double stddev = std::max(sqrt(m.var), min_relative_stddev * m.mean);
+    double lo = m.mean - outlier_nb_stddevs * stddev;
+    double hi = m.mean + outlier_nb_stddevs * stddev;
+    x = std::min(hi, std::max(lo, x));
+  }
+  // exponentially-weighted moments, which are exact for the first measures
+  double weight = std::max(min_weight, 1.0 / (double)(m.nb + 1));
+  double d = x - m.mean;
+  double incr = weight * d;
+  m.mean += incr;
+  m.var = (1.0 - weight) * (m.var + d * incr);
+  m.nb++;
+  update_shared(m);
+}
   
 } // end namespace
 } // end namespace
@@ -11,9 +11,11 @@
 #define _PASL_DATA_ESTIMATOR_H_
 
 #include <string>
+#include <atomic>
 
 #include "workerlocal.hpp"
 #include "callback.hpp"
+#include "arena.hpp"
 
 /***********************************************************************/
 
@@ -31,7 +33,11 @@ namespace estimator {
  * @}
  */
 
-void init();
+/*! \brief To be called once, before the estimators are initialized
+ *  \param nb_workers the number of workers of the run, which selects
+ *  the entries of the constant store (see `-csts_store`)
+ */
+void init(int nb_workers);
 void destroy();
   
 /*---------------------------------------------------------------------*/
@@ -143,6 +149,13 @@ public:
    */
   virtual cost_type predict(complexity_type comp) = 0;
   
+  /*! \brief Predicts an upper bound on the wall-clock time required to
+   *  execute a task, to be compared against `kappa` when deciding
+   *  whether to execute it sequentially.
+   *  \param comp the asymptotic complexity
+   */
+  virtual cost_type predict_upper(complexity_type comp) = 0;
+  
   /*! \brief Predicts the number of iterations that can execute in `kappa`
    *  seconds. To be used only for loops with constant time body.
    */
@@ -163,6 +176,9 @@ protected:
   //! Stores the name of the estimator.
   std::string name;
   
+  //! Set by the first call to `report`, from any worker
+  std::atomic<bool> reported;
+  
   //! Predicts the cost associated with an asymptotic complexity
   cost_type predict_impl(complexity_type comp);
   
@@ -180,7 +196,7 @@ protected:
 public:
   
   common(std::string name)
-  : name(name) {
+  : name(name), reported(false) {
     check();
   }
   
@@ -196,6 +212,9 @@ public:
   //! Implements `predict` using function `get_constant`
   cost_type predict(complexity_type comp);
   
+  //! Implements `predict_upper` as `predict`
+  cost_type predict_upper(complexity_type comp);
+  
   /*! Implements predict_iterations using the value of the constant
    *  or a pessimistic value in case it is unknown
    */
@@ -227,14 +246,21 @@ private:
   
 public: //! \todo find a better way to avoid false sharing
   volatile int padding1[64*2];
-  cost_type shared_cst;
+  //! One shared constant per arena
+  sched::arena::padded<cost_type> shared_csts[sched::arena::max_nb];
   perworker::cell<cost_type> private_csts;
   
+  //! Shared constant of the arena of the calling worker
+  cost_type& shared_cst() {
+    return shared_csts[sched::arena::get_mine()].item;
+  }
+  
 protected:
   void update(cost_type new_cst);
   void analyse(cost_type measured_cst);
   cost_type get_constant();
   void update_shared(cost_type new_cst);
+  void set_shared_csts(cost_type cst);
   
 public:
   distributed(std::string name)
@@ -249,6 +275,80 @@ public:
   bool init_constant_provided();
   bool constant_is_known();
 };
+
+/*---------------------------------------------------------------------*/
+
+/*! \class online
+ *  \brief A distributed implementation of the estimator which tracks
+ *  the mean and the variance of the measured constants.
+ *
+ * Each worker maintains exponentially-weighted moments of its own
+ * measures. A measure that is far out of the range of the previous
+ * ones, e.g., because the task was interrupted, is clamped to
+ * `outlier_nb_stddevs` standard deviations from the mean, so that it
+ * neither gets dropped nor skews the estimate. After each measure, the
+ * moments of the worker are merged into the shared moments, which are
+ * packed in a single word and updated with a compare-and-swap.
+ *
+ * `predict_upper` adds `-estim_confidence` standard deviations to the
+ * mean, so that a task is sequentialized only if it is likely to be
+ * small.
+ *
+ * @ingroup estimator
+ */
+
+class online : public common, util::callback::client {
+private:
+  constexpr static const double min_weight = 1.0 / 9.0;
+  constexpr static const double shared_merge_weight = 0.25;
+  constexpr static const double outlier_nb_stddevs = 3.0;
+  constexpr static const double min_relative_stddev = 0.1;
+  constexpr static const long min_nb_for_outliers = 4;
+  
+  typedef struct {
+    double mean;
+    double var;
+    long nb;
+  } moments_t;
+  
+  bool init_constant_provided_flg;
+  
+  /*! Per arena, the mean and variance, as a pair of floats; the mean is
+   *  `cost::undefined` initially */
+  sched::arena::padded<std::atomic<uint64_t>> shared_moments_of[sched::arena::max_nb];
+  perworker::cell<moments_t> private_moments;
+  
+  //! Shared moments of the arena of the calling worker
+  std::atomic<uint64_t>& shared_moments() {
+    return shared_moments_of[sched::arena::get_mine()].item;
+  }
+  void store_shared_moments(double mean, double var);
+  
+  static uint64_t pack(double mean, double var);
+  static void unpack(uint64_t w, double& mean, double& var);
+  
+  void get_moments(double& mean, double& var);
+  void update_shared(const moments_t& m);
+  
+protected:
+  void analyse(cost_type measured_cst);
+  cost_type get_constant();
+  
+public:
+  online(std::string name)
+  : common(name), init_constant_provided_flg(false),
+    private_moments(moments_t{ 0., 0., 0 }) {
+    store_shared_moments(cost::undefined, 0.);
+    util::callback::register_client(this);
+  }
+  void init();
+  void destroy();
+  void output();
+  void set_init_constant(cost_type init_cst);
+  bool init_constant_provided();
+  bool constant_is_known();
+  cost_type predict_upper(complexity_type comp);
+};
   
 } // end namespace
 } // end namespace
@@ -0,0 +1,349 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file future.hpp
+ * \brief Futures with typed results, on top of the native layer
+ *
+ */
+
+#ifndef _PASL_SCHED_FUTURE_H_
+#define _PASL_SCHED_FUTURE_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include "native.hpp"
+
+/***********************************************************************/
+
+namespace pasl {
+namespace sched {
+namespace native {
+
+/* Unlike the futures of `threaddag`, which are outstrategies whose
+ * dependencies are managed by the master worker of the future, the
+ * futures below keep their waiters in a lock-free list. The worker
+ * that completes a future notifies the waiters itself; a waiting
+ * thread is thereby pushed on the deque of the completing worker,
+ * without any message to another worker.
+ *
+ * - `async_future(body)` runs `body()` in a new thread and returns a
+ *   future of its result;
+ * - `f.then(g)` returns a future of `g(v)`, where `v` is the result
+ *   of `f`; `g` runs in a new thread, once `f` completes;
+ * - `when_all(fs)` returns a future of the vector of the results of
+ *   the futures `fs`;
+ * - `when_any(fs)` returns a future of the index and the result of
+ *   the first of the futures `fs` to complete;
+ * - `f.force()` returns the result of `f`, and suspends the calling
+ *   thread until then.
+ *
+ * The result type must be default constructible; in particular, it
+ * cannot be `void`.
+ */
+
+/*---------------------------------------------------------------------*/
+/* Shared state */
+
+class future_waiter {
+public:
+  future_waiter* next;
+
+  future_waiter() : next(nullptr) { }
+  virtual ~future_waiter() { }
+
+  //! Called once, by the worker that completes the future
+  virtual void notify() = 0;
+};
+
+class future_state_base {
+private:
+  static future_waiter* completed_tag() {
+    return (future_waiter*)1;
+  }
+
+  std::atomic<future_waiter*> waiters;
+
+public:
+  future_state_base() : waiters(nullptr) { }
+
+  virtual ~future_state_base() { }
+
+  bool is_ready() const {
+    return waiters.load() == completed_tag();
+  }
+
+  /*! \brief Adds `w` to the waiters; returns false, without adding it,
+   *  if the future has already completed.
+   */
+  bool add_waiter(future_waiter* w) {
+    future_waiter* head = waiters.load();
+    while (true) {
+      if (head == completed_tag())
+        return false;
+      w->next = head;
+      if (waiters.compare_exchange_weak(head, w))
+        return true;
+    }
+  }
+
+  //! To be called once the result is set
+  void notify_all() {
+    future_waiter* w = waiters.exchange(completed_tag());
+    assert(w != completed_tag());
+    while (w != nullptr) {
+      future_waiter* next = w->next;
+      w->notify();
+      delete w;
+      w = next;
+    }
+  }
+
+  //! Notifies `w` right away if the future has completed
+  void add_or_notify(future_waiter* w) {
+    if (add_waiter(w))
+      return;
+    w->notify();
+    delete w;
+  }
+};
+
+template <class T>
+class future_state : public future_state_base {
+public:
+  T value;
+
+  void complete(T v) {
+    value = std::move(v);
+    notify_all();
+  }
+};
+
+/*! \class future_thread_waiter
+ *  \brief Waiter that starts a thread with a `unary` instrategy.
+ */
+class future_thread_waiter : public future_waiter {
+private:
+  thread_p t;
+
+public:
+  future_thread_waiter(thread_p t) : t(t) { }
+
+  void notify() {
+    instrategy::delta(t->in, t, -1l);
+  }
+};
+
+//! Thread with no body, whose completion releases its join thread
+class future_signal_thread : public thread {
+public:
+  void run() { }
+
+  THREAD_COST_UNKNOWN
+};
+
+/*---------------------------------------------------------------------*/
+
+template <class T>
+class future;
+
+template <class T>
+using future_state_p = std::shared_ptr<future_state<T>>;
+
+/*! \brief Starts the thread `t` once the future of `state` completes.
+ *
+ * The thread is pushed on the deque of the worker that completes the
+ * future, or on the deque of the calling worker if the future has
+ * already completed.
+ */
+static inline void start_when_ready(future_state_base& state, thread_p t) {
+#if defined(SEQUENTIAL_ELISION) || defined(USE_CILK_RUNTIME)
+  util::atomic::die("start_when_ready: not supported in this mode\n");
+#else
+  t->set_instrategy(instrategy::unary_new());
+  t->set_outstrategy(outstrategy::noop_new());
+  threaddag::add_thread(t);
+  state.add_or_notify(new future_thread_waiter(t));
+#endif
+}
+
+template <class T>
+class future {
+public:
+  using value_type = T;
+
+private:
+  future_state_p<T> state;
+
+public:
+  future() { }
+
+  future(const future_state_p<T>& state) : state(state) { }
+
+  bool is_ready() const {
+    return state->is_ready();
+  }
+
+  //! Returns the result; to be called only from a thread of the native layer
+  T& force() {
+    if (! state->is_ready()) {
+      /* The signal thread is released by the completion of the future,
+       * and the calling thread waits for the signal thread to finish.
+       */
+      future_state_p<T> s = state;
+      finish([&] (multishot* join) {
+        thread_p signal = new future_signal_thread();
+        signal->set_instrategy(instrategy::unary_new());
+        signal->set_outstrategy(outstrategy::unary_new());
+        threaddag::add_dependency(signal, join);
+        threaddag::add_thread(signal);
+        s->add_or_notify(new future_thread_waiter(signal));
+      });
+    }
+    return state->value;
+  }
+
+  template <class Body>
+  future<typename std::decay<typename std::result_of<Body(T&)>::type>::type>
+  then(const Body& body) {
+    using result_type = typename std::decay<typename std::result_of<Body(T&)>::type>::type;
+    future_state_p<result_type> dst = std::make_shared<future_state<result_type>>();
+#if defined(SEQUENTIAL_ELISION)
+    dst->complete(body(force()));
+#else
+    future_state_p<T> src = state;
+    multishot* t = new_multishot_by_lambda([src, dst, body] {
+      dst->complete(body(src->value));
+    });
+    start_when_ready(*src, t);
+#endif
+    return future<result_type>(dst);
+  }
+
+  template <class U>
+  friend future<std::vector<U>> when_all(const std::vector<future<U>>& fs);
+  template <class U>
+  friend future<std::pair<size_t, U>> when_any(const std::vector<future<U>>& fs);
+};
+
+template <class T>
+future<T> make_ready_future(T v) {
+  future_state_p<T> state = std::make_shared<future_state<T>>();
+  state->complete(std::move(v));
+  return future<T>(state);
+}
+
+template <class Body>
+future<typename std::decay<typename std::result_of<Body()>::type>::type>
+async_future(const Body& body) {
+  using result_type = typename std::decay<typename std::result_of<Body()>::type>::type;
+  future_state_p<result_type> state = std::make_shared<future_state<result_type>>();
+#if defined(SEQUENTIAL_ELISION)
+  state->complete(body());
+#elif defined(USE_CILK_RUNTIME)
+  util::atomic::die("async_future: not supported with the cilk runtime\n");
+#else
+  multishot* t = new_multishot_by_lambda([state, body] {
+    state->complete(body());
+  });
+  t->set_instrategy(instrategy::ready_new());
+  t->set_outstrategy(outstrategy::noop_new());
+  threaddag::add_thread(t);
+#endif
+  return future<result_type>(state);
+}
+
+/*---------------------------------------------------------------------*/
+/* Combinators */
+
+template <class T>
+class when_all_waiter : public future_waiter {
+public:
+  class shared_type {
+  public:
+    std::vector<future_state_p<T>> srcs;
+    future_state_p<std::vector<T>> dst;
+    std::atomic<size_t> nb_pending;
+  };
+
+  std::shared_ptr<shared_type> shared;
+
+  when_all_waiter(const std::shared_ptr<shared_type>& shared) : shared(shared) { }
+
+  void notify() {
+    if (shared->nb_pending.fetch_sub(1) != 1)
+      return;
+    std::vector<T> values;
+    values.reserve(shared->srcs.size());
+    for (auto& src : shared->srcs)
+      values.push_back(src->value);
+    shared->dst->complete(std::move(values));
+  }
+};
+
+template <class T>
+future<std::vector<T>> when_all(const std::vector<future<T>>& fs) {
+  using shared_type = typename when_all_waiter<T>::shared_type;
+  auto dst = std::make_shared<future_state<std::vector<T>>>();
+  if (fs.empty()) {
+    dst->complete(std::vector<T>());
+    return future<std::vector<T>>(dst);
+  }
+  auto shared = std::make_shared<shared_type>();
+  shared->dst = dst;
+  shared->nb_pending.store(fs.size());
+  for (auto& f : fs)
+    shared->srcs.push_back(f.state);
+  for (auto& f : fs)
+    f.state->add_or_notify(new when_all_waiter<T>(shared));
+  return future<std::vector<T>>(dst);
+}
+
+template <class T>
+class when_any_waiter : public future_waiter {
+public:
+  class shared_type {
+  public:
+    future_state_p<std::pair<size_t, T>> dst;
+    std::atomic<bool> done;
+  };
+
+  std::shared_ptr<shared_type> shared;
+  future_state_p<T> src;
+  size_t index;
+
+  when_any_waiter(const std::shared_ptr<shared_type>& shared,
+                  const future_state_p<T>& src, size_t index)
+  : shared(shared), src(src), index(index) { }
+
+  void notify() {
+    bool expected = false;
+    if (shared->done.load() || ! shared->done.compare_exchange_strong(expected, true))
+      return;
+    shared->dst->complete(std::make_pair(index, src->value));
+  }
+};
+
+template <class T>
+future<std::pair<size_t, T>> when_any(const std::vector<future<T>>& fs) {
+  using shared_type = typename when_any_waiter<T>::shared_type;
+  assert(! fs.empty());
+  auto shared = std::make_shared<shared_type>();
+  shared->dst = std::make_shared<future_state<std::pair<size_t, T>>>();
+  shared->done.store(false);
+  for (size_t i = 0; i < fs.size(); i++)
+    fs[i].state->add_or_notify(new when_any_waiter<T>(shared, fs[i].state, i));
+  return future<std::pair<size_t, T>>(shared->dst);
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_FUTURE_H_ */
@@ -0,0 +1,229 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file hwcounters.cpp
+ *
+ */
+
+#include <string.h>
+#ifdef TARGET_LINUX
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "hwcounters.hpp"
+#include "atomic.hpp"
+#include "pcmdline.hpp"
+
+namespace pasl {
+namespace util {
+namespace hwcounters {
+
+/***********************************************************************/
+
+hwcounters_data_t::hwcounters_data_t() {
+  reset();
+}
+
+void hwcounters_data_t::reset() {
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    values[i] = 0;
+}
+
+void hwcounters_data_t::add(const hwcounters_data_t& other) {
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    values[i] += other.values[i];
+}
+
+void hwcounters_data_t::sub(const hwcounters_data_t& other) {
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    values[i] -= other.values[i];
+}
+
+/*---------------------------------------------------------------------*/
+
+#ifdef TARGET_LINUX
+static void event_of_type(hwcounter_type_t type, struct perf_event_attr& attr) {
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  switch (type) {
+    case CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case LLC_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_LL
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case DTLB_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    default:
+      atomic::die("bogus hardware counter");
+  }
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+}
+#endif
+
+hwcounters_private_t::hwcounters_private_t() {
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    fds[i] = -1;
+}
+
+bool hwcounters_private_t::open() {
+  bool ok = false;
+#ifdef TARGET_LINUX
+  for (int i = 0; i < NB_HWCOUNTERS; i++) {
+    struct perf_event_attr attr;
+    event_of_type((hwcounter_type_t)i, attr);
+    // measures the calling thread, on any cpu
+    fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    ok = ok || (fds[i] >= 0);
+  }
+#endif
+  return ok;
+}
+
+void hwcounters_private_t::close() {
+#ifdef TARGET_LINUX
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    if (fds[i] >= 0)
+      ::close(fds[i]);
+#endif
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    fds[i] = -1;
+}
+
+void hwcounters_private_t::read(hwcounters_data_t& dst) {
+  dst.reset();
+#ifdef TARGET_LINUX
+  for (int i = 0; i < NB_HWCOUNTERS; i++) {
+    if (fds[i] < 0)
+      continue;
+    uint64_t buf[3]; // value, time enabled, time running
+    if (::read(fds[i], buf, sizeof(buf)) != sizeof(buf))
+      continue;
+    double scale = (buf[2] == 0) ? 0.0 : ((double)buf[1] / (double)buf[2]);
+    dst.values[i] = (uint64_t)((double)buf[0] * scale);
+  }
+#endif
+}
+
+/*---------------------------------------------------------------------*/
+
+hwcounters_t::hwcounters_t() : enabled(false), available(false) { }
+
+void hwcounters_t::init() {
+  enabled = cmdline::parse_or_default_bool("hwcounters", true, false);
+  available = false;
+  phases.clear();
+}
+
+void hwcounters_t::open_mine() {
+  if (! enabled)
+    return;
+  bool ok = counters.mine().open();
+  std::lock_guard<std::mutex> guard(lock);
+  if (ok)
+    available = true;
+}
+
+void hwcounters_t::close_mine() {
+  counters.mine().close();
+}
+
+void hwcounters_t::snapshot(hwcounters_data_t& dst) {
+  dst.reset();
+  counters.for_each([&] (worker_id_t, hwcounters_private_t& c) {
+    hwcounters_data_t d;
+    c.read(d);
+    dst.add(d);
+  });
+}
+
+void hwcounters_t::enter_algo() {
+  if (! available)
+    return;
+  std::lock_guard<std::mutex> guard(lock);
+  phases.clear();
+  snapshot(last);
+}
+
+void hwcounters_t::mark_phase() {
+  if (! available)
+    return;
+  std::lock_guard<std::mutex> guard(lock);
+  hwcounters_data_t now;
+  snapshot(now);
+  hwcounters_data_t phase = now;
+  phase.sub(last);
+  phases.push_back(phase);
+  last = now;
+}
+
+void hwcounters_t::exit_algo() {
+  mark_phase();
+}
+
+bool hwcounters_t::is_available() {
+  return available;
+}
+
+int hwcounters_t::get_nb_phases() {
+  return (int)phases.size();
+}
+
+hwcounters_data_t hwcounters_t::get_phase(int k) {
+  assert(0 <= k && k < get_nb_phases());
+  return phases[k];
+}
+
+hwcounters_data_t hwcounters_t::get_total() {
+  hwcounters_data_t total;
+  for (auto& p : phases)
+    total.add(p);
+  return total;
+}
+
+void hwcounters_t::print(FILE* f) {
+  if (! enabled)
+    return;
+  if (! available) {
+    fprintf(f, "hw_available\t0\n");
+    return;
+  }
+  hwcounters_data_t total = get_total();
+  for (int i = 0; i < NB_HWCOUNTERS; i++)
+    fprintf(f, "hw_%s\t%ld\n", name_of_type((hwcounter_type_t)i).c_str(),
+            (long)total.values[i]);
+  if (get_nb_phases() > 1) {
+    for (int k = 0; k < get_nb_phases(); k++)
+      for (int i = 0; i < NB_HWCOUNTERS; i++)
+        fprintf(f, "hw_phase%d_%s\t%ld\n", k, name_of_type((hwcounter_type_t)i).c_str(),
+                (long)phases[k].values[i]);
+  }
+}
+
+/*---------------------------------------------------------------------*/
+
+hwcounters_t the_counters;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
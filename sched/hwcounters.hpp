@@ -0,0 +1,139 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file hwcounters.hpp
+ * \brief Per-worker hardware performance counters, based on the Linux
+ * `perf_event_open` interface.
+ *
+ */
+
+#ifndef _PASL_SCHED_HWCOUNTERS_H_
+#define _PASL_SCHED_HWCOUNTERS_H_
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+#include "workerlocal.hpp"
+
+namespace pasl {
+namespace util {
+namespace hwcounters {
+
+/***********************************************************************/
+
+typedef enum {
+  CYCLES = 0,
+  INSTRUCTIONS,
+  LLC_MISSES,
+  DTLB_MISSES,
+  NB_HWCOUNTERS,
+} hwcounter_type_t;
+
+static inline std::string name_of_type(hwcounter_type_t type) {
+  switch(type) {
+    case CYCLES: return std::string("cycles");
+    case INSTRUCTIONS: return std::string("instructions");
+    case LLC_MISSES: return std::string("llc_misses");
+    case DTLB_MISSES: return std::string("dtlb_misses");
+    default: return std::string("unknown");
+  }
+}
+
+/*---------------------------------------------------------------------*/
+
+class hwcounters_data_t {
+public:
+  uint64_t values[NB_HWCOUNTERS];
+
+  hwcounters_data_t();
+  void reset();
+  void add(const hwcounters_data_t& other);
+  void sub(const hwcounters_data_t& other);
+};
+
+/*---------------------------------------------------------------------*/
+
+/* The counters of a worker measure the thread of that worker only.
+ * They are opened by the worker itself, but may be read by any
+ * thread.
+ */
+class hwcounters_private_t {
+private:
+  int fds[NB_HWCOUNTERS];
+public:
+  hwcounters_private_t();
+  //! Returns false if none of the counters could be opened
+  bool open();
+  void close();
+  //! Values scaled to the time enabled when the kernel multiplexes counters
+  void read(hwcounters_data_t& dst);
+};
+
+/*---------------------------------------------------------------------*/
+
+/* The counters are read at the beginning and at the end of the
+ * algorithm, and at every `ALGO_PHASE` event in between; phase `k`
+ * covers the events from the `k`-th reading to the next one. The
+ * readings sum over all the workers.
+ */
+class hwcounters_t {
+private:
+  typedef pasl::data::perworker::array<hwcounters_private_t> wi_counters_t;
+  wi_counters_t counters;
+  bool enabled;
+  bool available;
+  std::mutex lock;
+  hwcounters_data_t last;
+  std::vector<hwcounters_data_t> phases;
+
+  void snapshot(hwcounters_data_t& dst);
+
+public:
+  hwcounters_t();
+  void init();
+  //! Called by each worker, when it starts
+  void open_mine();
+  //! Called by each worker, when it stops
+  void close_mine();
+  void enter_algo();
+  void mark_phase();
+  void exit_algo();
+
+  bool is_available();
+  int get_nb_phases();
+  //! Returns the counts of the given phase
+  hwcounters_data_t get_phase(int k);
+  //! Returns the counts of all the phases
+  hwcounters_data_t get_total();
+  void print(FILE* f);
+};
+
+/*---------------------------------------------------------------------*/
+
+extern hwcounters_t the_counters;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#ifdef HWCOUNTERS
+
+#define HWCOUNTERS(call) pasl::util::hwcounters::the_counters.call
+#define HWCOUNTERS_ONLY(code) code
+
+#else
+
+#define HWCOUNTERS(call)
+#define HWCOUNTERS_ONLY(code)
+
+#endif
+
+/***********************************************************************/
+
+#endif /*! _PASL_SCHED_HWCOUNTERS_H_ */
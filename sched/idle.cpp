@@ -0,0 +1,167 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file idle.cpp
+ *
+ */
+
+#include <algorithm>
+#include <sched.h>
+#ifdef TARGET_LINUX
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "idle.hpp"
+#include "atomic.hpp"
+#include "ticks.hpp"
+#include "microtime.hpp"
+#include "pcmdline.hpp"
+#include "stats.hpp"
+
+namespace pasl {
+namespace sched {
+namespace idle {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/* Parameters */
+
+static strategy_t strategy = SLEEP;
+static int spin_max = 1024;
+static int yield_max = 16;
+static double park_min_us = 10.0;
+static double park_max_us = 1000.0;
+bool wake_on_push = true;
+
+strategy_t strategy_of_string(std::string s) {
+  if (s.compare("sleep") == 0)
+    return SLEEP;
+  else if (s.compare("backoff") == 0)
+    return BACKOFF;
+  else if (s.compare("futex") == 0)
+    return FUTEX;
+  util::atomic::die("bogus idle strategy %s\n", s.c_str());
+  return SLEEP;
+}
+
+void init() {
+  std::string strategystr =
+    util::cmdline::parse_or_default_string("idle_strategy", "sleep", false);
+  strategy = strategy_of_string(strategystr);
+  spin_max = util::cmdline::parse_or_default_int("idle_spin_max", spin_max, false);
+  yield_max = util::cmdline::parse_or_default_int("idle_yield_max", yield_max, false);
+  park_min_us = util::cmdline::parse_or_default_double("idle_park_min", park_min_us, false);
+  park_max_us = util::cmdline::parse_or_default_double("idle_park_max", park_max_us, false);
+  wake_on_push = util::cmdline::parse_or_default_bool("idle_wake_on_push", wake_on_push, false);
+  park_max_us = std::max(park_min_us, park_max_us);
+}
+
+/*---------------------------------------------------------------------*/
+/* Parking lot */
+
+#ifdef TARGET_LINUX
+static long futex(std::atomic<uint32_t>* addr, int op, uint32_t val,
+                  const struct timespec* timeout) {
+  return syscall(SYS_futex, (uint32_t*)addr, op, val, timeout, NULL, 0);
+}
+#endif
+
+void parking_lot::park(double nb_microseconds) {
+  uint32_t seq = word.load();
+  nb_parked++;
+#ifdef TARGET_LINUX
+  long ns = (long)(nb_microseconds * 1000.0);
+  struct timespec timeout;
+  timeout.tv_sec = ns / 1000000000l;
+  timeout.tv_nsec = ns % 1000000000l;
+  futex(&word, FUTEX_WAIT_PRIVATE, seq, &timeout);
+#else
+  usleep((useconds_t)nb_microseconds);
+#endif
+  nb_parked--;
+}
+
+void parking_lot::wake(int nb) {
+  word++;
+  STAT_COUNT(IDLE_WAKE);
+#ifdef TARGET_LINUX
+  futex(&word, FUTEX_WAKE_PRIVATE, (nb < 0) ? INT_MAX : nb, NULL);
+#endif
+}
+
+parking_lot the_lot;
+
+/*---------------------------------------------------------------------*/
+/* Waiter */
+
+void waiter::reset() {
+  nb_spins = 1;
+  nb_yields = 0;
+  park_us = park_min_us;
+}
+
+void waiter::spin(int nb) {
+  STAT_IDLE_ONLY(microtime_t start = util::microtime::now());
+  for (int i = 0; i < nb; i++) {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#else
+    util::atomic::compiler_barrier();
+#endif
+  }
+  STAT_IDLE(add_to_spinning_time(util::microtime::seconds_since(start)));
+}
+
+void waiter::yield() {
+  STAT_IDLE_ONLY(microtime_t start = util::microtime::now());
+  sched_yield();
+  STAT_IDLE(add_to_spinning_time(util::microtime::seconds_since(start)));
+}
+
+void waiter::park(double nb_microseconds) {
+  STAT_COUNT(IDLE_PARK);
+  the_lot.park(nb_microseconds);
+}
+
+void waiter::pause(bool may_park) {
+  switch (strategy) {
+    case SLEEP: {
+      STAT_IDLE_ONLY(microtime_t start = util::microtime::now());
+      util::ticks::microseconds_sleep(1);
+      STAT_IDLE(add_to_sleeping_time(util::microtime::seconds_since(start)));
+      break;
+    }
+    case BACKOFF: {
+      if (nb_spins <= spin_max) {
+        spin(nb_spins);
+        nb_spins *= 2;
+      } else if (nb_yields < yield_max || ! may_park) {
+        yield();
+        nb_yields++;
+      } else {
+        park(park_us);
+        park_us = std::min(2.0 * park_us, park_max_us);
+      }
+      break;
+    }
+    case FUTEX: {
+      if (may_park)
+        park(park_max_us);
+      else
+        yield();
+      break;
+    }
+  }
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
@@ -0,0 +1,149 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file idle.hpp
+ * \brief Strategies for the behavior of workers that look for work
+ *
+ */
+
+#ifndef _PASL_SCHED_IDLE_H_
+#define _PASL_SCHED_IDLE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace pasl {
+namespace sched {
+namespace idle {
+
+/***********************************************************************/
+
+typedef enum {
+  SLEEP,        // busy-wait for one microsecond between two attempts
+  BACKOFF,      // spin, then yield, then park, with exponential backoff
+  FUTEX         // park between two attempts
+} strategy_t;
+
+strategy_t strategy_of_string(std::string s);
+
+/*---------------------------------------------------------------------*/
+/*! \class parking_lot
+ *  \brief A place where idle workers can block until new work is
+ *  published or a timeout expires.
+ *
+ * On Linux, parked workers block on a futex; on other systems,
+ * `park` just sleeps until the timeout expires.
+ *
+ * Wake-ups are only hints: a worker that parks at the same time as
+ * work is published may miss the corresponding `notify`. For this
+ * reason, every call to `park` is bounded by a timeout, after which
+ * the worker goes looking for work again.
+ */
+class parking_lot {
+private:
+
+  static constexpr int padding_szb = 128;
+
+  char padding1[padding_szb];
+  std::atomic<uint32_t> word;
+  char padding2[padding_szb];
+  std::atomic<int> nb_parked;
+  char padding3[padding_szb];
+
+public:
+
+  parking_lot() {
+    word.store(0);
+    nb_parked.store(0);
+  }
+
+  //! Blocks the caller for at most `nb_microseconds`
+  void park(double nb_microseconds);
+
+  //! Wakes up one parked worker, if there is any
+  void notify() {
+    if (nb_parked.load(std::memory_order_relaxed) > 0)
+      wake(1);
+  }
+
+  //! Wakes up all parked workers
+  void notify_all() {
+    if (nb_parked.load(std::memory_order_relaxed) > 0)
+      wake(-1);
+  }
+
+private:
+
+  void wake(int nb);
+
+};
+
+extern parking_lot the_lot;
+
+/*---------------------------------------------------------------------*/
+/*! \class waiter
+ *  \brief The idling behavior of one worker between two attempts to
+ *  find work.
+ *
+ * With the backoff strategy, the n-th consecutive call to `pause`
+ * first spins for `2^n` iterations, up to `spin_max`; then it yields
+ * the processor, `yield_max` times; then it parks the worker, for a
+ * duration that doubles at each call, from `park_min` to `park_max`
+ * microseconds. A call to `reset` starts the sequence over.
+ *
+ * The time spent spinning and yielding, during which the worker still
+ * occupies its processor, is reported as spinning time in the stats;
+ * the short sleeps of the sleep strategy are reported as sleeping time.
+ */
+class waiter {
+private:
+
+  int nb_spins;
+  int nb_yields;
+  double park_us;
+
+  void spin(int nb);
+  void yield();
+  void park(double nb_microseconds);
+
+public:
+
+  waiter() {
+    reset();
+  }
+
+  //! To be called when the worker finds work
+  void reset();
+
+  /*! \brief Waits before the next attempt to find work
+   *  \param may_park must be false if the worker is waiting for an
+   *  event for which no notification is sent, e.g., for the answer
+   *  to a steal request; the worker then never parks
+   */
+  void pause(bool may_park);
+
+};
+
+/*---------------------------------------------------------------------*/
+
+//! Reads the command-line parameters of the module
+void init();
+
+//! If true, workers that get new work wake up a parked worker
+extern bool wake_on_push;
+
+//! To be called when a worker has new threads that can be stolen
+static inline void notify_new_work() {
+  if (wake_on_push)
+    the_lot.notify();
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_IDLE_H_ */
@@ -38,7 +38,7 @@ namespace instrategy {
  *
  * \ingroup instrategy
  */
-class signature {
+class signature : public util::slab::allocated {
 public:
   
   virtual ~signature() { }
@@ -60,6 +60,16 @@ public:
   //! Same as `delta`, but called only by the message handler
   virtual void msg_delta(thread_p t, int64_t d) = 0;
 
+  /*! \brief Adds to the join counter the dependency of `t` on the
+   *  thread `src`
+   *
+   * An instrategy that needs to know which edge is satisfied when
+   * `src` finishes may replace the outstrategy of `src`.
+   */
+  virtual void add_edge(thread_p src, thread_p t) {
+    delta(t, +1l);
+  }
+
 };
   
 /*---------------------------------------------------------------------*/
@@ -347,6 +357,13 @@ static inline void delta(instrategy_p& in, thread_p t, int64_t d) {
   }
 }
 
+static inline void add_edge(instrategy_p& in, thread_p src, thread_p t) {
+  if (extract_tag(in) == 0)
+    in->add_edge(src, t);
+  else
+    delta(in, t, +1l);
+}
+
 static inline void msg_delta(instrategy_p in, thread_p t, int64_t d) {
   assert(extract_tag(in) == 0);
   in->msg_delta(t, d);
@@ -5,7 +5,12 @@
  * \file logging.cpp
  */
 
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
 #include "logging.hpp"
+#include "cycles.hpp"
 #include "pcmdline.hpp"
 
 namespace pasl {
@@ -16,6 +21,9 @@ namespace logging {
 
 recorder_t the_recorder;
 
+//! Period at which the flusher thread empties the ring buffers
+static constexpr int flush_period_us = 1000;
+
 /*---------------------------------------------------------------------*/
 // LATER: move
 
@@ -27,68 +35,551 @@ static inline void fwrite_int64 (FILE* f, int64_t v) {
   fwrite(&v, sizeof(v), 1, f);
 }
 
+static inline uint64_t bits_of_double(double v) {
+  uint64_t b;
+  memcpy(&b, &v, sizeof(b));
+  return b;
+}
+
+static inline double double_of_bits(uint64_t b) {
+  double v;
+  memcpy(&v, &b, sizeof(v));
+  return v;
+}
+
 /*---------------------------------------------------------------------*/
+/* Encoding of events into records */
+
+// number of words of `event_t::args` used by events of a given type
+static int nb_args_of(event_type_t type) {
+  switch (type) {
+    case THREAD_CREATE:
+    case THREAD_POP:
+    case THREAD_SCHEDULE:
+    case THREAD_SEND:
+    case THREAD_EXEC:
+    case THREAD_FINISH: return 1;
+    case THREAD_FORK: return 3;
+    case LOCALITY_START:
+    case LOCALITY_STOP: return 1;
+    case INTERRUPT: return 1;
+    case ESTIM_NAME: return 2;  // estimator, length of the name
+    case ESTIM_PREDICT: return 3;
+    case ESTIM_REPORT: return 4;
+    case ESTIM_UPDATE: return 2;
+    case ESTIM_DECIDE: return 4;
+    default: return 0;
+  }
+}
+
+// number of words taken by the characters of the name of an event
+static int nb_name_words_of(const event_t& e) {
+  if (e.type != ESTIM_NAME)
+    return 0;
+  return (int)((e.name.length() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+}
 
+// returns the `i`-th word of the payload of `e`
+static uint64_t word_of(const event_t& e, int i) {
+  int nb_args = nb_args_of(e.type);
+  if (i < nb_args)
+    return e.args[i];
+  uint64_t w = 0;
+  size_t pos = (i - nb_args) * sizeof(uint64_t);
+  size_t len = std::min(sizeof(uint64_t), e.name.length() - pos);
+  memcpy(&w, e.name.data() + pos, len);
+  return w;
+}
 
-event_t::event_t() {}
+/*---------------------------------------------------------------------*/
+/* Ring buffers */
 
-void event_t::print_byte_descr(FILE* f) { }
+ring_t::ring_t()
+  : items(nullptr), mask(0), cached_tail(0), nb_stalls(0) {
+  head.store(0);
+  tail.store(0);
+}
 
-void event_t::print_text_descr(FILE* f) { }
+ring_t::~ring_t() {
+  delete [] items;
+}
 
-void event_t::record (microtime_t basetime) {
-  id = (int64_t) worker::get_my_id();
-  time = microtime::now() - basetime; // or (double) ticks::now()
-// TEMP
-/*
-  if (microtime::seconds(time) > 0.01) {
-    output ();
-    atomic::die("interrupted");
+void ring_t::init(uint64_t capacity) {
+  assert((capacity & (capacity - 1)) == 0);
+  delete [] items;
+  items = new record_t[capacity];
+  mask = capacity - 1;
+  cached_tail = 0;
+  head.store(0);
+  tail.store(0);
+}
+
+void ring_t::wait_for_room(uint64_t h) {
+  nb_stalls++;
+  while (true) {
+    cached_tail = tail.load(std::memory_order_acquire);
+    if (h - cached_tail <= mask)
+      return;
+    std::this_thread::yield();
   }
-*/
-    
 }
 
-void event_t::print_byte_header (FILE* f) {
-  //fwrite_double (f, time);
+void ring_t::flush_to(FILE* f, worker_id_t id) {
+  uint64_t t = tail.load(std::memory_order_relaxed);
+  uint64_t h = head.load(std::memory_order_acquire);
+  if (h == t)
+    return;
+  int64_t header[2] = { (int64_t)id, (int64_t)(h - t) };
+  fwrite(header, sizeof(header), 1, f);
+  uint64_t first = t & mask;
+  uint64_t nb_first = std::min(h - t, mask + 1 - first);
+  fwrite(&items[first], sizeof(record_t), nb_first, f);
+  fwrite(&items[0], sizeof(record_t), (h - t) - nb_first, f);
+  tail.store(h, std::memory_order_release);
+}
+
+/*---------------------------------------------------------------------*/
+/* Events */
+
+void event_t::print_byte (FILE* f) {
   fwrite_int64 (f, (int64_t) time);
-  fwrite_int64 (f, id);
-  fwrite_int64 (f, get_type());
+  fwrite_int64 (f, (int64_t) id);
+  fwrite_int64 (f, (int64_t) type);
+  switch (type) {
+    case INTERRUPT:
+      fwrite_double (f, double_of_bits(args[0]));
+      break;
+    case ESTIM_NAME: {
+      fwrite_int64 (f, (int64_t) args[0]);
+      int64_t len = (int64_t) name.length();
+      fwrite_int64 (f, len);
+      for (int64_t i = 0; i < len; i++)
+        fwrite_int64 (f, (int64_t) name[i]);
+      break;
+    }
+    case ESTIM_REPORT:
+      fwrite_int64 (f, (int64_t) args[0]);
+      fwrite_int64 (f, (int64_t) args[1]);
+      // TODO: fix double bits: fwrite_double (f, elapsed);
+      fwrite_int64 (f, (int64_t) (1000.0 * double_of_bits(args[2])));
+      fwrite_double (f, double_of_bits(args[3]));
+      break;
+    case ESTIM_UPDATE:
+      fwrite_int64 (f, (int64_t) args[0]);
+      fwrite_double (f, double_of_bits(args[1]));
+      break;
+    case ESTIM_PREDICT:
+      fwrite_int64 (f, (int64_t) args[0]);
+      fwrite_int64 (f, (int64_t) args[1]);
+      fwrite_double (f, double_of_bits(args[2]));
+      break;
+    case ESTIM_DECIDE:
+      fwrite_int64 (f, (int64_t) args[0]);
+      fwrite_int64 (f, (int64_t) args[1]);
+      fwrite_double (f, double_of_bits(args[2]));
+      fwrite_int64 (f, (int64_t) args[3]);
+      break;
+    default:
+      for (int i = 0; i < nb_args_of(type); i++)
+        fwrite_int64 (f, (int64_t) args[i]);
+  }
 }
 
-void event_t::print_byte (FILE* f) { 
-  print_byte_header (f);
-  print_byte_descr (f);
+void event_t::print_text (FILE* f) {
+  fprintf(f, "%lf\t%d\t%s\t", time, (int)id, name_of(type).c_str());
+  switch (type) {
+    case THREAD_FORK:
+      fprintf(f, "%p\t%p\t%p", (void*)args[0], (void*)args[1], (void*)args[2]);
+      break;
+    case LOCALITY_START:
+    case LOCALITY_STOP:
+      fprintf(f, "%ld", (long)args[0]);
+      break;
+    case INTERRUPT:
+      fprintf(f,"%lf\t", double_of_bits(args[0]));
+      break;
+    case ESTIM_NAME:
+      fprintf(f,"%p\t%s\t", (void*)args[0], name.c_str());
+      break;
+    case ESTIM_REPORT:
+      // warning: order switched
+      fprintf(f,"%p\t%ld\t%lf\t%lf\t", (void*)args[0], (long)args[1],
+              double_of_bits(args[3]), double_of_bits(args[2]));
+      break;
+    case ESTIM_UPDATE:
+      fprintf(f,"%p\t%lf\t", (void*)args[0], double_of_bits(args[1]));
+      break;
+    case ESTIM_PREDICT: {
+      // warning: extra info printed
+      int64_t comp = (int64_t)args[1];
+      double t = double_of_bits(args[2]);
+      double cst = t / comp;
+      fprintf(f,"%p\t%ld\t                     \t%lf\t%lf\t", (void*)args[0], (long)comp, cst, t);
+      break;
+    }
+    case ESTIM_DECIDE:
+      fprintf(f,"%p\t%ld\t%lf\t%s\t", (void*)args[0], (long)args[1], double_of_bits(args[2]),
+              (args[3] != 0) ? "sequential" : "parallel");
+      break;
+    default:
+      if (nb_args_of(type) == 1)
+        fprintf(f, "%p", (void*)args[0]);
+  }
+  fprintf (f, "\n");
 }
 
-void event_t::print_text_header (FILE* f) {
-  fprintf(f, "%lf\t%d\t%s\t", time, (int)id, get_name().c_str());
+/*---------------------------------------------------------------------*/
+/* Trace reader */
+
+class trace_reader_t::cursor_t {
+public:
+  static constexpr int buffer_capacity = 256;
+
+  worker_id_t id;
+  std::vector<std::pair<off_t, int64_t>> blocks;  // offset, number of records
+  size_t block;
+  int64_t pos_in_block;
+  record_t buffer[buffer_capacity];
+  int buffer_pos;
+  int buffer_size;
+
+  cursor_t(worker_id_t id)
+    : id(id), block(0), pos_in_block(0), buffer_pos(0), buffer_size(0) { }
+
+  // reads the next records of the current block into the buffer
+  bool fill(FILE* f) {
+    while (block < blocks.size() && pos_in_block == blocks[block].second) {
+      block++;
+      pos_in_block = 0;
+    }
+    if (block == blocks.size())
+      return false;
+    int64_t nb = std::min((int64_t)buffer_capacity, blocks[block].second - pos_in_block);
+    fseeko(f, blocks[block].first + pos_in_block * sizeof(record_t), SEEK_SET);
+    if (fread(buffer, sizeof(record_t), nb, f) != (size_t)nb)
+      atomic::die("logging: truncated trace file\n");
+    pos_in_block += nb;
+    buffer_pos = 0;
+    buffer_size = (int)nb;
+    return true;
+  }
+
+  bool has_current(FILE* f) {
+    return buffer_pos < buffer_size || fill(f);
+  }
+
+  record_t& current() {
+    return buffer[buffer_pos];
+  }
+
+  record_t take(FILE* f) {
+    if (! has_current(f))
+      atomic::die("logging: truncated event in trace file\n");
+    return buffer[buffer_pos++];
+  }
+
+};
+
+trace_reader_t::trace_reader_t() : f(nullptr) { }
+
+trace_reader_t::~trace_reader_t() {
+  close();
+}
+
+void trace_reader_t::open(std::string fname, uint64_t basetime, double cycles_per_microsecond) {
+  this->basetime = basetime;
+  this->cycles_per_microsecond = cycles_per_microsecond;
+  f = fopen(fname.c_str(), "r");
+  if (f == nullptr)
+    atomic::die("logging: failed to open %s\n", fname.c_str());
+  int64_t header[2];
+  while (fread(header, sizeof(header), 1, f) == 1) {
+    worker_id_t id = (worker_id_t)header[0];
+    auto it = std::find_if(cursors.begin(), cursors.end(),
+                           [&] (cursor_t* c) { return c->id == id; });
+    cursor_t* c;
+    if (it == cursors.end()) {
+      c = new cursor_t(id);
+      cursors.push_back(c);
+    } else {
+      c = *it;
+    }
+    c->blocks.push_back(std::make_pair(ftello(f), header[1]));
+    fseeko(f, header[1] * sizeof(record_t), SEEK_CUR);
+  }
+  // events that share the same time are output by increasing worker id
+  std::sort(cursors.begin(), cursors.end(),
+            [] (cursor_t* c1, cursor_t* c2) { return c1->id < c2->id; });
+  for (int i = 0; i < (int)cursors.size(); i++)
+    if (cursors[i]->has_current(f))
+      heap.push_back(i);
+  for (size_t k = heap.size(); k > 0; k--)
+    sift_down(k - 1);
+}
+
+bool trace_reader_t::heap_less(int i, int j) {
+  uint64_t ti = cursors[i]->current().time;
+  uint64_t tj = cursors[j]->current().time;
+  return (ti < tj) || (ti == tj && i < j);
+}
+
+void trace_reader_t::sift_down(size_t k) {
+  size_t n = heap.size();
+  while (true) {
+    size_t l = 2 * k + 1;
+    size_t r = l + 1;
+    size_t m = k;
+    if (l < n && heap_less(heap[l], heap[m]))
+      m = l;
+    if (r < n && heap_less(heap[r], heap[m]))
+      m = r;
+    if (m == k)
+      return;
+    std::swap(heap[k], heap[m]);
+    k = m;
+  }
 }
 
-void event_t::print_text (FILE* f) { 
-  print_text_header (f);
-  print_text_descr (f); 
-  fprintf (f, "\n");
+bool trace_reader_t::next(event_t& e) {
+  if (heap.empty())
+    return false;
+  cursor_t* c = cursors[heap[0]];
+  record_t r = c->take(f);
+  assert(r.type != CONTINUED);
+  e.time = (double)(int64_t)(r.time - basetime) / cycles_per_microsecond;
+  e.id = c->id;
+  e.type = (event_type_t)r.type;
+  e.name.clear();
+  std::vector<uint64_t> words = { r.arg1, r.arg2 };
+  for (uint32_t i = 0; i < r.nb_more; i++) {
+    record_t m = c->take(f);
+    assert(m.type == CONTINUED);
+    words.push_back(m.arg1);
+    words.push_back(m.arg2);
+  }
+  int nb_args = nb_args_of(e.type);
+  for (int i = 0; i < 4; i++)
+    e.args[i] = (i < nb_args) ? words[i] : 0;
+  if (e.type == ESTIM_NAME)
+    e.name.assign((char*)&words[nb_args], (size_t)e.args[1]);
+  if (c->has_current(f)) {
+    sift_down(0);
+  } else {
+    heap[0] = heap.back();
+    heap.pop_back();
+    if (! heap.empty())
+      sift_down(0);
+  }
+  return true;
 }
 
-double event_t::get_time() {
-  return time;
+void trace_reader_t::close() {
+  for (cursor_t* c : cursors)
+    delete c;
+  cursors.clear();
+  heap.clear();
+  if (f != nullptr)
+    fclose(f);
+  f = nullptr;
 }
 
 /*---------------------------------------------------------------------*/
+/* Export to the trace-event format of Chrome and Perfetto */
+
+/* Each worker is a track, that is, a thread of process 0; the track
+ * of an event that was logged outside of the workers is numbered 0.
+ * Events that come in pairs, such as THREAD_EXEC and THREAD_FINISH,
+ * become slices; the others become instants. The events are written
+ * as they are read from the trace, so that the memory used does not
+ * depend on the size of the trace.
+ */
+class chrome_writer_t {
+private:
+  FILE* f;
+  bool first;
+  std::vector<worker_id_t> named_tracks;
+  std::vector<std::pair<uint64_t, std::string>> estim_names;
+
+  static int track_of(worker_id_t id) {
+    return (id == worker::undef) ? 0 : (int)id + 1;
+  }
+
+  // prints a string literal, escaped as needed
+  void print_string(const std::string& str) {
+    fputc('"', f);
+    for (char c : str) {
+      if (c == '"' || c == '\\')
+        fprintf(f, "\\%c", c);
+      else if ((unsigned char)c < 0x20)
+        fprintf(f, "\\u%04x", (int)c);
+      else
+        fputc(c, f);
+    }
+    fputc('"', f);
+  }
+
+  void begin_record() {
+    fprintf(f, first ? "\n" : ",\n");
+    first = false;
+  }
+
+  void name_track(worker_id_t id) {
+    if (std::find(named_tracks.begin(), named_tracks.end(), id) != named_tracks.end())
+      return;
+    named_tracks.push_back(id);
+    begin_record();
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+               "\"args\":{\"name\":\"", track_of(id));
+    if (id == worker::undef)
+      fprintf(f, "no worker\"}}");
+    else
+      fprintf(f, "worker %d\"}}", (int)id);
+    begin_record();
+    fprintf(f, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+               "\"args\":{\"sort_index\":%d}}", track_of(id), track_of(id));
+  }
 
+  std::string estim_name_of(uint64_t estim) {
+    for (auto& p : estim_names)
+      if (p.first == estim)
+        return p.second;
+    return "?";
+  }
 
-recorder_t::recorder_t() {
+  // prints the name, phase, category, time and track of an event
+  void print_header(event_t& e, const char* name, const char* phase, const char* cat) {
+    begin_record();
+    fprintf(f, "{\"name\":\"%s\",\"ph\":\"%s\",\"cat\":\"%s\",\"ts\":%.3lf,\"pid\":0,\"tid\":%d",
+            name, phase, cat, e.time, track_of(e.id));
+    if (phase[0] == 'i')
+      fprintf(f, ",\"s\":\"t\"");
+  }
+
+  void print_slice(event_t& e, const char* name, bool begin, const char* cat) {
+    print_header(e, name, begin ? "B" : "E", cat);
+    fprintf(f, "}");
+  }
+
+  void print_instant(event_t& e, const char* cat) {
+    std::string name = name_of(e.type);
+    name.erase(name.find_last_not_of(' ') + 1);
+    print_header(e, name.c_str(), "i", cat);
+    switch (e.type) {
+      case THREAD_FORK:
+        fprintf(f, ",\"args\":{\"thread\":\"%p\",\"left\":\"%p\",\"right\":\"%p\"}",
+                (void*)e.args[0], (void*)e.args[1], (void*)e.args[2]);
+        break;
+      case LOCALITY_START:
+      case LOCALITY_STOP:
+        fprintf(f, ",\"args\":{\"pos\":%ld}", (long)e.args[0]);
+        break;
+      case INTERRUPT:
+        if (e.args[0] != 0)
+          fprintf(f, ",\"args\":{\"elapsed\":%lf}", double_of_bits(e.args[0]));
+        break;
+      case ESTIM_NAME:
+        fprintf(f, ",\"args\":{\"estim\":\"%p\",\"name\":", (void*)e.args[0]);
+        print_string(e.name);
+        fprintf(f, "}");
+        break;
+      case ESTIM_PREDICT:
+        fprintf(f, ",\"args\":{\"estim\":");
+        print_string(estim_name_of(e.args[0]));
+        fprintf(f, ",\"comp\":%ld,\"time\":%lf}", (long)e.args[1], double_of_bits(e.args[2]));
+        break;
+      case ESTIM_REPORT:
+        fprintf(f, ",\"args\":{\"estim\":");
+        print_string(estim_name_of(e.args[0]));
+        fprintf(f, ",\"comp\":%ld,\"elapsed\":%lf,\"cst\":%lf}",
+                (long)e.args[1], double_of_bits(e.args[2]), double_of_bits(e.args[3]));
+        break;
+      case ESTIM_UPDATE:
+        fprintf(f, ",\"args\":{\"estim\":");
+        print_string(estim_name_of(e.args[0]));
+        fprintf(f, ",\"cst\":%lf}", double_of_bits(e.args[1]));
+        break;
+      case ESTIM_DECIDE:
+        fprintf(f, ",\"args\":{\"estim\":");
+        print_string(estim_name_of(e.args[0]));
+        fprintf(f, ",\"comp\":%ld,\"bound\":%lf,\"decision\":\"%s\"}",
+                (long)e.args[1], double_of_bits(e.args[2]),
+                (e.args[3] != 0) ? "sequential" : "parallel");
+        break;
+      default:
+        if (nb_args_of(e.type) == 1)
+          fprintf(f, ",\"args\":{\"thread\":\"%p\"}", (void*)e.args[0]);
+    }
+    fprintf(f, "}");
+  }
+
+  // the constant of an estimator is also shown as a counter track
+  void print_counter(event_t& e, uint64_t estim, double cst) {
+    begin_record();
+    fprintf(f, "{\"name\":");
+    print_string("cst " + estim_name_of(estim));
+    fprintf(f, ",\"ph\":\"C\",\"ts\":%.3lf,\"pid\":0,\"args\":{\"cst\":%lf}}", e.time, cst);
+  }
+
+public:
+
+  chrome_writer_t(FILE* f) : f(f), first(true) {
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  }
+
+  ~chrome_writer_t() {
+    fprintf(f, "\n]}\n");
+  }
+
+  void add(event_t& e) {
+    name_track(e.id);
+    switch (e.type) {
+      case ENTER_LAUNCH: print_slice(e, "launch", true, "phases"); break;
+      case EXIT_LAUNCH: print_slice(e, "launch", false, "phases"); break;
+      case ENTER_ALGO: print_slice(e, "algo", true, "phases"); break;
+      case EXIT_ALGO: print_slice(e, "algo", false, "phases"); break;
+      case ENTER_WAIT: print_slice(e, "wait", true, "phases"); break;
+      case EXIT_WAIT: print_slice(e, "wait", false, "phases"); break;
+      case THREAD_EXEC: print_slice(e, "thread", true, "threads"); break;
+      case THREAD_FINISH: print_slice(e, "thread", false, "threads"); break;
+      case ESTIM_NAME:
+        estim_names.push_back(std::make_pair(e.args[0], e.name));
+        print_instant(e, "estims");
+        break;
+      case ESTIM_UPDATE:
+        print_instant(e, "estims");
+        print_counter(e, e.args[0], double_of_bits(e.args[1]));
+        break;
+      case ESTIM_REPORT:
+        print_instant(e, "estims");
+        print_counter(e, e.args[0], double_of_bits(e.args[3]));
+        break;
+      case STEAL_SUCCESS:
+      case STEAL_FAIL:
+      case STEAL_ABORT:
+      case THREAD_SEND: print_instant(e, "steals"); break;
+      default: print_instant(e, "events");
+    }
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Recorder */
+
+recorder_t::recorder_t() : trace_file(nullptr), cycles_per_microsecond(1.0) {
+  flusher_stop.store(false);
 }
 
 recorder_t::~recorder_t() {
 }
 
 void recorder_t::init() {
-  basetime = microtime::now();
+  basetime = getticks();
+  basetime_microtime = microtime::now();
   real_time = cmdline::parse_or_default_bool("log_stdout", false);
   text_mode = cmdline::parse_or_default_bool("log_text", real_time);
-  set_tracking_all(false); 
+  chrome_mode = cmdline::parse_or_default_bool("log_chrome", false);
+  set_tracking_all(false);
   bool pview = cmdline::parse_or_default_bool("pview", false);
   bool color_view = cmdline::parse_or_default_bool("color_view", false); // temporarily deprecated
   tracking[PHASES] = cmdline::parse_or_default_bool("log_phases", 0);
@@ -98,7 +589,7 @@ void recorder_t::init() {
   tracking[LOCALITY] = cmdline::parse_or_default_bool("log_locality", 0);
   // TEMP: accept log_estim instead of log_estims
   bool estim = cmdline::parse_or_default_bool("log_estim", 0);
-  if (estim) 
+  if (estim)
     tracking[ESTIMS] = true;
   tracking[CSTS] = cmdline::parse_or_default_bool("log_csts", tracking[ESTIMS]);
   tracking[TRANSFER] = cmdline::parse_or_default_bool("log_transfer", 0);
@@ -113,18 +604,51 @@ void recorder_t::init() {
   if (pview) {
     tracking[PHASES] = true;
   }
+  uint64_t ring_size = 1;
+  int64_t requested = cmdline::parse_or_default_int64("log_ring_size", 1 << 14);
+  while ((int64_t)ring_size < requested)
+    ring_size *= 2;
+  rings.for_each([&] (worker_id_t, ring_t& r) {
+    r.init(ring_size);
+  });
+  trace_fname = cmdline::parse_or_default_string("log_trace_file", "LOG_TRACE");
+  trace_file = fopen(trace_fname.c_str(), "w");
+  if (trace_file == nullptr)
+    atomic::die("logging: failed to open %s\n", trace_fname.c_str());
+  if (real_time) {
+    // a first estimate, to print the time of events as they are added
+    while (microtime::seconds_since(basetime_microtime) < 0.01)
+      ;
+    calibrate();
+  }
+  flusher_stop.store(false);
+  flusher = std::thread([this] {
+    while (! flusher_stop.load()) {
+      flush_all();
+      std::this_thread::sleep_for(std::chrono::microseconds(flush_period_us));
+    }
+  });
 }
 
 void recorder_t::destroy() {
 }
 
-void recorder_t::set_tracking_all(bool state) {
-  for (int k = 0; k < NUM_KIND_IDS; k++) 
-    tracking[k] = state;
+void recorder_t::flush_all() {
+  rings.for_each([&] (worker_id_t id, ring_t& r) {
+    r.flush_to(trace_file, id);
+  });
+}
+
+void recorder_t::calibrate() {
+  double nb_microseconds = (double)microtime::since(basetime_microtime);
+  double nb_cycles = (double)(getticks() - basetime);
+  if (nb_microseconds > 0.0 && nb_cycles > 0.0)
+    cycles_per_microsecond = nb_cycles / nb_microseconds;
 }
 
-events_t& recorder_t::get_my_events() {
-  return events_for[worker::the_group.get_my_id_or_undef()];
+void recorder_t::set_tracking_all(bool state) {
+  for (int k = 0; k < NUM_KIND_IDS; k++)
+    tracking[k] = state;
 }
 
 bool recorder_t::is_tracked_kind(event_kind_t kind) {
@@ -135,47 +659,58 @@ bool recorder_t::is_tracked(event_type_t type) {
   return tracking[kind_of_type(type)];
 }
 
-void recorder_t::add_nocheck(event_p event) {
-  event->record(basetime);
+void recorder_t::add(const event_t& e) {
+  ring_t& ring = rings[worker::get_my_id()];
+  int nb_words = nb_args_of(e.type) + nb_name_words_of(e);
+  record_t r;
+  r.time = getticks();
+  r.type = (uint32_t)e.type;
+  r.nb_more = (nb_words <= 2) ? 0 : (uint32_t)((nb_words - 1) / 2);
+  r.arg1 = (nb_words > 0) ? word_of(e, 0) : 0;
+  r.arg2 = (nb_words > 1) ? word_of(e, 1) : 0;
+  ring.push(r);
+  for (int i = 2; i < nb_words; i += 2) {
+    record_t m;
+    m.time = r.time;
+    m.type = CONTINUED;
+    m.nb_more = 0;
+    m.arg1 = word_of(e, i);
+    m.arg2 = (i + 1 < nb_words) ? word_of(e, i + 1) : 0;
+    ring.push(m);
+  }
   if (real_time) {
+    event_t p = e;
+    p.time = (double)(int64_t)(r.time - basetime) / cycles_per_microsecond;
+    p.id = worker::get_my_id();
     atomic::acquire_print_lock();
-    event->print_text(stdout);
+    p.print_text(stdout);
     atomic::release_print_lock();
   }
-  get_my_events().push_back (event);
-}
-
-void recorder_t::add(event_p event) {
-  if (! is_tracked(event->get_type())) {
-    delete event;
-    return;
-  } else {  
-    add_nocheck(event);
-  }
-}
-
-static bool event_t_compare_time (event_p e1, event_p e2) {
-  return (e1->get_time() < e2->get_time());
-}
-
-void recorder_t::merge_and_sort() {
-  all_events.clear();
-  for (int id = worker::undef; id < worker::get_nb(); id++) {
-    events_t events = events_for[id];
-    for (std::vector<event_p>::iterator it = events.begin(); it != events.end(); it++)
-      all_events.push_back(*it);
-  }
-  std::stable_sort (all_events.begin(), all_events.end(), event_t_compare_time);
 }
 
 void recorder_t::dump_byte_to (FILE* f) {
-  for (std::vector<event_p>::iterator it = all_events.begin(); it != all_events.end(); it++)
-    (*it)->print_byte (f);
+  trace_reader_t reader;
+  reader.open(trace_fname, basetime, cycles_per_microsecond);
+  event_t e;
+  while (reader.next(e))
+    e.print_byte (f);
 }
 
 void recorder_t::dump_text_to (FILE* f) {
-  for (std::vector<event_p>::iterator it = all_events.begin(); it != all_events.end(); it++)
-    (*it)->print_text (f);
+  trace_reader_t reader;
+  reader.open(trace_fname, basetime, cycles_per_microsecond);
+  event_t e;
+  while (reader.next(e))
+    e.print_text (f);
+}
+
+void recorder_t::dump_chrome_to (FILE* f) {
+  trace_reader_t reader;
+  reader.open(trace_fname, basetime, cycles_per_microsecond);
+  chrome_writer_t writer(f);
+  event_t e;
+  while (reader.next(e))
+    writer.add(e);
 }
 
 void recorder_t::dump_byte () {
@@ -189,140 +724,108 @@ void recorder_t::dump_text () {
   std::string fname = cmdline::parse_or_default_string ("text_log_file", "LOG");
   FILE* f = fopen(fname.c_str(), "w");
   this->dump_text_to (f);
-  fclose (f);    
+  fclose (f);
+}
+
+void recorder_t::dump_chrome () {
+  std::string fname = cmdline::parse_or_default_string ("chrome_log_file", "LOG.json");
+  FILE* f = fopen(fname.c_str(), "w");
+  this->dump_chrome_to (f);
+  fclose (f);
 }
 
 void recorder_t::output () {
-  merge_and_sort();
+  flusher_stop.store(true);
+  flusher.join();
+  flush_all();
+  fclose(trace_file);
+  trace_file = nullptr;
+  calibrate();
+  uint64_t nb_stalls = 0;
+  rings.for_each([&] (worker_id_t, ring_t& r) {
+    nb_stalls += r.nb_stalls;
+  });
+  if (nb_stalls > 0)
+    printf("log_ring_stalls\t%ld\n", (long)nb_stalls);
   dump_byte();
   if (text_mode)
     dump_text();
+  if (chrome_mode)
+    dump_chrome();
 }
 
 /*---------------------------------------------------------------------*/
 
-void thread_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) thread);
-}
-
-void thread_event_t::print_text_descr(FILE* f) {  
-  fprintf(f, "%p", thread);
-}
-
-/*---------------------------------------------------------------------*/
-
-void thread_fork_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) thread);
-  fwrite_int64 (f, (int64_t) threadL);
-  fwrite_int64 (f, (int64_t) threadR);
-}
-
-void thread_fork_event_t::print_text_descr(FILE* f) {  
-  fprintf(f, "%p\t%p\t%p", thread, threadL, threadR);
-}
-
-/*---------------------------------------------------------------------*/
-
-void interrupt_event_t::print_byte_descr(FILE* f) {
-  fwrite_double (f, elapsed);
-}
-void interrupt_event_t::print_text_descr(FILE* f) {  
-  fprintf(f,"%lf\t", elapsed);
-}
-
-/*---------------------------------------------------------------------*/
-
-void locality_event_t::print_byte_descr(FILE* f) {
-  //! \todo only works if thread::locality_t is int64_t
-  fwrite_int64 (f, (int64_t) pos);
+void output () {
+  the_recorder.output();
 }
 
-void locality_event_t::print_text_descr(FILE* f) {  
-  fprintf(f, "%ld", pos);
+bool is_tracked_kind(event_kind_t kind) {
+  return the_recorder.is_tracked_kind(kind);
 }
 
-/*---------------------------------------------------------------------*/
-
-void estim_name_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  int64_t len = (int64_t) name.length();
-  fwrite_int64 (f, len);
-  for (int64_t i = 0; i < len; i++)
-    fwrite_int64 (f, (int64_t) name[i]);
+static inline void log_args(event_type_t type, uint64_t a0 = 0, uint64_t a1 = 0,
+                            uint64_t a2 = 0, uint64_t a3 = 0) {
+  if (! the_recorder.is_tracked(type))
+    return;
+  event_t e;
+  e.type = type;
+  e.args[0] = a0;
+  e.args[1] = a1;
+  e.args[2] = a2;
+  e.args[3] = a3;
+  the_recorder.add(e);
 }
 
-void estim_name_event_t::print_text_descr(FILE* f) {  
-  fprintf(f,"%p\t%s\t", estim, name.c_str());
+void log_basic(event_type_t type) {
+  HWCOUNTERS_ONLY(hwcounters_hook(type));
+  log_args(type);
 }
 
-void estim_report_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  fwrite_int64 (f, (int64_t) comp);
-  // TODO: fix double bits: fwrite_double (f, elapsed); 
-  fwrite_int64 (f, (int64_t) (1000.0 * elapsed));
-  fwrite_double (f, newcst);
+void log_thread(event_type_t type, sched::thread_p thread) {
+  log_args(type, (uint64_t)thread);
 }
 
-void estim_report_event_t::print_text_descr(FILE* f) {  
-  // warning: order switched
-  fprintf(f,"%p\t%ld\t%lf\t%lf\t", estim, (long)comp, newcst, elapsed);
+void log_thread_fork(event_type_t type, sched::thread_p thread, sched::thread_p threadL, sched::thread_p threadR) {
+  log_args(type, (uint64_t)thread, (uint64_t)threadL, (uint64_t)threadR);
 }
 
-void estim_update_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  fwrite_double (f, newcst);
-}
-void estim_update_event_t::print_text_descr(FILE* f) {  
-  fprintf(f,"%p\t%lf\t", estim, newcst);
+void log_locality(event_type_t type, pasl::data::locality_t pos) {
+  //! \todo only works if thread::locality_t is int64_t
+  log_args(type, (uint64_t)pos);
 }
 
-void estim_predict_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  fwrite_int64 (f, (int64_t) comp);
-  fwrite_double (f, time);
+void log_interrupt(double elapsed) {
+  log_args(INTERRUPT, bits_of_double(elapsed));
 }
-void estim_predict_event_t::print_text_descr(FILE* f) {  
-  // warning: extra info printed
-  double cst = time / comp;
-  fprintf(f,"%p\t%ld\t                     \t%lf\t%lf\t", estim, (long)comp, cst, time);
-}
-
-/*---------------------------------------------------------------------*/
 
-void output () {
-  the_recorder.output();
+void log_estim_name(void* estim, std::string name) {
+  if (! the_recorder.is_tracked(ESTIM_NAME))
+    return;
+  event_t e;
+  e.type = ESTIM_NAME;
+  e.args[0] = (uint64_t)estim;
+  e.args[1] = (uint64_t)name.length();
+  e.name = name;
+  the_recorder.add(e);
 }
 
-bool is_tracked_kind(event_kind_t kind) {
-  return the_recorder.is_tracked_kind(kind);
+void log_estim_predict(void* estim, int64_t comp, double time) {
+  log_args(ESTIM_PREDICT, (uint64_t)estim, (uint64_t)comp, bits_of_double(time));
 }
 
-void log_event(event_p event) {
-  the_recorder.add(event);
+void log_estim_report(void* estim, uint64_t comp, double elapsed, double newcst) {
+  log_args(ESTIM_REPORT, (uint64_t)estim, comp, bits_of_double(elapsed), bits_of_double(newcst));
 }
 
-void log_basic(event_type_t type) {
-  if (! the_recorder.is_tracked(type))
-    return;
-  // I don't think we want to be calling "new" here; it'd be more efficient
-  // to push the raw event value on the event buffer -- Mike
-  the_recorder.add_nocheck(new basic_event_t(type));
+void log_estim_update(void* estim, double newcst) {
+  log_args(ESTIM_UPDATE, (uint64_t)estim, bits_of_double(newcst));
 }
 
-void log_thread(event_type_t type, sched::thread_p thread) {
-  if (! the_recorder.is_tracked(type))
-    return;
-  the_recorder.add_nocheck(new thread_event_t(type, thread));
-}
-
-void log_thread_fork(event_type_t type, sched::thread_p thread, sched::thread_p threadL, sched::thread_p threadR) {
-  if (! the_recorder.is_tracked(type))
-    return;
-  the_recorder.add_nocheck(new thread_fork_event_t(type, thread, threadL, threadR));
+void log_estim_decide(void* estim, int64_t comp, double bound, bool sequential) {
+  log_args(ESTIM_DECIDE, (uint64_t)estim, (uint64_t)comp, bits_of_double(bound), sequential ? 1 : 0);
 }
 
-
-
 /*---------------------------------------------------------------------*/
 
 
@@ -7,6 +7,13 @@
  * the execution of the program, and dumps them at the end
  * in text format or in binary format.
  *
+ * Each worker appends fixed-size records to a ring buffer of its
+ * own. A background thread, the flusher, moves the records from the
+ * ring buffers to a binary trace file as the program runs. At the
+ * end, the trace file is merged into the formats read by `pview`,
+ * and optionally into the trace-event format read by Chrome and
+ * Perfetto.
+ *
  */
 
 #ifndef _LOGGING_H_
@@ -15,13 +22,16 @@
 #include <string>
 #include <cstdlib>
 #include <cstdio>
+#include <cstdint>
 #include <vector>
-#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <assert.h>
 
 #include "workerlocal.hpp"
 #include "classes.hpp"
 #include "localityrange.hpp"
+#include "hwcounters.hpp"
 
 namespace pasl {
 namespace util {
@@ -74,6 +84,7 @@ typedef enum {
   STEAL_SUCCESS,
   STEAL_FAIL,
   STEAL_ABORT,
+  ESTIM_DECIDE,
   NUM_TYPE_IDS,
 } event_type_t;
 
@@ -104,6 +115,7 @@ static inline std::string name_of(event_type_t type) {
     case STEAL_SUCCESS: return std::string("steal_success");
     case STEAL_FAIL:    return std::string("steal_fail   ");
     case STEAL_ABORT:   return std::string("steal_abort  ");
+    case ESTIM_DECIDE:  return std::string("estim_decide ");
     default: assert(false);
   }
   return "noname"; // never happens
@@ -136,47 +148,141 @@ static inline event_kind_t kind_of_type(event_type_t type) {
     case STEAL_SUCCESS: return STDWS;
     case STEAL_FAIL: return STDWS;
     case STEAL_ABORT: return STDWS;
+    case ESTIM_DECIDE: return ESTIMS;
     default: assert(false);
   }
   return PHASES; // never happens
 }
 
 /*---------------------------------------------------------------------*/
-class event_t_comparison_t;
 
-class event_t {
+#ifdef HWCOUNTERS
+/* The hardware counters are read at the boundaries of the algorithm
+ * and of its phases, whether or not logging is enabled.
+ */
+static inline void hwcounters_hook(event_type_t type) {
+  if (type == ENTER_ALGO)
+    hwcounters::the_counters.enter_algo();
+  else if (type == ALGO_PHASE)
+    hwcounters::the_counters.mark_phase();
+  else if (type == EXIT_ALGO)
+    hwcounters::the_counters.exit_algo();
+}
+#endif
+
+/*---------------------------------------------------------------------*/
+/*! \class record_t
+ *  \brief Trace record, as stored in the ring buffers and in the
+ *  trace file.
+ *
+ * An event whose payload does not fit in the two words `arg1` and
+ * `arg2` is stored as a head record followed by `nb_more` records of
+ * type `CONTINUED`, which carry the rest of the payload. The time is
+ * the value of the cycle counter.
+ */
+struct record_t {
+  uint64_t time;
+  uint32_t type;
+  uint32_t nb_more;
+  uint64_t arg1;
+  uint64_t arg2;
+};
+
+//! Type of the records that extend the payload of the previous record
+static constexpr uint32_t CONTINUED = NUM_TYPE_IDS;
+
+/*---------------------------------------------------------------------*/
+/*! \class ring_t
+ *  \brief Fixed-size, single-producer single-consumer ring of records.
+ *
+ * The producer is the worker that owns the ring, the consumer is the
+ * flusher thread of the recorder. When the ring is full, the producer
+ * waits for the flusher to make room, so that no record is lost.
+ */
+class ring_t {
 private:
-  int64_t id;
-  double time;
+  record_t* items;
+  uint64_t mask;
+  uint64_t cached_tail;        // producer's view of `tail`
+  std::atomic<uint64_t> head;  // written by the producer only
+  char padding[64];
+  std::atomic<uint64_t> tail;  // written by the consumer only
+
+  void wait_for_room(uint64_t h);
 
 public:
+  uint64_t nb_stalls;
 
-  event_t();
+  ring_t();
+  ~ring_t();
 
-  virtual event_type_t get_type () = 0;
+  //! `capacity` must be a power of two
+  void init(uint64_t capacity);
 
-  virtual std::string get_name () = 0;
+  void push(const record_t& r) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    if (h - cached_tail > mask)
+      wait_for_room(h);
+    items[h & mask] = r;
+    head.store(h + 1, std::memory_order_release);
+  }
 
-  virtual void print_byte_descr(FILE* f);
+  //! Writes the records pushed since the last call, then releases them
+  void flush_to(FILE* f, worker_id_t id);
 
-  virtual void print_text_descr(FILE* f);
+};
 
-  virtual void record (microtime_t basetime);
+/*---------------------------------------------------------------------*/
+/*! \class event_t
+ *  \brief Event decoded from a trace file.
+ */
+class event_t {
+public:
+  double time;           // microseconds since the initialization of the recorder
+  worker_id_t id;
+  event_type_t type;
+  uint64_t args[4];
+  std::string name;      // only for ESTIM_NAME
 
-  virtual void print_byte_header (FILE* f);
+  void print_byte (FILE* f);
 
-  virtual void print_byte (FILE* f);
+  void print_text (FILE* f);
+};
 
-  virtual void print_text_header (FILE* f);
+/*---------------------------------------------------------------------*/
+/*! \class trace_reader_t
+ *  \brief Reads the events of a trace file in order of time.
+ *
+ * The trace file is a sequence of blocks, each made of a header that
+ * gives the id of a worker and a number of records, followed by these
+ * records. The records of a given worker are in order of time, so the
+ * reader keeps one cursor per worker, each with a small buffer, and
+ * merges the streams of the workers with a heap. The memory it uses
+ * does not depend on the size of the trace.
+ */
+class trace_reader_t {
+private:
+  class cursor_t;
+  FILE* f;
+  uint64_t basetime;
+  double cycles_per_microsecond;
+  std::vector<cursor_t*> cursors;
+  std::vector<int> heap;   // indices in `cursors`
 
-  virtual void print_text (FILE* f);
+  bool heap_less(int i, int j);
+  void sift_down(size_t k);
 
-  double get_time();
-};
+public:
+  trace_reader_t();
+  ~trace_reader_t();
+
+  void open(std::string fname, uint64_t basetime, double cycles_per_microsecond);
 
-typedef event_t* event_p;
+  //! Returns false when the trace has been consumed
+  bool next(event_t& e);
 
-typedef std::vector<event_p> events_t;
+  void close();
+};
 
 /*---------------------------------------------------------------------*/
 
@@ -184,26 +290,31 @@ class recorder_t {
 private:
   bool real_time;
   bool text_mode;
+  bool chrome_mode;
   bool tracking[NUM_KIND_IDS];
 
-  // LATER: this vector should use the local_allocator
-  
-  typedef data::perworker::extra<events_t> wi_events_t;
-  wi_events_t events_for; 
-  events_t all_events;
-  microtime_t basetime;
+  typedef data::perworker::extra<ring_t> wi_rings_t;
+  wi_rings_t rings;
+  std::string trace_fname;
+  FILE* trace_file;
+  std::thread flusher;
+  std::atomic<bool> flusher_stop;
+  uint64_t basetime;
+  microtime_t basetime_microtime;
+  double cycles_per_microsecond;
 
-private:
-  events_t& get_my_events();
+  void flush_all();
+
+  void calibrate();
 
 public:
 
   recorder_t();
-  
+
   ~ recorder_t();
-  
+
   void init();
-  
+
   void destroy();
 
   void set_tracking_all(bool state);
@@ -212,163 +323,53 @@ public:
 
   bool is_tracked(event_type_t type);
 
-  void add_nocheck(event_p event);
-
-  void add(event_p event);
-
-  void merge_and_sort();
+  //! Adds to the ring of the calling worker the records that encode `e`
+  void add(const event_t& e);
 
   void dump_byte_to (FILE* f);
 
   void dump_text_to (FILE* f);
 
+  //! Writes the events in the JSON trace-event format of Chrome and Perfetto
+  void dump_chrome_to (FILE* f);
+
   void dump_byte ();
 
   void dump_text ();
 
-  void output ();
-
-};
-
-
-/*---------------------------------------------------------------------*/
-// LATER: move definitions below into the CPP file.
-
-class basic_event_t : public event_t {
-protected:
-  event_type_t type;
-public:
-  basic_event_t() {} // need to initialize type
-  basic_event_t(event_type_t type) : type(type) {}
-  virtual event_type_t get_type () { return type; }
-  virtual std::string get_name () { return name_of(type); }
-};
+  void dump_chrome ();
 
-/*---------------------------------------------------------------------*/
-
-class thread_event_t : public basic_event_t {
-protected:
-  sched::thread_p thread;
-public:
-  thread_event_t(event_type_t type, sched::thread_p thread) 
-    : basic_event_t(type), thread(thread) {}
-  void print_byte_descr(FILE* f);
-  virtual void print_text_descr(FILE* f);
-};
-
-/*---------------------------------------------------------------------*/
-
-class thread_fork_event_t : public thread_event_t {
-protected:
-  sched::thread_p threadL, threadR;
-public:
-  thread_fork_event_t(event_type_t type, sched::thread_p thread, sched::thread_p threadL, sched::thread_p threadR) 
-    : thread_event_t(type, thread), threadL(threadL), threadR(threadR) {}
-  void print_byte_descr(FILE* f);
-  virtual void print_text_descr(FILE* f);
-};
-
-/*---------------------------------------------------------------------*/
-
-class locality_event_t : public basic_event_t {
-protected:
-  pasl::data::locality_t pos;
-public:
-  //! type should be LOCALITY_START or LOCALITY_STOP
-  locality_event_t(event_type_t type, pasl::data::locality_t pos)
-    : basic_event_t(type), pos(pos) {}
-  void print_byte_descr(FILE* f);
-  virtual void print_text_descr(FILE* f);
-};
-
-/*---------------------------------------------------------------------*/
+  void output ();
 
-class interrupt_event_t : public basic_event_t {
-protected:
-  double elapsed;
-public:
-  interrupt_event_t(double elapsed) 
-    : basic_event_t(INTERRUPT), elapsed(elapsed) {}
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
 };
 
 /*---------------------------------------------------------------------*/
 
-class estim_event_t : public basic_event_t {
-protected:
-  void* estim;
-public:
-  estim_event_t(void* estim, event_type_t type) 
-    : // basic_event_t(type),  // TODO: why are we not setting the type here??
-    estim(estim) {
-  }
-};
-
-class estim_name_event_t : public estim_event_t {
-private:
-  std::string name;
-public:
-  estim_name_event_t(void* estim, std::string name) 
-    : estim_event_t(estim, ESTIM_NAME), name(name) {
-    this->type = ESTIM_NAME; }
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
-};
+extern recorder_t the_recorder;
 
-class estim_report_event_t : public estim_event_t {
-private:
-  uint64_t comp;
-  double elapsed;
-  double newcst;
-public:
-  estim_report_event_t(void* estim, uint64_t comp, double elapsed, double newcst) 
-    : estim_event_t(estim, ESTIM_REPORT), 
-      comp(comp), elapsed(elapsed), newcst(newcst) {
-    this->type = ESTIM_REPORT; }
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
-};
+void output ();
 
-class estim_update_event_t : public estim_event_t {
-private:
-  double newcst;
-public:
-  estim_update_event_t(void* estim, double newcst) 
-    : estim_event_t(estim, ESTIM_UPDATE), newcst(newcst) {
-      this->type = ESTIM_UPDATE;}
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
-};
+bool is_tracked_kind(event_kind_t kind);
 
-class estim_predict_event_t : public estim_event_t {
-private:
-  int64_t comp;
-  double time;
-public:
-  estim_predict_event_t(void* estim, int64_t comp, double time) 
-    : estim_event_t(estim, ESTIM_PREDICT), comp(comp), time(time) {
-    this->type = ESTIM_PREDICT;}
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
-};
+void log_basic(event_type_t type);
 
+void log_thread(event_type_t type, sched::thread_p thread);
 
-/*---------------------------------------------------------------------*/
+void log_thread_fork(event_type_t type, sched::thread_p threadP, sched::thread_p threadL, sched::thread_p threadR);
 
-extern recorder_t the_recorder;
+void log_locality(event_type_t type, pasl::data::locality_t pos);
 
-void output ();
+void log_interrupt(double elapsed);
 
-void log_event(event_p event);
+void log_estim_name(void* estim, std::string name);
 
-bool is_tracked_kind(event_kind_t kind);
+void log_estim_predict(void* estim, int64_t comp, double time);
 
-void log_basic(event_type_t type);
+void log_estim_report(void* estim, uint64_t comp, double elapsed, double newcst);
 
-void log_thread(event_type_t type, sched::thread_p thread);
+void log_estim_update(void* estim, double newcst);
 
-void log_thread_fork(event_type_t type, sched::thread_p threadP, sched::thread_p threadL, sched::thread_p threadR);
+void log_estim_decide(void* estim, int64_t comp, double bound, bool sequential);
 
 /***********************************************************************/
 
@@ -378,24 +379,34 @@ void log_thread_fork(event_type_t type, sched::thread_p threadP, sched::thread_p
 
 #ifdef LOGGING
 
-#define LOG_EVENT(event_kind, event) if (pasl::util::logging::is_tracked_kind(pasl::util::logging::event_kind)) pasl::util::logging::log_event(event)
 #define LOG_BASIC(type) pasl::util::logging::log_basic(pasl::util::logging::type)
 #define LOG_THREAD(type, thread) pasl::util::logging::log_thread(pasl::util::logging::type, thread)
 #define LOG_THREAD_FORK(thread, threadL, threadR) pasl::util::logging::log_thread_fork(pasl::util::logging::THREAD_FORK, thread, threadL, threadR)
-#define LOG_ESTIM(event) LOG_EVENT(ESTIMS, event)
-#define LOG_CSTS(event) LOG_EVENT(CSTS, event)
-#define LOG_STDWS(event) LOG_EVENT(STDWS, event)
+#define LOG_LOCALITY(type, pos) pasl::util::logging::log_locality(pasl::util::logging::type, pos)
+#define LOG_INTERRUPT(elapsed) pasl::util::logging::log_interrupt(elapsed)
+#define LOG_ESTIM_NAME(estim, name) pasl::util::logging::log_estim_name(estim, name)
+#define LOG_ESTIM_PREDICT(estim, comp, time) pasl::util::logging::log_estim_predict(estim, comp, time)
+#define LOG_ESTIM_REPORT(estim, comp, elapsed, newcst) pasl::util::logging::log_estim_report(estim, comp, elapsed, newcst)
+#define LOG_ESTIM_UPDATE(estim, newcst) pasl::util::logging::log_estim_update(estim, newcst)
+#define LOG_ESTIM_DECIDE(estim, comp, bound, sequential) pasl::util::logging::log_estim_decide(estim, comp, bound, sequential)
 #define LOG_ONLY(code) code
 
 #else
 
-#define LOG_EVENT(event_kind, event) 
+#ifdef HWCOUNTERS
+#define LOG_BASIC(type) pasl::util::logging::hwcounters_hook(pasl::util::logging::type)
+#else
 #define LOG_BASIC(event_type) 
+#endif
 #define LOG_THREAD(event_type, thread) 
 #define LOG_THREAD_FORK(thread, threadL, threadR) 
-#define LOG_ESTIM(event) 
-#define LOG_CSTS(event) 
-#define LOG_STDWS(event) 
+#define LOG_LOCALITY(event_type, pos)
+#define LOG_INTERRUPT(elapsed)
+#define LOG_ESTIM_NAME(estim, name)
+#define LOG_ESTIM_PREDICT(estim, comp, time)
+#define LOG_ESTIM_REPORT(estim, comp, elapsed, newcst)
+#define LOG_ESTIM_UPDATE(estim, newcst)
+#define LOG_ESTIM_DECIDE(estim, comp, bound, sequential)
 #define LOG_ONLY(code)
 
 #endif 
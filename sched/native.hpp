@@ -100,7 +100,7 @@ public:
       return;
     if (stack == notownstackptr)
       return;
-    free(stack);
+    ucxt::stack_free(stack);
     stack = nullptr;
   }
 
@@ -118,15 +118,25 @@ public:
   }
 
   void finish(multishot_p thread) {
-    instrategy::distributed* dist = new instrategy::distributed(this);
-    threaddag::unary_fork_join(thread, this, dist);
+    instrategy_p in = threaddag::new_finish_instrategy(this);
+    threaddag::unary_fork_join(thread, this, in);
     prepare_and_swap_with_scheduler();
   }
 
-  void fork2(multishot_p thread0, multishot_p thread1) {
+  /* With `help_first`, neither branch runs eagerly: both are left in
+   * the deque, where they can be stolen, and this thread resumes once
+   * both have completed. Otherwise, `thread0` runs immediately on the
+   * stack of this thread (work first).
+   */
+  void fork2(multishot_p thread0, multishot_p thread1, bool help_first = false) {
     LOG_THREAD_FORK(this, thread0, thread1);
     prepare();
     threaddag::binary_fork_join(thread0, thread1, this);
+    if (help_first) {
+      STAT_COUNT(FORK_HELP_FIRST);
+      swap_with_scheduler();
+      return;
+    }
     if (context::capture<multishot*>(context::addr(cxt))) {
       //      util::atomic::aprintf("steal happened: executing join continuation\n");
       return;
@@ -211,8 +221,40 @@ static inline int my_deque_size() {
 
 /*---------------------------------------------------------------------*/
 
+/*! \brief Policy used by `fork2` to run its two branches, selected
+ *  by the command-line option `-spawn_policy`.
+ *
+ * - `SPAWN_WORK_FIRST` runs the first branch immediately, and leaves
+ *    the second one to be stolen.
+ * - `SPAWN_HELP_FIRST` pushes both branches, and runs neither eagerly.
+ * - `SPAWN_ADAPTIVE` uses help first while threads are being stolen
+ *    from the calling worker at a rate of at least
+ *    `spawn_adaptive_threshold` per fork, and work first otherwise.
+ *    The rate is sampled every `spawn_adaptive_window` forks; a worker
+ *    starts with help first, so that the work spreads quickly.
+ */
+typedef enum {
+  SPAWN_WORK_FIRST,
+  SPAWN_HELP_FIRST,
+  SPAWN_ADAPTIVE
+} spawn_policy_t;
+
+extern spawn_policy_t spawn_policy;
+extern int spawn_adaptive_window;
+extern double spawn_adaptive_threshold;
+
+bool should_help_first_adaptive();
+
+static inline bool should_help_first(spawn_policy_t policy) {
+  switch (policy) {
+    case SPAWN_WORK_FIRST: return false;
+    case SPAWN_HELP_FIRST: return true;
+    default: return should_help_first_adaptive();
+  }
+}
+
 template <class Exp1, class Exp2>
-void fork2(const Exp1& exp1, const Exp2& exp2) {
+void fork2(const Exp1& exp1, const Exp2& exp2, spawn_policy_t policy) {
 #if defined(SEQUENTIAL_ELISION)
   exp1();
   exp2();
@@ -222,16 +264,36 @@ void fork2(const Exp1& exp1, const Exp2& exp2) {
   cilk_sync;
 #else
   my_thread()->fork2(new_multishot_by_lambda(exp1),
-                     new_multishot_by_lambda(exp2));
+                     new_multishot_by_lambda(exp2),
+                     should_help_first(policy));
 #endif
 }
 
+template <class Exp1, class Exp2>
+void fork2(const Exp1& exp1, const Exp2& exp2) {
+  fork2(exp1, exp2, spawn_policy);
+}
+
 template <class Body>
 void async(const Body& body, multishot* join) {
   multishot* thread = new_multishot_by_lambda(body);
   my_thread()->async(thread, join);
 }
 
+/*! \brief Same as `async`, with `body` running in the priority lane
+ *  `priority`.
+ *
+ * A thread of priority `PRIORITY_HIGH` runs before the threads of
+ * normal priority of the same worker, and is the first to be stolen.
+ * The threads created by `body` have normal priority.
+ */
+template <class Body>
+void async(const Body& body, multishot* join, priority_t priority) {
+  multishot* thread = new_multishot_by_lambda(body);
+  thread->set_priority(priority);
+  my_thread()->async(thread, join);
+}
+
 template <class Body>
 void finish(const Body& body) {
   multishot* join = my_thread();
@@ -519,25 +581,47 @@ void parallel_while_cas_ri(Input& input, const Size_input& size_input, const For
 #endif
 }
 
+/*! \brief Returns true if a loop that runs on the calling worker
+ *  should split off half of its remaining iterations.
+ *
+ * This is the case when the ready threads of the worker have all been
+ * taken, so that no other worker can find work there, or when another
+ * worker is waiting for an answer to a steal request, which the
+ * calling worker can serve only if it creates a thread first.
+ */
+static inline bool should_split_loop() {
+#if defined(USE_CILK_RUNTIME)
+  return my_deque_size() == 0;
+#else
+  scheduler_p sched = threaddag::my_sched();
+  return sched->nb_threads() == 0 || sched->should_call_communicate();
+#endif
+}
+
+/* Lazy binary splitting, a la Tzannes et al: the body consumes the
+ * input piece by piece, and the remaining input is split in two only
+ * when `should_split_loop()` says that the split is likely to be
+ * useful. The cost of a split is therefore paid only when some worker
+ * is in need of work, not once every `loop_cutoff` iterations.
+ */
 template <class Input, class Output,
           class Size_input, class Fork_input, class Join_output,
           class Set_in_env, class Set_out_env,
           class Body>
 void parallel_while_lazy(Input& input, Output& output,
-                         const Size_input& size_input, const Fork_input& fork_input, const Join_output& join,
+                         const Size_input& size_input, const Fork_input& fork_input, const Join_output& join_output,
                          const Set_in_env& set_in_env, const Set_out_env& set_out_env,
                          const Body& body) {
-  set_in_env(input);
   size_t sz = size_input(input);
   while (sz > 0) {
-    if (sz > 1 && my_deque_size() == 0) {
+    if (sz > 1 && should_split_loop()) {
       Input input2;
       Output output2;
       set_in_env(input2);
       set_out_env(output2);
       fork_input(input, input2);
-      fork2([&] { parallel_while_cilk_rec(input, output, size_input, fork_input, set_in_env, set_out_env, body); },
-            [&] { parallel_while_cilk_rec(input2, output2, size_input, fork_input, set_in_env, set_out_env, body); });
+      fork2([&] { parallel_while_lazy(input, output, size_input, fork_input, join_output, set_in_env, set_out_env, body); },
+            [&] { parallel_while_lazy(input2, output2, size_input, fork_input, join_output, set_in_env, set_out_env, body); });
       join_output(output, output2);
       return;
     }
@@ -581,9 +665,29 @@ void forkjoin(Input& in, Output& out,
 
 extern int loop_cutoff;
 
+/*! \brief Loop engine used by `combine`, `parallel_for` and
+ *  `parallel_for1`, selected by the command-line option `-loop_mode`.
+ *
+ * - `LOOP_EAGER` splits the range down to the cutoff, up front.
+ * - `LOOP_LAZY` runs the range by chunks of at most `loop_lazy_chunk`
+ *    iterations, and splits it only on demand (see `parallel_while_lazy`).
+ */
+typedef enum {
+  LOOP_EAGER,
+  LOOP_LAZY
+} loop_mode_t;
+
+extern loop_mode_t loop_mode;
+extern int loop_lazy_chunk;
+
+/* The body of `combine_range` and of `parallel_for_range` is applied
+ * to whole subranges `[lo, hi)` rather than to one index at a time, so
+ * that the compiler sees a plain loop in each leaf, which it can
+ * unroll or vectorize.
+ */
 template <class Number, class Output, class Join_output, class Body, class Cutoff>
-void combine(Number lo, Number hi, Output& out, const Join_output& join,
-              const Body& body, const Cutoff& cutoff) {
+void combine_range(Number lo, Number hi, Output& out, const Join_output& join,
+                   const Body& body, const Cutoff& cutoff) {
   using range_type = std::pair<Number, Number>;
   range_type in(lo, hi);
   auto fork = [] (range_type& src, range_type& dst) {
@@ -593,22 +697,90 @@ void combine(Number lo, Number hi, Output& out, const Join_output& join,
     src.second = mid;
   };
   auto _body = [&body] (range_type r, Output& out) {
+    body(r.first, r.second, out);
+  };
+  forkjoin(in, out, cutoff, fork, join, _body);
+}
+
+template <class Number, class Output, class Join_output, class Body>
+void combine_range_lazy(Number lo, Number hi, Output& out, const Join_output& join,
+                        const Body& body, int chunk) {
+  using range_type = std::pair<Number, Number>;
+  range_type in(lo, hi);
+  Number chunk_size = Number(std::max(1, chunk));
+  auto size = [] (range_type& r) {
+    return size_t(r.second - r.first);
+  };
+  auto fork = [] (range_type& src, range_type& dst) {
+    Number mid = (src.first + src.second) / 2;
+    dst.first = mid;
+    dst.second = src.second;
+    src.second = mid;
+  };
+  auto set_in_env = [] (range_type&) { };
+  auto set_out_env = [] (Output&) { };
+  auto _body = [&body, chunk_size] (range_type& r, Output& out) {
     Number lo = r.first;
-    Number hi = r.second;
+    Number hi = std::min(r.second, Number(lo + chunk_size));
+    body(lo, hi, out);
+    r.first = hi;
+  };
+  parallel_while_lazy(in, out, size, fork, join, set_in_env, set_out_env, _body);
+}
+
+/* With `LOOP_LAZY`, the cutoff bounds the size of the chunks that run
+ * between two checks for a split.
+ */
+template <class Number, class Output, class Join_output, class Body>
+void combine_range(Number lo, Number hi, Output& out, const Join_output& join,
+                   const Body& body, int cutoff = loop_cutoff) {
+#if ! defined(SEQUENTIAL_ELISION) && (! defined(USE_CILK_RUNTIME) || defined(__PASL_CILK_EXT))
+  if (loop_mode == LOOP_LAZY) {
+    combine_range_lazy(lo, hi, out, join, body, std::min(cutoff, loop_lazy_chunk));
+    return;
+  }
+#endif
+  using range_type = std::pair<Number, Number>;
+  auto cutoff_fct = [cutoff] (range_type r) {
+    return r.second - r.first <= cutoff;
+  };
+  combine_range(lo, hi, out, join, body, cutoff_fct);
+}
+
+template <class Number, class Output, class Join_output, class Body, class Cutoff>
+void combine(Number lo, Number hi, Output& out, const Join_output& join,
+             const Body& body, const Cutoff& cutoff) {
+  auto _body = [&body] (Number lo, Number hi, Output& out) {
     for (Number i = lo; i < hi; i++)
       body(i, out);
   };
-  forkjoin(in, out, cutoff, fork, join, _body);
+  combine_range(lo, hi, out, join, _body, cutoff);
 }
 
 template <class Number, class Output, class Join_output, class Body>
 void combine(Number lo, Number hi, Output& out, const Join_output& join,
              const Body& body, int cutoff = loop_cutoff) {
-  using range_type = std::pair<Number, Number>;
-  auto cutoff_fct = [cutoff] (range_type r) {
-    return r.second - r.first <= cutoff;
+  auto _body = [&body] (Number lo, Number hi, Output& out) {
+    for (Number i = lo; i < hi; i++)
+      body(i, out);
+  };
+  combine_range(lo, hi, out, join, _body, cutoff);
+}
+
+template <class Number, class Body>
+void parallel_for_range(Number lo, Number hi, const Body& body, int cutoff = loop_cutoff) {
+#if defined(SEQUENTIAL_ELISION)
+  if (lo < hi)
+    body(lo, hi);
+#else
+  struct { } output;
+  using output_type = typeof(output);
+  auto join = [] (output_type,output_type) { };
+  auto _body = [&body] (Number lo, Number hi, output_type) {
+    body(lo, hi);
   };
-  combine(lo, hi, out, join, body, cutoff_fct);
+  combine_range(lo, hi, output, join, _body, cutoff);
+#endif
 }
 
 template <class Number, class Body>
@@ -622,13 +794,10 @@ void parallel_for(Number lo, Number hi, const Body& body) {
     body(i);
     */
 #else
-  struct { } output;
-  using output_type = typeof(output);
-  auto join = [] (output_type,output_type) { };
-  auto _body = [&body] (Number i, output_type) {
-    body(i);
-  };
-  combine(lo, hi, output, join, _body);
+  parallel_for_range(lo, hi, [&body] (Number lo, Number hi) {
+    for (Number i = lo; i < hi; i++)
+      body(i);
+  });
 #endif
 }
 
@@ -644,16 +813,12 @@ void parallel_for1(Number lo, Number hi, const Body& body) {
     */
 #else
   struct { } output;
-  using range_type = std::pair<Number, Number>;
-  auto cutoff = [] (range_type r) {
-    return r.second - r.first <= 2;
-  };
   using output_type = typeof(output);
   auto join = [] (output_type,output_type) { };
   auto _body = [&body] (Number i, output_type) {
     body(i);
   };
-  combine(lo, hi, output, join, _body, cutoff);
+  combine(lo, hi, output, join, _body, 2);
 #endif
 }
 
@@ -55,7 +55,7 @@ namespace outstrategy {
  *
  * \ingroup outstrategy
  */
-class signature {
+class signature : public util::slab::allocated {
 public:
 
   //! Adds the given thread `td` to the list of out-going edges
@@ -12,6 +12,8 @@ namespace scheduler {
 
 util::worker::controller_factory_t* the_factory;
 
+data::perworker::array<std::atomic<uint64_t>> nb_stolen_from;
+
 bool _private::stay() {
   return ! periodic_set.empty() || ! util::worker::the_group.exit_controller();
 }
@@ -21,6 +23,7 @@ bool _private::stay() {
 
 void _private::init() { 
   controller_t::init();
+  HWCOUNTERS(open_mine());
   //add_periodic(messagestrategy::the_messagestrategy);
   current_thread = nullptr;
   should_communicate = false;
@@ -28,6 +31,7 @@ void _private::init() {
 
 void _private::destroy() {
   controller_t::destroy();
+  HWCOUNTERS(close_mine());
   //rem_periodic(messagestrategy::the_messagestrategy);
 }
 
@@ -66,8 +70,10 @@ void _private::exec(thread_p t) {
   assert(t != nullptr);
   LOG_THREAD(THREAD_EXEC, t);
   STAT_COUNT(THREAD_EXEC);
+  STAT_IDLE(note_exec());
+  STAT_IDLE(add_to_queueing_time(t->priority, util::ticks::seconds_since(t->date_added)));
 #ifdef TRACK_LOCALITY
-  LOG_EVENT(LOCALITY, new util::logging::locality_event_t(logging::LOCALITY_START, t->locality.low));
+  LOG_LOCALITY(LOCALITY_START, t->locality.low);
 #endif
   bool should_not_deallocate = t->should_not_deallocate;
   reuse_thread_requested = false;
@@ -81,7 +87,7 @@ void _private::exec(thread_p t) {
   t->exec();
   allow_interrupt = false;
 #ifdef TRACK_LOCALITY
-  LOG_EVENT(LOCALITY, new util::logging::locality_event_t(logging::LOCALITY_STOP, t->locality.hi));
+  LOG_LOCALITY(LOCALITY_STOP, t->locality.hi);
 #endif
   //! \todo could handle interrupt_was_blocked
   if (should_not_deallocate || reuse_thread_requested)
@@ -104,7 +110,7 @@ void _private::add_dependency(thread_p t1, thread_p t2) {
   assert (t1->out != nullptr);
   assert (t2->in != nullptr);
   outstrategy::add(t1->out, t2);
-  instrategy::delta(t2->in, t2, +1l);
+  instrategy::add_edge(t2->in, t1, t2);
 }
 
 outstrategy_p _private::capture_outstrategy() {
@@ -130,6 +136,8 @@ void _private::schedule(thread_p t) {
   t->in = nullptr;
   assert (t->out != nullptr);
   LOG_THREAD(THREAD_SCHEDULE, t);
+  // a join continuation becomes ready only once its children finish
+  STAT_IDLE_ONLY(t->date_added = util::ticks::now());
   if (! allow_interrupt)
     add_to_pool_of_ready_threads(t);
   else {
@@ -10,11 +10,14 @@
 
 
 #include <cstdlib>
+#include <atomic>
 
 #include "logging.hpp"
 #include "instrategy.hpp"
 #include "outstrategy.hpp"
 #include "stats.hpp"
+#include "victims.hpp"
+#include "arena.hpp"
 
 #ifndef _SCHEDULER_H_
 #define _SCHEDULER_H_
@@ -28,6 +31,9 @@ namespace scheduler {
 typedef util::worker::controller_t controller_t;
 typedef controller_t* controller_p;
 
+//! Number of threads stolen from each worker since the start of the program
+extern data::perworker::array<std::atomic<uint64_t>> nb_stolen_from;
+
 class _private : public signature {
 protected:
 
@@ -46,6 +52,37 @@ protected:
    */
   virtual bool stay();
 
+  /*! \brief Returns the target of the next steal attempt of the worker,
+   *  or `util::worker::undef` if it has no possible victim
+   */
+  worker_id_t select_victim() {
+    return victims::the_selector.select(my_id, [&] { return myrand(); });
+  }
+
+  /*! \brief Same as `random_other`, restricted to the arena of the
+   *  worker; returns `util::worker::undef` if it is alone in its arena
+   */
+  worker_id_t random_peer() {
+    if (arena::is_isolated())
+      return arena::random_peer(my_id, myrand());
+    return random_other();
+  }
+
+  //! Starts the next job submitted to the arena of the worker, if any
+  bool start_next_job() {
+    return arena::start_next(arena::of_worker(my_id));
+  }
+
+  //! To be called after a successful steal from worker `victim`
+  void found_victim(worker_id_t victim) {
+    victims::the_selector.found(my_id);
+    nb_stolen_from[victim].fetch_add(1, std::memory_order_relaxed);
+    if (victims::the_selector.level_of(my_id, victim) == victims::LEVEL_REMOTE)
+      STAT_COUNT(STEAL_REMOTE);
+    else
+      STAT_COUNT(STEAL_LOCAL);
+  }
+
 
 public:
   
@@ -0,0 +1,187 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file snzi.cpp
+ *
+ */
+
+#include <algorithm>
+
+#include "snzi.hpp"
+#include "pcmdline.hpp"
+
+namespace pasl {
+namespace sched {
+namespace instrategy {
+
+/***********************************************************************/
+
+static int arity = 0;
+
+static int get_arity() {
+  if (arity == 0)
+    arity = std::max(2, util::cmdline::parse_or_default_int("snzi_arity", 2, false));
+  return arity;
+}
+
+/*---------------------------------------------------------------------*/
+
+/* The state of a node other than the root packs its surplus, counted
+ * in halves so as to represent the intermediate value 1/2, in the high
+ * word, and a version number in the low word. The surplus of the root
+ * is a plain counter.
+ */
+class snzi::node {
+public:
+
+  std::atomic<uint64_t> state;
+  node_p parent;
+  char padding[128 - sizeof(std::atomic<uint64_t>) - sizeof(node_p)];
+
+  static constexpr uint64_t half = 1;
+  static constexpr uint64_t one = 2;
+
+  static uint64_t count_of(uint64_t x) {
+    return x >> 32;
+  }
+
+  static uint64_t version_of(uint64_t x) {
+    return x & 0xffffffffull;
+  }
+
+  static uint64_t make(uint64_t count, uint64_t version) {
+    return (count << 32) | (version & 0xffffffffull);
+  }
+
+  node() : parent(nullptr) {
+    state.store(0);
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+
+int snzi::nb_nodes_for(int nb_workers, int arity) {
+  int nb = 0;
+  int width = std::max(1, nb_workers);
+  while (width > 1) {
+    nb += width;
+    width = (width + arity - 1) / arity;
+  }
+  return nb + 1;
+}
+
+/* Nodes are laid out level by level, from the leaves up to the root,
+ * which is the last node.
+ */
+snzi::snzi(thread_p t) : t(t) {
+  int nb_workers = util::worker::get_nb();
+  int k = get_arity();
+  nb_nodes = nb_nodes_for(nb_workers, k);
+  nodes = new node[nb_nodes];
+  int level_start = 0;
+  int width = std::max(1, nb_workers);
+  while (width > 1) {
+    int parent_start = level_start + width;
+    for (int i = 0; i < width; i++)
+      nodes[level_start + i].parent = &nodes[parent_start + i / k];
+    level_start = parent_start;
+    width = (width + k - 1) / k;
+  }
+  root = &nodes[nb_nodes - 1];
+  assert(level_start == nb_nodes - 1);
+}
+
+snzi::~snzi() {
+  delete [] nodes;
+}
+
+snzi::node_p snzi::leaf_of(worker_id_t id) {
+  if (id == util::worker::undef)
+    id = 0;
+  return (nb_nodes == 1) ? root : &nodes[id];
+}
+
+void snzi::arrive(node_p n) {
+  if (n == root) {
+    n->state.fetch_add(1);
+    return;
+  }
+  bool succ = false;
+  int nb_undo = 0;
+  while (! succ) {
+    uint64_t x = n->state.load();
+    uint64_t c = node::count_of(x);
+    if (c >= node::one) {
+      if (n->state.compare_exchange_strong(x, node::make(c + node::one, node::version_of(x))))
+        succ = true;
+    } else if (c == 0) {
+      uint64_t y = node::make(node::half, node::version_of(x) + 1);
+      if (n->state.compare_exchange_strong(x, y)) {
+        succ = true;
+        x = y;
+        c = node::half;
+      }
+    }
+    if (c == node::half) {
+      // help the arrival in progress, which may be ours
+      arrive(n->parent);
+      if (! n->state.compare_exchange_strong(x, node::make(node::one, node::version_of(x))))
+        nb_undo++;
+    }
+  }
+  // the surplus of the parent is positive, so these cannot bring it to zero
+  for (; nb_undo > 0; nb_undo--)
+    depart(n->parent);
+}
+
+bool snzi::depart(node_p n) {
+  if (n == root)
+    return n->state.fetch_sub(1) == 1;
+  while (true) {
+    uint64_t x = n->state.load();
+    uint64_t c = node::count_of(x);
+    assert(c >= node::one);
+    if (n->state.compare_exchange_strong(x, node::make(c - node::one, node::version_of(x)))) {
+      if (c == node::one)
+        return depart(n->parent);
+      return false;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------*/
+
+void snzi::check(thread_p t) {
+  assert(t == this->t);
+  if (root->state.load() == 0)
+    start(t);
+}
+
+void snzi::delta(thread_p t, int64_t d) {
+  assert(t == this->t);
+  if (root->state.fetch_add(d) + d == 0)
+    start(t);
+}
+
+void snzi::add_edge(thread_p src, thread_p t) {
+  assert(t == this->t);
+  // a tagged outstrategy only records `t`, so that it can be replaced
+  if (outstrategy::extract_tag(src->out) <= 0)
+    util::atomic::die("snzi: the source thread must have a tagged outstrategy\n");
+  node_p n = leaf_of(util::worker::get_my_id());
+  arrive(n);
+  src->set_outstrategy(new outstrategy::snzi_edge(this, n));
+}
+
+void snzi::finished_edge(node_p n) {
+  if (depart(n))
+    start(t);
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
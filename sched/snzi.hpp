@@ -0,0 +1,123 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file snzi.hpp
+ * \brief Join counters based on scalable non-zero indicators
+ *
+ */
+
+#ifndef _PASL_SCHED_SNZI_H_
+#define _PASL_SCHED_SNZI_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "instrategy.hpp"
+#include "outstrategy.hpp"
+
+namespace pasl {
+namespace sched {
+
+/***********************************************************************/
+
+namespace instrategy {
+
+/*---------------------------------------------------------------------*/
+/*! \class snzi
+ *  \brief Maintains the join counter in a tree of scalable non-zero
+ *  indicators (Ellen et al., PODC'07).
+ *
+ * The tree has one leaf per worker and internal nodes of arity
+ * `-snzi_arity` (by default 2), so that its height grows with the
+ * logarithm of the number of workers. A dependency added by
+ * `add_edge` arrives at the leaf of the calling worker; the node is
+ * recorded in the outstrategy of the source thread, which departs
+ * from the same node when the source thread finishes. A node
+ * propagates an arrival to its parent only when its own surplus goes
+ * from zero to nonzero, and a departure only when it goes back to
+ * zero, so that the root, which is a plain counter, sees little
+ * contention. The thread is started by the departure that brings the
+ * root to zero.
+ *
+ * Calls to `delta`, which do not carry an edge, go straight to the
+ * root.
+ */
+class snzi : public common {
+public:
+
+  class node;
+  typedef node* node_p;
+
+private:
+
+  node_p nodes;
+  int nb_nodes;
+  node_p root;
+  thread_p t;
+
+  node_p leaf_of(worker_id_t id);
+
+  void arrive(node_p n);
+  // returns true if the root has reached zero
+  bool depart(node_p n);
+
+public:
+
+  snzi(thread_p t);
+  ~snzi();
+
+  void check(thread_p t);
+
+  void delta(thread_p t, int64_t d);
+
+  void add_edge(thread_p src, thread_p t);
+
+  //! Called by the outstrategy of a source thread that has finished
+  void finished_edge(node_p n);
+
+  //! Returns the number of nodes in the tree for the given number of workers
+  static int nb_nodes_for(int nb_workers, int arity);
+
+};
+
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+
+namespace outstrategy {
+
+/*! \class snzi_edge
+ *  \brief Outstrategy of a thread on which an `instrategy::snzi`
+ *  depends; remembers the node at which the dependency was added.
+ * \ingroup outstrategy
+ */
+class snzi_edge : public common {
+protected:
+  instrategy::snzi* in;
+  instrategy::snzi::node_p n;
+
+public:
+
+  snzi_edge(instrategy::snzi* in, instrategy::snzi::node_p n)
+  : in(in), n(n) { }
+
+  void add(thread_p td) {
+    util::atomic::die("snzi_edge: cannot add an out edge");
+  }
+
+  void finished() {
+    in->finished_edge(n);
+    common::finished();
+  }
+
+};
+
+} // end namespace
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_SNZI_H_ */
@@ -6,6 +6,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "stats.hpp"
 #include "pcmdline.hpp"
 
@@ -27,8 +29,33 @@ void stats_data_t::reset() {
   waiting_time = 0.0;
   sequential_time = 0.0;
   spinning_time = 0.0;
+  sleeping_time = 0.0;
+  first_exec_time = never;
   for (int i = 0; i < NB_STATS; i++)
     counters[i] = 0;
+  for (int k = 0; k < nb_steal_batch_buckets; k++)
+    steal_batch_histogram[k] = 0;
+  for (int p = 0; p < sched::nb_priorities; p++) {
+    nb_queued[p] = 0;
+    queueing_time[p] = 0.0;
+    max_queueing_time[p] = 0.0;
+  }
+}
+
+void stats_data_t::add(const stats_data_t& other) {
+  waiting_time += other.waiting_time;
+  sequential_time += other.sequential_time;
+  for (/*stat_type_t*/ int stat_type = 0; stat_type < NB_STATS; stat_type++)
+    counters[stat_type] += other.counters[stat_type];
+  for (int k = 0; k < nb_steal_batch_buckets; k++)
+    steal_batch_histogram[k] += other.steal_batch_histogram[k];
+  spinning_time += other.spinning_time;
+  sleeping_time += other.sleeping_time;
+  for (int p = 0; p < sched::nb_priorities; p++) {
+    nb_queued[p] += other.nb_queued[p];
+    queueing_time[p] += other.queueing_time[p];
+    max_queueing_time[p] = std::max(max_queueing_time[p], other.max_queueing_time[p]);
+  }
 }
 
 /*---------------------------------------------------------------------*/
@@ -52,11 +79,38 @@ void stats_private_t::add_to_spinning_time(double elapsed) {
   data.spinning_time += elapsed;
 }
 
+void stats_private_t::add_to_sleeping_time(double elapsed) {
+  data.sleeping_time += elapsed;
+}
+
+void stats_private_t::add_to_steal_batch_histogram(size_t nb_threads) {
+  assert(nb_threads > 0);
+  int k = 0;
+  while (k + 1 < nb_steal_batch_buckets && (nb_threads >> (k + 1)) > 0)
+    k++;
+  data.steal_batch_histogram[k]++;
+  data.counters[THREAD_STOLEN] += nb_threads;
+}
+
+void stats_private_t::note_exec() {
+  if (data.first_exec_time == never)
+    data.first_exec_time = microtime::now();
+}
+
+void stats_private_t::add_to_queueing_time(sched::priority_t priority, double elapsed) {
+  data.nb_queued[priority]++;
+  data.queueing_time[priority] += elapsed;
+  data.max_queueing_time[priority] = std::max(data.max_queueing_time[priority], elapsed);
+}
+
 /*---------------------------------------------------------------------*/
 
 stats_t::stats_t() { 
   launch_enter_time = never;
   launch_exit_time = never;
+  ramp_up_time = -1.0;
+  nb_stacks_in_use.store(0);
+  peak_stacks_in_use.store(0);
 }
 
 stats_t::~stats_t() {
@@ -71,22 +125,29 @@ void stats_t::reset() {
   // later : stats.foreach
   for (int64_t id = worker::undef; id < nb_workers; id++) 
     stats[id].data.reset();
+  peak_stacks_in_use.store(nb_stacks_in_use.load());
 }
 
 void stats_t::sum() {
   total_data.reset();
+  int nb_arenas = sched::arena::get_nb();
+  for (int a = 0; a < nb_arenas; a++)
+    arena_data[a].reset();
   int64_t nb_workers = worker::get_nb();
+  // the measures of the threads that are not workers go to arena 0
   for (int64_t id = worker::undef; id < nb_workers; id++) {
     stats_data_t& local_data = stats[id].data;
-    total_data.waiting_time += local_data.waiting_time;
-    total_data.sequential_time += local_data.sequential_time;
-    for (/*stat_type_t*/ int stat_type = 0; stat_type < NB_STATS; stat_type++)
-      total_data.counters[stat_type] += local_data.counters[stat_type];
-    total_data.spinning_time += local_data.spinning_time;
+    total_data.add(local_data);
+    arena_data[sched::arena::of_worker(worker_id_t(id))].add(local_data);
   }
   double cumulated_time = launch_duration * nb_workers;
+  for (int a = 0; a < nb_arenas; a++) {
+    int nb = sched::arena::get_nb_workers(a);
+    arena_utilization[a] = 1.0 - arena_data[a].waiting_time / (launch_duration * nb);
+  }
   total_idle_time = total_data.waiting_time;
   total_spinning_time = total_data.spinning_time;
+  total_sleeping_time = total_data.sleeping_time;
   relative_idle = total_idle_time / cumulated_time; 
   utilization = 1.0 - relative_idle;
   relative_non_seq = 1.0 - total_data.sequential_time / cumulated_time; 
@@ -101,6 +162,19 @@ void stats_t::sum() {
 void stats_t::print_idle(FILE* f) {
   // fprintf(f, "total_idle_time %.3lf\n", total_idle_time);
   fprintf(f, "utilization %.4lf\n", utilization);
+  fprintf(f, "ramp_up %.6lf\n", ramp_up_time);
+  if (sched::arena::get_nb() > 1)
+    for (int a = 0; a < sched::arena::get_nb(); a++)
+      fprintf(f, "arena%d_utilization %.4lf\n", a, arena_utilization[a]);
+  sched::arena::print_stats(f);
+  // delays in microseconds, for the lanes that executed some thread
+  for (int p = 0; p < sched::nb_priorities; p++) {
+    uint64_t nb = total_data.nb_queued[p];
+    if (nb == 0)
+      continue;
+    fprintf(f, "queueing_delay_mean_lane%d %.3lf\n", p, 1000000. * total_data.queueing_time[p] / nb);
+    fprintf(f, "queueing_delay_max_lane%d %.3lf\n", p, 1000000. * total_data.max_queueing_time[p]);
+  }
 }
 
 void stats_t::print(FILE* f) {
@@ -113,10 +187,23 @@ void stats_t::print(FILE* f) {
     fprintf(f, "average_sequential\t%.3lf\n", average_sequentialized);
     fprintf(f, "relative_non_seq\t%.4lf\n", relative_non_seq);
     fprintf(f, "total_spinning_time\t%lf\n", total_spinning_time);
+    fprintf(f, "total_sleeping_time\t%lf\n", total_sleeping_time);
+    fprintf(f, "stack_peak_in_use\t%ld\n", (long)peak_stacks_in_use.load());
     for (int i = 0; i < NB_STATS; i++)
       fprintf(f, "%s\t%ld\n", 
               name_of_type((stat_type_t) i).c_str(),
               (long)total_data.counters[i]);
+    for (int k = 0; k < nb_steal_batch_buckets; k++)
+      fprintf(f, "steal_batch_%ld\t%ld\n",
+              1l << k, (long)total_data.steal_batch_histogram[k]);
+    if (sched::arena::get_nb() > 1)
+      for (int a = 0; a < sched::arena::get_nb(); a++) {
+        fprintf(f, "arena%d_total_sequential\t%.3lf\n", a, arena_data[a].sequential_time);
+        for (int i = 0; i < NB_STATS; i++)
+          fprintf(f, "arena%d_%s\t%ld\n", a,
+                  name_of_type((stat_type_t) i).c_str(),
+                  (long)arena_data[a].counters[i]);
+      }
   } else {
     const int nb_selected_stats = 3;
     int selected_stats[nb_selected_stats] = { 
@@ -127,6 +214,14 @@ void stats_t::print(FILE* f) {
               name_of_type((stat_type_t) i).c_str(),
               (long)total_data.counters[i]);
     }
+    if (sched::arena::get_nb() > 1)
+      for (int a = 0; a < sched::arena::get_nb(); a++)
+        for (int k = 0; k < nb_selected_stats; k++) {
+          int i = selected_stats[k];
+          fprintf(f, "arena%d_%s\t%ld\n", a,
+                  name_of_type((stat_type_t) i).c_str(),
+                  (long)arena_data[a].counters[i]);
+        }
   }
 }
 
@@ -135,6 +230,14 @@ void stats_t::dump(FILE* f) {
   print(f);
 }
 
+void stats_t::note_exec() {
+  get_my_stats().note_exec();
+}
+
+void stats_t::add_to_queueing_time(sched::priority_t priority, double elapsed) {
+  get_my_stats().add_to_queueing_time(priority, elapsed);
+}
+
 stats_private_t& stats_t::get_my_stats() {
   return stats[worker::the_group.get_my_id_or_undef ()];
 }
@@ -155,6 +258,17 @@ void stats_t::exit_launch() {
   assert (launch_enter_time != never);
   launch_exit_time = microtime::now();
   launch_duration = microtime::seconds(microtime::diff(launch_enter_time, launch_exit_time));
+  ramp_up_time = 0.0;
+  for (int64_t id = 0; id < worker::get_nb(); id++) {
+    microtime_t first = stats[id].data.first_exec_time;
+    if (first == never) {
+      ramp_up_time = -1.0;
+      break;
+    }
+    double delay = (first > launch_enter_time)
+      ? microtime::seconds(microtime::diff(launch_enter_time, first)) : 0.0;
+    ramp_up_time = std::max(ramp_up_time, delay);
+  }
   launch_enter_time = never;
 }
 
@@ -183,6 +297,21 @@ void stats_t::add_to_spinning_time(double elapsed) {
   get_my_stats().add_to_spinning_time(elapsed);
 }
 
+void stats_t::add_to_sleeping_time(double elapsed) {
+  get_my_stats().add_to_sleeping_time(elapsed);
+}
+
+void stats_t::add_to_steal_batch_histogram(size_t nb_threads) {
+  get_my_stats().add_to_steal_batch_histogram(nb_threads);
+}
+
+void stats_t::add_to_stacks_in_use(int64_t d) {
+  int64_t nb = nb_stacks_in_use.fetch_add(d) + d;
+  int64_t peak = peak_stacks_in_use.load();
+  while (nb > peak && ! peak_stacks_in_use.compare_exchange_weak(peak, nb))
+    ;
+}
+
 /*---------------------------------------------------------------------*/
 
 stats_t the_stats;
@@ -16,9 +16,11 @@
 #include <cstdio>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 
 #include "classes.hpp"
 #include "workerlocal.hpp"
+#include "arena.hpp"
 
 namespace pasl {
 namespace util {
@@ -36,6 +38,11 @@ typedef enum {
   THREAD_REJECT,
   THREAD_RECOVER,
   THREAD_SPLIT,
+  THREAD_STOLEN,
+  STEAL_LOCAL,
+  STEAL_REMOTE,
+  IDLE_PARK,
+  IDLE_WAKE,
   MSG_SEND,
   COMMUNICATE,
   INTERRUPT,
@@ -46,6 +53,10 @@ typedef enum {
   MEASURED_RUN,
   ESTIM_UPDATE,
   ESTIM_REPORT,
+  ESTIM_UNKNOWN,
+  STACK_POOL_HIT,
+  STACK_POOL_MISS,
+  FORK_HELP_FIRST,
   // begin fencefree
   RESOLVE_JOIN,
   TRANSFER_ALL,
@@ -66,6 +77,11 @@ static inline std::string name_of_type(stat_type_t type) {
     case THREAD_REJECT: return std::string("thread_reject");
     case THREAD_RECOVER: return std::string("thread_recover");
     case THREAD_SPLIT: return std::string("thread_split");
+    case THREAD_STOLEN: return std::string("thread_stolen");
+    case STEAL_LOCAL: return std::string("steal_local");
+    case STEAL_REMOTE: return std::string("steal_remote");
+    case IDLE_PARK: return std::string("idle_park");
+    case IDLE_WAKE: return std::string("idle_wake");
     case MSG_SEND: return std::string("msg_send");
     case COMMUNICATE: return std::string("communicate");
     case INTERRUPT: return std::string("interrupt");
@@ -76,12 +92,16 @@ static inline std::string name_of_type(stat_type_t type) {
     case MEASURED_RUN: return std::string("measured_run");
     case ESTIM_UPDATE: return std::string("estim_update");
     case ESTIM_REPORT: return std::string("estim_report");
+    case ESTIM_UNKNOWN: return std::string("estim_unknown");
+    case STACK_POOL_HIT: return std::string("stack_pool_hit");
+    case STACK_POOL_MISS: return std::string("stack_pool_miss");
     case RESOLVE_JOIN: return std::string("resolve_join");
     case TRANSFER_ALL: return std::string("transfer_all");
     case ADD_WATCHLIST: return std::string("add_watchlist");
     case REMOVE_WATCHLIST: return std::string("remove_watchlist");
     case RACE_RESOLUTION: return std::string("race_resolution");
     case WATCH: return std::string("watch");
+    case FORK_HELP_FIRST: return std::string("fork_help_first");
     case WAITED_TO_COMPLETE_OFFER: return std::string("waited_to_complete_offer");
     default: return std::string("unknown");
   }
@@ -89,16 +109,33 @@ static inline std::string name_of_type(stat_type_t type) {
 
 /*---------------------------------------------------------------------*/
 
+/*! \brief Number of buckets in the histogram of steal-batch sizes;
+ * bucket `k` counts the batches of size in `[2^k, 2^(k+1))`, and the
+ * last bucket also counts all larger batches.
+ */
+const int nb_steal_batch_buckets = 8;
+
 class stats_data_t {
 public:
   uint64_t counters[NB_STATS];
+  uint64_t steal_batch_histogram[nb_steal_batch_buckets];
   double waiting_time;
   double sequential_time;
   double spinning_time;
+  double sleeping_time;
+  //! Time of the first thread executed by the worker since the launch
+  microtime_t first_exec_time;
+  /* delay from the addition of a thread to its execution, per priority
+   * lane: number of threads, sum and maximum of the delays */
+  uint64_t nb_queued[sched::nb_priorities];
+  double queueing_time[sched::nb_priorities];
+  double max_queueing_time[sched::nb_priorities];
 
 public:
   stats_data_t();
   void reset();
+  //! Adds the measures of `other` to these
+  void add(const stats_data_t& other);
 };
 
 /*---------------------------------------------------------------------*/
@@ -117,6 +154,10 @@ public:
   void add_to_sequential_time(double elapsed);
   void add_to_idle_time(double elapsed);
   void add_to_spinning_time(double elapsed);
+  void add_to_sleeping_time(double elapsed);
+  void add_to_steal_batch_histogram(size_t nb_threads);
+  void note_exec();
+  void add_to_queueing_time(sched::priority_t priority, double elapsed);
 };
 
 /*---------------------------------------------------------------------*/
@@ -127,18 +168,29 @@ private:
   typedef pasl::data::perworker::extra<stats_private_t> wi_stats_t;
   wi_stats_t stats;
   stats_data_t total_data;
+  //! sums of the measures of the workers of each arena
+  stats_data_t arena_data[sched::arena::max_nb];
 
   microtime_t launch_enter_time;
   microtime_t launch_exit_time;
   double launch_duration;
+  /* time from the launch until every worker has executed a thread, or
+   * -1 if some worker executed none */
+  double ramp_up_time;
 
   // computed
   double total_idle_time;
   double relative_idle;
   double utilization;
+  double arena_utilization[sched::arena::max_nb];
   double relative_non_seq;
   double average_sequentialized;
   double total_spinning_time;
+  double total_sleeping_time;
+
+  // call stacks of multi-shot threads; updated on steals only
+  std::atomic<int64_t> nb_stacks_in_use;
+  std::atomic<int64_t> peak_stacks_in_use;
 
 public:
   stats_t();
@@ -157,6 +209,11 @@ public:
 
   void add_to_idle_time(double elapsed);
   void add_to_spinning_time(double elapsed);
+  void add_to_sleeping_time(double elapsed);
+  void add_to_stacks_in_use(int64_t d);
+  void add_to_steal_batch_histogram(size_t nb_threads);
+  void note_exec();
+  void add_to_queueing_time(sched::priority_t priority, double elapsed);
 
   // TODO: get rid of these functions by having the STAT macros to call get_my_stat
   void count(stat_type_t type);
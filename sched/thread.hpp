@@ -11,6 +11,8 @@
 #include "localityrange.hpp"
 #include "stats.hpp"
 #include "atomic.hpp"
+#include "slab.hpp"
+#include "ticks.hpp"
 
 #ifndef _PASL_SCHED_THREAD_H_
 #define _PASL_SCHED_THREAD_H_
@@ -24,7 +26,7 @@ namespace sched {
  *  \brief The basic interface of a thread.
  *  \ingroup thread
  */
-class thread {
+class thread : public util::slab::allocated {
 public: //! \todo ideally, would be protected
   
   //! instrategy for detecting readiness of the thread
@@ -35,6 +37,14 @@ public: //! \todo ideally, would be protected
   
   //! true, if this thread should not be deallocated
   bool should_not_deallocate;
+
+  //! lane of the deque that holds the thread once it is ready
+  priority_t priority;
+
+#if defined(STATS) || defined(STATS_IDLE)
+  //! date at which the thread last became ready to run
+  ticks_t date_added;
+#endif
   
 #ifdef TRACK_LOCALITY
   //! index representing the locality of the thread in the DAG
@@ -49,7 +59,8 @@ public:
   
   thread(bool should_not_deallocate = false)
   : in(NULL), out(NULL),
-  should_not_deallocate(should_not_deallocate) { }
+  should_not_deallocate(should_not_deallocate),
+  priority(PRIORITY_NORMAL) { }
   
   virtual ~thread() { }
   
@@ -119,12 +130,17 @@ public:
   //! Replaces the default "new" operator with ours
   void* operator new (size_t size) {
     STAT_COUNT(THREAD_ALLOC);
-    return ::operator new(size);
+    return util::slab::allocated::operator new(size);
   }
   
   virtual void set_should_not_deallocate(bool should_not_deallocate) {
     this->should_not_deallocate = should_not_deallocate;
   }
+
+  //! Assigns the thread to the lane of priority `p`; to be called before the thread is added
+  void set_priority(priority_t p) {
+    priority = p;
+  }
   ///@}
 };
   
@@ -12,11 +12,16 @@
 #include "callback.hpp"
 #include "threaddag.hpp"
 #include "machine.hpp"
+#include "stackpool.hpp"
 #include "scheduler.hpp"
 #include "workstealing.hpp"
+#include "victims.hpp"
+#include "idle.hpp"
 #include "native.hpp"
 #include "instrategy.hpp"
 #include "outstrategy.hpp"
+#include "snzi.hpp"
+#include "arena.hpp"
 
 
 /***********************************************************************/
@@ -39,12 +44,83 @@ util::control::context::context_pointer my_cxt() {
   return context::addr(cxts.mine().cxt);
 }
 
+/* Call stacks of multi-shot threads are taken from, and returned to,
+ * the pool of the calling worker.
+ */
+data::perworker::extra<stackpool::pool> stackpools;
+static size_t the_stack_szb = thread_stack_szb;
+
+size_t stack_szb() {
+  return the_stack_szb;
+}
+
+char* stack_alloc() {
+  bool hit;
+  char* stack = stackpools.mine().alloc(hit);
+  if (hit)
+    STAT_COUNT(STACK_POOL_HIT);
+  else
+    STAT_COUNT(STACK_POOL_MISS);
+  STAT(add_to_stacks_in_use(+1));
+  return stack;
+}
+
+void stack_free(char* stack) {
+  stackpools.mine().free(stack);
+  STAT(add_to_stacks_in_use(-1));
+}
+
+static void init_stackpools() {
+  long szb = util::cmdline::parse_or_default_long("stack_szb", thread_stack_szb, false);
+  int max_nb_cached = util::cmdline::parse_or_default_int("stack_pool_max", 64, false);
+  stackpools.for_each([&] (worker_id_t, stackpool::pool& p) {
+    p.init((size_t)szb, max_nb_cached);
+  });
+  the_stack_szb = stackpools.mine().get_stack_szb();
+}
+
+static void destroy_stackpools() {
+  stackpools.for_each([&] (worker_id_t, stackpool::pool& p) {
+    p.destroy();
+  });
+}
+
 } // end namespace
 } // end namespace
 
 namespace sched {
 namespace native {
   int loop_cutoff;
+  loop_mode_t loop_mode = LOOP_EAGER;
+  int loop_lazy_chunk;
+  spawn_policy_t spawn_policy = SPAWN_WORK_FIRST;
+  int spawn_adaptive_window;
+  double spawn_adaptive_threshold;
+
+// zero initialized, that is, every worker starts with help first
+class adaptive_spawn_t {
+public:
+  int nb_forks;
+  uint64_t nb_stolen;
+  bool work_first;
+};
+
+static data::perworker::array<adaptive_spawn_t> adaptive_spawns;
+
+bool should_help_first_adaptive() {
+  worker_id_t my_id = util::worker::get_my_id();
+  adaptive_spawn_t& s = adaptive_spawns[my_id];
+  s.nb_forks++;
+  if (s.nb_forks >= spawn_adaptive_window) {
+    uint64_t nb_stolen = scheduler::nb_stolen_from[my_id].load(std::memory_order_relaxed);
+    double rate = (double)(nb_stolen - s.nb_stolen) / (double)s.nb_forks;
+    s.work_first = (rate < spawn_adaptive_threshold);
+    s.nb_forks = 0;
+    s.nb_stolen = nb_stolen;
+  }
+  return ! s.work_first;
+}
+
 
 char multishot::dummy1;
 char multishot::dummy2;
@@ -78,6 +154,31 @@ instrategy_p new_forkjoin_instrategy() {
   return in;
 }
 
+typedef enum { FINISH_DISTRIBUTED, FINISH_SNZI, FINISH_FETCH_ADD } finish_instrategy_class_t;
+static finish_instrategy_class_t instrategy_class_finish;
+
+static finish_instrategy_class_t finish_instrategy_of_string(std::string s) {
+  if (s.compare("distributed") == 0)
+    return FINISH_DISTRIBUTED;
+  else if (s.compare("snzi") == 0)
+    return FINISH_SNZI;
+  else if (s.compare("fetch_add") == 0)
+    return FINISH_FETCH_ADD;
+  util::atomic::die("bogus finish instrategy %s\n", s.c_str());
+  return FINISH_DISTRIBUTED;
+}
+
+instrategy_p new_finish_instrategy(thread_p cont) {
+  instrategy_p in = NULL;
+  switch (instrategy_class_finish) {
+    case FINISH_DISTRIBUTED: in = new instrategy::distributed(cont); break;
+    case FINISH_SNZI: in = new instrategy::snzi(cont); break;
+    case FINISH_FETCH_ADD: in = instrategy::fetch_add_new(); break;
+    default: util::atomic::die("bogus finish instrategy");
+  }
+  return in;
+}
+
 typedef enum { UNARY, FENCEFREE_OUTSTRATEGY } outstrategy_class_t;
 static outstrategy_class_t outstrategy_class_forkjoin;
 
@@ -106,11 +207,34 @@ static int init_general_purpose() {
   int nb_workers = util::cmdline::parse_or_default_int("proc", 1, true);
 #endif
   native::loop_cutoff = util::cmdline::parse_or_default_int("loop_cutoff", 10000);
+  std::string loop_mode_str =
+    util::cmdline::parse_or_default_string("loop_mode", "eager", false);
+  if (loop_mode_str == "eager")
+    native::loop_mode = native::LOOP_EAGER;
+  else if (loop_mode_str == "lazy")
+    native::loop_mode = native::LOOP_LAZY;
+  else
+    util::atomic::die("bogus loop_mode %s\n", loop_mode_str.c_str());
+  native::loop_lazy_chunk = util::cmdline::parse_or_default_int("loop_lazy_chunk", 64, false);
+  std::string spawn_policy_str =
+    util::cmdline::parse_or_default_string("spawn_policy", "work_first", false);
+  if (spawn_policy_str == "work_first")
+    native::spawn_policy = native::SPAWN_WORK_FIRST;
+  else if (spawn_policy_str == "help_first")
+    native::spawn_policy = native::SPAWN_HELP_FIRST;
+  else if (spawn_policy_str == "adaptive")
+    native::spawn_policy = native::SPAWN_ADAPTIVE;
+  else
+    util::atomic::die("bogus spawn_policy %s\n", spawn_policy_str.c_str());
+  native::spawn_adaptive_window =
+    std::max(1, util::cmdline::parse_or_default_int("spawn_adaptive_window", 64, false));
+  native::spawn_adaptive_threshold =
+    util::cmdline::parse_or_default_double("spawn_adaptive_threshold", 1.0 / 64.0, false);
   std::string htmodestr =
     util::cmdline::parse_or_default_string("hyperthreading", "useall", false);
   util::machine::hyperthreading_mode_t htmode = util::machine::htmode_of_string(htmodestr);
   util::machine::init(htmode);
-  data::estimator::init();
+  data::estimator::init(nb_workers);
   return nb_workers;
 }
 
@@ -133,7 +257,22 @@ static void init_basic(int nb_workers) {
   util::machine::the_bindpolicy.init(nbpe, no0, nb_workers);
   util::machine::the_numa.init(nb_workers);
   util::worker::the_group.init(nb_workers, &util::machine::the_bindpolicy);
+  sched::arena::init(nb_workers);
+  std::string victimstr =
+    util::cmdline::parse_or_default_string("victim_policy", "uniform", false);
+  int victim_budgets[sched::victims::NB_LEVELS];
+  victim_budgets[sched::victims::LEVEL_CORE] =
+    util::cmdline::parse_or_default_int("victim_tries_core", 1, false);
+  victim_budgets[sched::victims::LEVEL_NODE] =
+    util::cmdline::parse_or_default_int("victim_tries_node", 4, false);
+  victim_budgets[sched::victims::LEVEL_REMOTE] =
+    util::cmdline::parse_or_default_int("victim_tries_remote", 2, false);
+  sched::victims::the_selector.init(sched::victims::policy_of_string(victimstr),
+                                    victim_budgets, util::machine::the_numa, nb_workers);
+  sched::idle::init();
+  util::control::init_stackpools();
   LOG_ONLY(util::logging::the_recorder.init());
+  HWCOUNTERS(init());
   STAT_IDLE_ONLY(util::stats::the_stats.init());
 }
 
@@ -141,6 +280,7 @@ static void destroy_basic() {
   LOG_ONLY(util::logging::output());
   LOG_ONLY(util::logging::the_recorder.destroy());
   data::estimator::destroy();
+  util::control::destroy_stackpools();
   util::machine::the_bindpolicy.destroy();
   util::machine::destroy();
 }
@@ -150,6 +290,8 @@ static void init_scheduler() {
   util::cmdline::parse_or_default_string("scheduler", "workstealing", false);
   instrategy_class_forkjoin = FETCH_ADD;
   outstrategy_class_forkjoin = UNARY;
+  instrategy_class_finish = finish_instrategy_of_string(
+    util::cmdline::parse_or_default_string("finish_instrategy", "distributed", false));
   if (schedulerstr.compare("workstealing") == 0) {
     std::string tsetstr = util::cmdline::parse_or_default_string("threadset", "cas_ri", false);
     if (tsetstr.compare("cas_si") == 0) {
@@ -375,8 +517,7 @@ void finish(thread_p thread, thread_p cont, instrategy_p in) {
 }
 
 void finish(thread_p thread, thread_p cont) {
-  instrategy_p in = new instrategy::distributed(cont);
-  finish(thread, cont, in);
+  finish(thread, cont, new_finish_instrategy(cont));
 }
 
 /*---------------------------------------------------------------------*/
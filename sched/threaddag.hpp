@@ -228,6 +228,8 @@ void finish(thread_p thread, thread_p cont);
 /*---------------------------------------------------------------------*/
   
 instrategy_p new_forkjoin_instrategy();
+//! Returns the instrategy selected by `-finish_instrategy` for the continuation `cont` of a finish block
+instrategy_p new_finish_instrategy(thread_p cont);
 outstrategy_p new_forkjoin_outstrategy(branch_t branch);
   
 void change_factory(util::worker::controller_factory_t* factory);
@@ -0,0 +1,91 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file victims.cpp
+ *
+ */
+
+#include "victims.hpp"
+#include "arena.hpp"
+#include "atomic.hpp"
+
+namespace pasl {
+namespace sched {
+namespace victims {
+
+/***********************************************************************/
+
+policy_t policy_of_string(std::string s) {
+  if (s.compare("uniform") == 0)
+    return UNIFORM;
+  else if (s.compare("hierarchical") == 0)
+    return HIERARCHICAL;
+  util::atomic::die("bogus victim-selection policy %s\n", s.c_str());
+  return UNIFORM;
+}
+
+/*---------------------------------------------------------------------*/
+
+void selector::init(policy_t policy, const int budgets[NB_LEVELS],
+                    util::machine::numa& numa, int nb_workers) {
+  this->policy = policy;
+  for (int l = 0; l < NB_LEVELS; l++)
+    this->budgets[l] = budgets[l];
+  cores.resize(nb_workers);
+  nodes.resize(nb_workers);
+  for (worker_id_t id = 0; id < nb_workers; id++) {
+    cores[id] = numa.core_of_worker(id);
+    nodes[id] = numa.node_of_worker(id);
+  }
+  candidates.assign(nb_workers, std::vector<std::vector<worker_id_t>>(NB_LEVELS));
+  peers.assign(nb_workers, std::vector<worker_id_t>());
+  bool isolated = arena::is_isolated();
+  for (worker_id_t id = 0; id < nb_workers; id++) {
+    for (worker_id_t other = 0; other < nb_workers; other++) {
+      if (other == id)
+        continue;
+      if (isolated && arena::of_worker(other) != arena::of_worker(id))
+        continue;
+      candidates[id][level_of(id, other)].push_back(other);
+      peers[id].push_back(other);
+    }
+    bool can_steal = false;
+    for (int l = 0; l < NB_LEVELS; l++)
+      can_steal = can_steal || (budgets[l] > 0 && ! candidates[id][l].empty());
+    if (policy == HIERARCHICAL && ! peers[id].empty() && ! can_steal)
+      util::atomic::die("victim budgets leave worker %d without victims\n", (int)id);
+    restart(id);
+  }
+}
+
+void selector::restart(worker_id_t my_id) {
+  cursor_t& c = cursors[my_id];
+  c.level = NB_LEVELS - 1;
+  c.nb_tries_left = 0;
+}
+
+void selector::next_level(worker_id_t my_id) {
+  cursor_t& c = cursors[my_id];
+  do {
+    c.level = (c.level + 1) % NB_LEVELS;
+  } while (budgets[c.level] == 0 || candidates[my_id][c.level].empty());
+  c.nb_tries_left = budgets[c.level];
+}
+
+level_t selector::level_of(worker_id_t my_id, worker_id_t other) {
+  if (cores[my_id] != util::machine::core_undef && cores[my_id] == cores[other])
+    return LEVEL_CORE;
+  else if (nodes[my_id] == nodes[other])
+    return LEVEL_NODE;
+  else
+    return LEVEL_REMOTE;
+}
+
+selector the_selector;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
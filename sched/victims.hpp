@@ -0,0 +1,133 @@
+/* COPYRIGHT (c) 2014 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file victims.hpp
+ * \brief Policies for choosing the target of a steal attempt
+ *
+ */
+
+#ifndef _PASL_SCHED_VICTIMS_H_
+#define _PASL_SCHED_VICTIMS_H_
+
+#include <string>
+#include <vector>
+
+#include "machine.hpp"
+#include "workerlocal.hpp"
+
+namespace pasl {
+namespace sched {
+namespace victims {
+
+/***********************************************************************/
+
+typedef enum {
+  UNIFORM,          // any other worker, uniformly at random
+  HIERARCHICAL      // closest workers first, as given by the topology
+} policy_t;
+
+policy_t policy_of_string(std::string s);
+
+/*! \brief Distance between a thief and its victim, from closest to
+ *  farthest.
+ */
+typedef enum {
+  LEVEL_CORE,       // hyperthread sibling, on the same core
+  LEVEL_NODE,       // another core of the same NUMA node
+  LEVEL_REMOTE,     // another NUMA node
+  NB_LEVELS
+} level_t;
+
+/*---------------------------------------------------------------------*/
+/*! \class selector
+ *  \brief Chooses the victims of the steal attempts of each worker.
+ *
+ * With the hierarchical policy, the workers that are not the caller
+ * are partitioned in three levels. A worker makes up to `budgets[l]`
+ * consecutive attempts at level `l`, each on a worker of the level
+ * chosen at random, before moving on to level `l+1`; after the last
+ * level, it starts over at the first one. Levels that contain no
+ * worker are skipped. A successful steal, reported by `found`, brings
+ * the worker back to the first level.
+ *
+ * With the uniform policy, the selector behaves like
+ * `controller_t::random_other`.
+ *
+ * If the arenas are isolated, the possible victims of a worker are
+ * the other workers of its arena only.
+ */
+class selector {
+private:
+
+  struct cursor_t {
+    int level;
+    int nb_tries_left;
+  };
+
+  policy_t policy;
+  int budgets[NB_LEVELS];
+  /* `candidates[id][l]` is the set of workers that are at level `l`
+   * from worker `id` */
+  std::vector<std::vector<std::vector<worker_id_t>>> candidates;
+  //! `peers[id]` is the set of all the possible victims of worker `id`
+  std::vector<std::vector<worker_id_t>> peers;
+  std::vector<util::machine::core_id_t> cores;
+  std::vector<util::machine::node_id_t> nodes;
+  data::perworker::array<cursor_t> cursors;
+
+  void restart(worker_id_t my_id);
+  void next_level(worker_id_t my_id);
+
+public:
+
+  selector() : policy(UNIFORM) { }
+
+  /*! \brief Initializes the selector
+   *  \param policy the selection policy
+   *  \param budgets number of consecutive attempts at each level
+   *  \param numa the mapping from workers to cores and nodes
+   *  \param nb_workers the number of workers
+   */
+  void init(policy_t policy, const int budgets[NB_LEVELS],
+            util::machine::numa& numa, int nb_workers);
+
+  /*! \brief Returns the next victim of the calling worker; `myrand`
+   *  is the random-number generator of that worker. Returns
+   *  `util::worker::undef` if the worker has no possible victim.
+   */
+  template <class Rand>
+  worker_id_t select(worker_id_t my_id, const Rand& myrand) {
+    std::vector<worker_id_t>& all = peers[my_id];
+    if (all.empty())
+      return util::worker::undef;
+    if (policy == UNIFORM)
+      return all[myrand() % all.size()];
+    cursor_t& c = cursors[my_id];
+    if (c.nb_tries_left == 0)
+      next_level(my_id);
+    c.nb_tries_left--;
+    std::vector<worker_id_t>& set = candidates[my_id][c.level];
+    return set[myrand() % set.size()];
+  }
+
+  //! To be called by a worker after a successful steal
+  void found(worker_id_t my_id) {
+    if (policy == HIERARCHICAL)
+      restart(my_id);
+  }
+
+  //! Returns the distance between two distinct workers
+  level_t level_of(worker_id_t my_id, worker_id_t other);
+
+};
+
+extern selector the_selector;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_VICTIMS_H_ */
@@ -9,6 +9,7 @@
 #include <math.h>
 
 #include <iostream>
+#include <algorithm>
 //#include <chrono>
 //#include <thread>
 
@@ -139,6 +140,7 @@ void cas_si_private::acquire() {
   shared->states[my_id].store(WAITING);
   while (true) {
     if (shared->states[my_id].load() == WAITING || shared->states[my_id].load() == INCOMING) {
+      start_next_job();
       if (! stay_in_acquire()) {
         cancel_acquire();
         return;
@@ -179,7 +181,8 @@ void cas_si_private::communicate() {
   _alarm->reset();
   should_communicate = false;
   for (int nb_tries = 0; nb_tries < shared->nb_tries_per_communicate; nb_tries++) {
-    worker_id_t id = random_other();
+    worker_id_t id = random_peer();
+    if (id == util::worker::undef) return;
     if (shared->states[id].load() != WAITING) continue;
     thread_p orig = WAITING;
     bool s = shared->states[id].compare_exchange_strong(orig, INCOMING);
@@ -219,7 +222,9 @@ void cas_si_private::check() {
   
 bool cas_si_private::should_call_communicate() {
   for (int nb_tries = 0; nb_tries < shared->nb_tries_per_communicate; nb_tries++) {
-    worker_id_t id = random_other();
+    worker_id_t id = random_peer();
+    if (id == util::worker::undef)
+      return false;
     if (shared->states[id].load() == WAITING)
       return true;
   }
@@ -246,9 +251,11 @@ void cas_si_private::check_on_interrupt() {
 //! \todo: factorize code!
 
 cas_ri_shared::cas_ri_shared() : threadset_shared::threadset_shared() {
-  for (worker_id_t id = 0; id < util::worker::get_nb(); id++)
+  for (worker_id_t id = 0; id < util::worker::get_nb(); id++) {
     requests[id].store(REQUEST_WAITING);
-  answers.init(ANSWER_REJECT);
+    answers[id].store(ANSWER_REJECT);
+  }
+  steal_half = util::cmdline::parse_or_default_bool("steal_half", false, false);
 }
 
 cas_ri_shared::~cas_ri_shared() {
@@ -278,18 +285,24 @@ void cas_ri_private::reject() { // TODO: rename this to reject_and_block
     if (! s)
       reject();
   } else {
-    // i is the id of another thread
-    shared->answers[i] = ANSWER_REJECT;
-    bool s = my_request_ptr->compare_exchange_strong(i, REQUEST_BLOCKED);
-    if (! s)
-      util::atomic::die("cas_ri invariant broken: my_request_ptr was changed while holding an id.");
+    // i is the id of another thread, which may withdraw its request meanwhile
+    if (my_request_ptr->compare_exchange_strong(i, REQUEST_BLOCKED))
+      shared->answers[i].store(ANSWER_REJECT, std::memory_order_release);
+    else
+      reject();
   }
 }
 
-void cas_ri_private::sleep_in_acquire(double nb_microseconds) {
-  // std::chrono::milliseconds dura( 1 );
-  // std::this_thread::sleep_for( dura );
-  pasl::util::ticks::microseconds_sleep(nb_microseconds);
+/* Returns false if the victim has already taken the request, in which
+ * case the caller must wait for the answer, as it may carry threads.
+ */
+bool cas_ri_private::withdraw_request(worker_id_t victim) {
+  request_t orig = my_id;
+  return shared->requests[victim].compare_exchange_strong(orig, REQUEST_WAITING);
+}
+
+void cas_ri_private::idle_in_acquire(bool may_park) {
+  my_waiter.pause(may_park);
 }
 
 void cas_ri_private::unblock() {
@@ -300,23 +313,29 @@ void cas_ri_private::unblock() {
 void cas_ri_private::acquire() {
   if (nb_workers < 2) {
     scheduler::_private::check_periodic();
+    start_next_job();
     return;
   }
   reject();
   // TODO: writes in answer_ptr should be "store" function calls
 
   thread_p thread = NULL;
-  answer_t* answer_ptr = & (shared->answers[my_id]);
+  worker_id_t id;
+  std::atomic<answer_t>* answer_ptr = & (shared->answers[my_id]);
+  my_waiter.reset();
   while (true) {
     scheduler::_private::check_periodic();
-    if (! stay_in_acquire())
+    // jobs are started only while no request is pending
+    if (start_next_job() || ! stay_in_acquire())
       goto cleanup;
 
     // may yield here
-    sleep_in_acquire(1);
+    idle_in_acquire(true);
 
-    *answer_ptr = ANSWER_WAITING;
-    worker_id_t id = random_other();
+    answer_ptr->store(ANSWER_WAITING);
+    id = select_victim();
+    if (id == util::worker::undef)
+      continue;
     if (shared->requests[id].load() != REQUEST_WAITING){
       continue;
     }
@@ -325,29 +344,66 @@ void cas_ri_private::acquire() {
     if (! s)
       continue;
 
-    while (*answer_ptr == ANSWER_WAITING) {
-      sleep_in_acquire(1); // may yield here as well
+    while (answer_ptr->load(std::memory_order_acquire) == ANSWER_WAITING) {
+      // the victim answers without notifying, so we must not park here
+      idle_in_acquire(false);
       //util::atomic::print([&] { std::cout << "***waiting answer " << my_id << std::endl; });
-      if (! stay_in_acquire()) {
-        shared->requests[id].store(REQUEST_WAITING);
+      if (! stay_in_acquire() && withdraw_request(id))
         goto cleanup;
-      }
     }
     //util::atomic::aprintf("reception from %d to %d\n", my_id, id);
 
-    if (*answer_ptr == ANSWER_REJECT){
+    answer_t answer = answer_ptr->load(std::memory_order_acquire);
+    if (answer == ANSWER_REJECT){
       continue;
     }
-    thread = (thread_p) *answer_ptr;
+    thread = (thread_p) answer;
     break;
   }
+  receive(thread, id);
+
+  cleanup:
+  unblock();
+}
+
+/* Threads are taken from the front of the highest nonempty lane,
+ * oldest first; the oldest one is returned to be stored in the answer,
+ * and the others go to the batch of the requester, which the release
+ * store of the answer publishes.
+ */
+answer_t cas_ri_private::answer_request(request_t j) {
+  if (! remote_has())
+    return ANSWER_REJECT;
+  if (! shared->steal_half || remote_can_split())
+    return remote_pop();
+  data::stl::deque_seq<thread_p>& lane = my_ready_threads[top_lane()];
+  size_t nb = std::max((size_t)1, std::min(lane.size(), nb_threads() / 2));
+  thread_p first = lane.pop_front();
+  std::vector<thread_p>& batch = shared->batches[j];
+  assert(batch.empty());
+  for (size_t k = 1; k < nb; k++)
+    batch.push_back(lane.pop_front());
+  return first;
+}
+
+/* Pushes the threads in the same order as they were in the deque of
+ * the sender, so that the oldest thread is the next one to be stolen.
+ */
+void cas_ri_private::receive(thread_p thread, worker_id_t victim) {
+  std::vector<thread_p>& batch = shared->batches[my_id];
+  STAT_ONLY(size_t nb = 1 + batch.size());
+  while (! batch.empty()) {
+    remote_push(batch.back());
+    batch.pop_back();
+  }
   remote_push(thread);
+  if (nb_threads() > 1)
+    idle::notify_new_work();
   //! \todo: thread_receive event?
   LOG_THREAD(THREAD_SEND, thread);
   STAT_COUNT(THREAD_SEND);
-
-  cleanup:
-  unblock();
+  STAT(add_to_steal_batch_histogram(nb));
+  found_victim(victim);
 }
 
 bool cas_ri_private::time_to_communicate() {
@@ -366,12 +422,10 @@ void cas_ri_private::communicate() {
   request_t j = my_request_ptr->load();
   if (j == REQUEST_WAITING)
     return;
-  if (remote_has()) {
-    shared->answers[j] = remote_pop();
-  } else {
-    shared->answers[j] = ANSWER_REJECT;
-  }
-  my_request_ptr->store(REQUEST_WAITING);
+  // takes the request, unless its sender withdrew it meanwhile
+  if (! my_request_ptr->compare_exchange_strong(j, REQUEST_WAITING))
+    return;
+  shared->answers[j].store(answer_request(j), std::memory_order_release);
 }
 
 /* deprecated, but keep around for now
@@ -434,14 +488,17 @@ void cas_ri_private::check_on_interrupt() {
 
 void cas_ri_interrupt_private::acquire() {
   thread_p thread = NULL;
-  answer_t* answer_ptr = & (shared->answers[my_id]);
+  worker_id_t id;
+  std::atomic<answer_t>* answer_ptr = & (shared->answers[my_id]);
   while (true) {
-    if (! stay_in_acquire())
+    if (start_next_job() || ! stay_in_acquire())
       goto cleanup;
 
     // may yield here
-    *answer_ptr = ANSWER_WAITING;
-    worker_id_t id = random_other();
+    answer_ptr->store(ANSWER_WAITING);
+    id = select_victim();
+    if (id == util::worker::undef)
+      continue;
     if (shared->requests[id].load() != REQUEST_WAITING)
       continue;
     worker_id_t orig = REQUEST_WAITING;
@@ -449,23 +506,19 @@ void cas_ri_interrupt_private::acquire() {
     if (! s)
       continue;
 
-    while (*answer_ptr == ANSWER_WAITING) {
+    while (answer_ptr->load(std::memory_order_acquire) == ANSWER_WAITING) {
       communicate();
-      if (! stay_in_acquire()) {
-        shared->requests[id].store(REQUEST_WAITING);
+      if (! stay_in_acquire() && withdraw_request(id))
         goto cleanup;
-      }
     }
-    if (*answer_ptr == ANSWER_REJECT)
+    answer_t answer = answer_ptr->load(std::memory_order_acquire);
+    if (answer == ANSWER_REJECT)
       continue;
-    thread = (thread_p) *answer_ptr;
+    thread = (thread_p) answer;
     break;
     communicate();
   }
-  remote_push(thread);
-  //! \todo: thread_receive event?
-  LOG_THREAD(THREAD_SEND, thread);
-  STAT_COUNT(THREAD_SEND);
+  receive(thread, id);
 
   cleanup:
   my_request_ptr->store(REQUEST_WAITING);
@@ -544,106 +597,130 @@ void cas_ri_interrupt_private::acquire() {
 static thread_p const STEAL_RES_EMPTY = (thread_p) 0;
 static thread_p const STEAL_RES_ABORT = (thread_p) 1;
 
-thread_p chase_lev_deque::cb_get (
-     chase_lev_deque::buffer_t buf, int64_t capacity, int64_t i) {
-  return buf[i % capacity].load();
+chase_lev_deque::buffer_p chase_lev_deque::new_buffer(int64_t capacity) {
+  assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  buffer_p buf = new buffer_t;
+  buf->capacity = capacity;
+  buf->mask = capacity - 1;
+  buf->items = new std::atomic<thread_p>[capacity];
+  return buf;
 }
 
-void chase_lev_deque::cb_put (
-    chase_lev_deque::buffer_t buf, int64_t capacity, int64_t i, thread_p x) {
-  buf[i % capacity].store(x);
+void chase_lev_deque::delete_buffer(chase_lev_deque::buffer_p buf) {
+  delete [] buf->items;
+  delete buf;
 }
 
-chase_lev_deque::buffer_t chase_lev_deque::new_buffer(size_t capacity) {
-  return new std::atomic<thread_p>[capacity];
-}
-
-void chase_lev_deque::delete_buffer(chase_lev_deque::buffer_t buf) {
-  delete [] buf;
-}
-
-chase_lev_deque::buffer_t chase_lev_deque::grow (
-    chase_lev_deque::buffer_t old_buf,
-    int64_t old_capacity,
-    int64_t new_capacity,
+chase_lev_deque::buffer_p chase_lev_deque::grow (
+    chase_lev_deque::buffer_p old_buf,
     int64_t b,
     int64_t t) {
-  chase_lev_deque::buffer_t new_buf = new_buffer(new_capacity);
+  buffer_p new_buf = new_buffer(2 * old_buf->capacity);
   for (int64_t i = t; i < b; i++)
-    cb_put (new_buf, new_capacity, i, cb_get (old_buf, old_capacity, i));
+    cb_put (new_buf, i, cb_get (old_buf, i));
   return new_buf;
 }
 
-bool chase_lev_deque::cas_top (int64_t old_val, int64_t new_val) {
-  int64_t ov = old_val;
-  return top.compare_exchange_strong(ov, new_val);
+// only the owner retires and reclaims, so no synchronization is needed
+void chase_lev_deque::retire(chase_lev_deque::buffer_p old_buf) {
+  retired_t r;
+  r.buf = old_buf;
+  r.epoch = epochs->advance();
+  retired.push_back(r);
 }
 
-void chase_lev_deque::init(int64_t init_capacity) {
-  capacity.store(init_capacity);
-  buf = new_buffer(capacity.load());
+void chase_lev_deque::reclaim() {
+  size_t j = 0;
+  for (size_t i = 0; i < retired.size(); i++) {
+    if (epochs->safe(retired[i].epoch))
+      delete_buffer(retired[i].buf);
+    else
+      retired[j++] = retired[i];
+  }
+  retired.resize(j);
+}
+
+void chase_lev_deque::init(int64_t init_capacity, util::epoch::manager* epochs) {
+  int64_t capacity = 1;
+  while (capacity < init_capacity)
+    capacity *= 2;
+  this->epochs = epochs;
+  buffer_p b = new_buffer(capacity);
+  for (int64_t i = 0; i < capacity; i++)
+    b->items[i].store(NULL); // optional
+  buf.store(b);
   bottom.store(0l);
   top.store(0l);
-  for (int64_t i = 0; i < capacity.load(); i++)
-    buf[i].store(NULL); // optional
 }
 
+// assumes that no thief accesses the deque anymore
 void chase_lev_deque::destroy() {
-  assert (bottom.load() - top.load() == 0); // maybe wrong
-  delete_buffer(buf);
+  for (size_t i = 0; i < retired.size(); i++)
+    delete_buffer(retired[i].buf);
+  retired.clear();
+  buffer_p b = buf.load();
+  if (b != nullptr)
+    delete_buffer(b);
+  buf.store(nullptr);
 }
 
 void chase_lev_deque::push_back(thread_p item) {
-  int64_t b = bottom.load();
-  int64_t t = top.load();
-  if (b-t >= capacity.load() - 1) {
-    chase_lev_deque::buffer_t old_buf = buf;
-    int64_t old_capacity = capacity.load();
-    int64_t new_capacity = capacity.load() * 2;
-    buf = grow (old_buf, old_capacity, new_capacity, b, t);
-    capacity.store(new_capacity);
-    // UNSAFE! delete old_buf;
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  buffer_p a = buf.load(std::memory_order_relaxed);
+  if (b - t > a->capacity - 1) {
+    buffer_p old_buf = a;
+    a = grow (old_buf, b, t);
+    buf.store(a, std::memory_order_release);
+    retire(old_buf);
+    reclaim();
   }
-  cb_put (buf, capacity.load(), b, item);
-  // requires fence store-store
-  bottom.store(b + 1);
+  cb_put (a, b, item);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
 }
 
-thread_p chase_lev_deque::pop_front() {
-  int64_t t = top.load();
-  // requires fence load-load
-  int64_t b = bottom.load();
-  // would need a fence load-load if were to read the pointer on deque->buf
+thread_p chase_lev_deque::pop_front(int id) {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
   if (t >= b)
     return STEAL_RES_EMPTY;
-  thread_p item = cb_get (buf, capacity.load(), t);
-  // requires fence load-store
-  if (! cas_top (t, t + 1))
+  epochs->enter(id);
+  buffer_p a = buf.load(std::memory_order_acquire);
+  thread_p item = cb_get (a, t);
+  epochs->exit(id);
+  if (! top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed))
     return STEAL_RES_ABORT;
   return item;
 }
 
 thread_p chase_lev_deque::pop_back() {
-  int64_t b = bottom.load() - 1;
-  bottom.store(b);
-  // requires fence store-load
-  int64_t t = top.load();
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  buffer_p a = buf.load(std::memory_order_relaxed);
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
   if (b < t) {
-    bottom.store(t);
+    bottom.store(b + 1, std::memory_order_relaxed);
     return NULL;
   }
-  thread_p item = cb_get (buf, capacity.load(), b);
+  thread_p item = cb_get (a, b);
   if (b > t)
     return item;
-  if (! cas_top (t, t + 1)) {
+  // single item left: race against the thieves
+  if (! top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed))
     item = NULL;
-  }
-  bottom.store(t + 1);
+  bottom.store(b + 1, std::memory_order_relaxed);
   return item;
 }
 
 size_t chase_lev_deque::nb_threads() {
-  return (size_t)bottom.load() - top.load();
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_relaxed);
+  return (b > t) ? (size_t)(b - t) : 0;
 }
 
 bool chase_lev_deque::empty() {
@@ -653,16 +730,23 @@ bool chase_lev_deque::empty() {
 shared_deques_shared::shared_deques_shared() {
   //  scheduler::_shared();
   deques.init(NULL);
+  epochs.init(util::worker::get_nb());
   creation_barrier.init(util::worker::get_nb());
 }
 
 shared_deques_shared::~shared_deques_shared() {
 }
 
+shared_deques_private::~shared_deques_private() {
+  for (int p = 0; p < nb_priorities; p++)
+    my_deques[p].destroy();
+}
+
 void shared_deques_private::init() {
-  my_deque.init(1024l);
+  for (int p = 0; p < nb_priorities; p++)
+    my_deques[p].init(1024l, &_shared->epochs);
   scheduler::_private::init();
-  _shared->deques[util::worker::get_my_id()] = &my_deque;
+  _shared->deques[util::worker::get_my_id()] = my_deques;
 }
 
 void shared_deques_private::destroy() {
@@ -671,9 +755,25 @@ void shared_deques_private::destroy() {
 
 // moves threads from fresh to ready set
 void shared_deques_private::flush() {
+  if (my_fresh.empty())
+    return;
+  bool had_surplus = nb_threads() - my_fresh.size() > 1;
   for (int i = 0; i < my_fresh.size(); i++)
-    my_deque.push_back(my_fresh[i]);
+    my_deques[my_fresh[i]->priority].push_back(my_fresh[i]);
   my_fresh.clear();
+  // the worker pops one thread for itself, the others can be stolen
+  if (! had_surplus && nb_threads() > 1)
+    idle::notify_new_work();
+}
+
+// pops from the highest nonempty lane
+thread_p shared_deques_private::pop_back() {
+  for (int p = nb_priorities - 1; p >= 0; p--) {
+    thread_p t = my_deques[p].pop_back();
+    if (t != NULL)
+      return t;
+  }
+  return NULL;
 }
 
 void shared_deques_private::run() {
@@ -682,7 +782,7 @@ void shared_deques_private::run() {
   initialized = true;
   while (stay()) {
     flush();
-    thread_p t = my_deque.pop_back();
+    thread_p t = pop_back();
     if (t != NULL) {
       exec(t);
       check();
@@ -702,14 +802,23 @@ void shared_deques_private::check() {
 void shared_deques_private::acquire() {
   if (nb_workers < 2) {
     check();
+    start_next_job();
     return;
   }
   int nb_tries = 0;
+  my_waiter.reset();
   while (stay()) {
     check();
-    worker_id_t id_target = random_other();
-    chase_lev_deque* target = _shared->deques[id_target];
-    thread_p thread = target->pop_front();
+    if (start_next_job())
+      return;
+    worker_id_t id_target = select_victim();
+    thread_p thread = STEAL_RES_EMPTY;
+    if (id_target != util::worker::undef) {
+      chase_lev_deque* target = _shared->deques[id_target];
+      // lanes are tried from the highest priority down
+      for (int p = nb_priorities - 1; p >= 0 && thread == STEAL_RES_EMPTY; p--)
+        thread = target[p].pop_front((int)my_id);
+    }
     if (thread == STEAL_RES_EMPTY) {
       LOG_BASIC(STEAL_FAIL);
     } else if (thread == STEAL_RES_ABORT) {
@@ -717,15 +826,14 @@ void shared_deques_private::acquire() {
     } else {
       LOG_BASIC(STEAL_SUCCESS);
       STAT_COUNT(THREAD_SEND);
-      my_deque.push_back(thread);
+      found_victim(id_target);
+      my_deques[thread->priority].push_back(thread);
       return;
     }
     nb_tries++;
     if (nb_tries > util::worker::get_nb()) {
       nb_tries = 0;
-
-      //controller_t::yield();
-      // TODO: microsleep
+      my_waiter.pause(true);
     }
   }
 }
@@ -10,10 +10,13 @@
 #define _WORKSTEALING_H_
 
 #include <math.h>
+#include <vector>
 
 #include "classes.hpp"
 #include "container.hpp"
+#include "epoch.hpp"
 #include "scheduler.hpp"
+#include "idle.hpp"
 
 /*! \defgroup workstealing Work stealing
  *  \ingroup scheduler
@@ -79,9 +82,21 @@ public:
 /*---------------------------------------------------------------------*/
 /* Worker with a private deque */
 
+/* The deque is made of one lane per priority. The worker pops from
+ * the back of its highest nonempty lane, and thieves take from the
+ * front of the highest nonempty lane of their victim.
+ */
 class private_deque : public threadset_private {
 protected:
-  data::stl::deque_seq<thread_p> my_ready_threads;
+  data::stl::deque_seq<thread_p> my_ready_threads[nb_priorities];
+
+  //! Returns the highest nonempty lane, or the lowest lane if all are empty
+  inline int top_lane() {
+    for (int p = nb_priorities - 1; p > 0; p--)
+      if (my_ready_threads[p].size() > 0)
+        return p;
+    return 0;
+  }
 
 /*
   void check_for_duplicates() {
@@ -101,7 +116,10 @@ protected:
 
 public:
   inline size_t nb_threads() {
-    return my_ready_threads.size();
+    size_t nb = 0;
+    for (int p = 0; p < nb_priorities; p++)
+      nb += my_ready_threads[p].size();
+    return nb;
   }
 
   inline bool local_has() {
@@ -109,25 +127,29 @@ public:
   }
 
   inline virtual void local_push(thread_p thread) {
-    my_ready_threads.push_back(thread);
+    my_ready_threads[thread->priority].push_back(thread);
+    // the deque keeps one thread for the worker, the others can be stolen
+    if (nb_threads() == 2)
+      idle::notify_new_work();
   }
 
   inline virtual thread_p local_pop() {
-    thread_p t = my_ready_threads.pop_back();
+    thread_p t = my_ready_threads[top_lane()].pop_back();
     LOG_THREAD(THREAD_POP, t);
     return t;
   }
 
   inline virtual thread_p local_peek() {
-    thread_p t = my_ready_threads.back();
+    thread_p t = my_ready_threads[top_lane()].back();
     return t;
   }
 
   template <class Func>
   void for_each_in_deque(const Func& f) {
-    for (auto it = my_ready_threads.begin(); it != my_ready_threads.end(); it++) {
-      f(*it);
-    }
+    for (int p = 0; p < nb_priorities; p++)
+      for (auto it = my_ready_threads[p].begin(); it != my_ready_threads[p].end(); it++) {
+        f(*it);
+      }
   }
 
 /*
@@ -148,7 +170,7 @@ public:
   inline bool remote_can_split() {
     if (nb_threads() < 1)
       return false;
-    thread_p thread = my_ready_threads.front();
+    thread_p thread = my_ready_threads[top_lane()].front();
     bool b = thread->size() > 1;
     //! \todo this condition is overly conservative because it fails in the case where we're just rescheduling ourselves
     // if (b && is_one_thread_running())
@@ -161,26 +183,26 @@ public:
   }
 
   inline void remote_push(thread_p thread) {
-    my_ready_threads.push_front(thread);
+    my_ready_threads[thread->priority].push_front(thread);
   }
 
   inline thread_p remote_peek() {
     if (remote_can_split())
       assert(false);
     else
-      return my_ready_threads.front();
+      return my_ready_threads[top_lane()].front();
   }
 
   inline thread_p remote_pop() {
     if (remote_can_split()) {
       STAT_COUNT(THREAD_SPLIT);
-      thread_p t = my_ready_threads.front();
+      thread_p t = my_ready_threads[top_lane()].front();
       size_t sz = t->size();
       assert(sz > 1);
       return t->split(sz / 2);
     } else {
       assert(remote_has());
-      return my_ready_threads.pop_front();
+      return my_ready_threads[top_lane()].pop_front();
     }
   }
 
@@ -270,8 +292,18 @@ static const request_t REQUEST_BLOCKED = -2;
 
 class cas_ri_shared : public threadset_shared {
 protected:
-  data::perworker::array<answer_t> answers;
+  data::perworker::array<std::atomic<answer_t>> answers;
   data::perworker::array<std::atomic<request_t>> requests;
+  /*! \brief When set, a worker answers a request with up to half of
+   *  its ready threads instead of a single one.
+   */
+  bool steal_half;
+  /*! \brief `batches[j]` holds the threads that are sent to worker `j`
+   *  in addition to the one stored in `answers[j]`; it is written by
+   *  the worker that answers the request of `j` before the release
+   *  store of `answers[j]`, and read by `j` after the acquire load.
+   */
+  data::perworker::array<std::vector<thread_p>> batches;
 
 public:
   cas_ri_shared();
@@ -286,9 +318,13 @@ protected:
   cas_ri_shared* shared;
   ticks_t last_communicate;
   void check();
-  void sleep_in_acquire(double nb_microseconds);
+  idle::waiter my_waiter;
+  void idle_in_acquire(bool may_park);
   bool time_to_communicate();
   std::atomic<request_t>* my_request_ptr;
+  answer_t answer_request(request_t j);
+  void receive(thread_p thread, worker_id_t victim);
+  bool withdraw_request(worker_id_t victim);
 
 public:
   cas_ri_private(cas_ri_shared* shared) : shared(shared) {}
@@ -340,35 +376,76 @@ public:
 
 class shared_deques_private;
 
+/*! \class chase_lev_deque
+ *  \brief Chase-Lev work-stealing deque, with the memory orderings of
+ *  the C11 formulation by Le et al. (PPoPP'13).
+ *
+ * The owner pushes and pops at the bottom; thieves pop at the top.
+ * The capacity of the circular buffer is a power of two. When the
+ * buffer fills up, the owner copies it into one that is twice as
+ * large, and retires the old one to the epoch manager given to
+ * `init`; the old buffer is freed only once no thief can still be
+ * reading from it.
+ */
 class chase_lev_deque {
 protected:
 
-  typedef std::atomic<thread_p>* buffer_t;
+  static constexpr int padding_szb = data::perworker::default_padding_szb;
 
-  volatile buffer_t  buf;         // deque contents
-  std::atomic<int64_t> capacity;  // maximum number of elements
-  std::atomic<int64_t> bottom;    // index of the first unused cell
+  struct buffer_struct {
+    int64_t capacity;
+    int64_t mask;
+    std::atomic<thread_p>* items;
+  };
+  typedef struct buffer_struct buffer_t;
+  typedef buffer_t* buffer_p;
+
+  struct retired_struct {
+    buffer_p buf;
+    util::epoch::manager::epoch_type epoch;
+  };
+  typedef struct retired_struct retired_t;
+
+  // written by thieves
+  char padding1[padding_szb];
   std::atomic<int64_t> top;       // index of the last used cell
+  char padding2[padding_szb];
+  // written by the owner
+  std::atomic<int64_t> bottom;    // index of the first unused cell
+  std::atomic<buffer_p> buf;      // deque contents
+  char padding3[padding_szb];
 
-  static thread_p cb_get (buffer_t buf, int64_t capacity, int64_t i);
-  static void cb_put (buffer_t buf, int64_t capacity, int64_t i, thread_p x);
-  buffer_t new_buffer(size_t capacity);
-  void delete_buffer(buffer_t buf);
-  buffer_t grow (buffer_t old_buf,
-                 int64_t old_capacity,
-                 int64_t new_capacity,
-                 int64_t b,
-                 int64_t t);
-  bool cas_top (int64_t old_val, int64_t new_val);
+  util::epoch::manager* epochs;
+  std::vector<retired_t> retired;
+
+  static thread_p cb_get (buffer_p buf, int64_t i) {
+    return buf->items[i & buf->mask].load(std::memory_order_relaxed);
+  }
+  static void cb_put (buffer_p buf, int64_t i, thread_p x) {
+    buf->items[i & buf->mask].store(x, std::memory_order_relaxed);
+  }
+  static buffer_p new_buffer(int64_t capacity);
+  static void delete_buffer(buffer_p buf);
+  buffer_p grow (buffer_p old_buf, int64_t b, int64_t t);
+  void retire(buffer_p buf);
+  void reclaim();
 
 public:
-  chase_lev_deque() : buf(NULL), bottom(0l), top(0l) {
-    capacity.store(0l);
+  chase_lev_deque() : epochs(nullptr) {
+    top.store(0l);
+    bottom.store(0l);
+    buf.store(nullptr);
   }
-  void init(int64_t init_capacity);
+  /*! \param init_capacity rounded up to the next power of two
+   *  \param epochs reclamation domain shared with the thieves
+   */
+  void init(int64_t init_capacity, util::epoch::manager* epochs);
   void destroy();
+  //! To be called only by the owner
   void push_back(thread_p item);
-  thread_p pop_front();
+  //! To be called by a thief, identified in the epoch manager by `id`
+  thread_p pop_front(int id);
+  //! To be called only by the owner
   thread_p pop_back();
   size_t nb_threads();
   bool empty();
@@ -377,7 +454,9 @@ public:
 
 class shared_deques_shared : public scheduler::_shared {
 protected:
+  //! `deques[id]` points to the `nb_priorities` lanes of worker `id`
   data::perworker::array<chase_lev_deque*> deques;
+  util::epoch::manager epochs;
   barrier_t creation_barrier;
 
 public:
@@ -389,15 +468,19 @@ public:
 class shared_deques_private : public scheduler::_private {
 protected:
   shared_deques_shared* _shared;
-  chase_lev_deque my_deque;
+  //! one deque per priority lane
+  chase_lev_deque my_deques[nb_priorities];
   std::vector<thread_p> my_fresh;
   bool initialized;
+  idle::waiter my_waiter;
 
   void flush();
+  thread_p pop_back();
 
 public:
   shared_deques_private(shared_deques_shared* _shared)
     : _shared(_shared),initialized(false) { }
+  ~shared_deques_private();
   void init();
   void destroy();
   void run();
@@ -405,6 +488,12 @@ public:
   void check();
   void check_on_interrupt();
   void add_to_pool_of_ready_threads(thread_p thread);
+  size_t nb_threads() {
+    size_t nb = my_fresh.size();
+    for (int p = 0; p < nb_priorities; p++)
+      nb += my_deques[p].nb_threads();
+    return nb;
+  }
 
 };
 
@@ -20,7 +20,17 @@ namespace control {
 #ifndef _PASL_CONTROL_H_
 #define _PASL_CONTROL_H_
 
+//! Default number of bytes in the call stack of a multi-shot thread
 static constexpr int thread_stack_szb = 1<<20;
+
+/*! \brief Returns the number of usable bytes in each call stack
+ *  obtained from `stack_alloc`.
+ */
+size_t stack_szb();
+//! Returns a pointer to the lowest usable byte of a fresh call stack
+char* stack_alloc();
+//! Releases a call stack obtained from `stack_alloc`
+void stack_free(char* stack);
   
 #if defined(TARGET_MAC_OS) || defined(USE_UCONTEXT)
  
@@ -65,11 +75,11 @@ public:
   
   template <class Value>
   static char* spawn(context_pointer cxt, Value val) {
-    char* stack = (char*)malloc(thread_stack_szb);
+    char* stack = stack_alloc();
     Value val2 = capture<Value>(cxt);
     cxt->ucxt.uc_link = nullptr;
     cxt->ucxt.uc_stack.ss_sp = stack;
-    cxt->ucxt.uc_stack.ss_size = thread_stack_szb;
+    cxt->ucxt.uc_stack.ss_size = stack_szb();
     auto enter_func = (void (*)(void)) val->enter;
     makecontext(&(cxt->ucxt), enter_func, 1, val);
     return stack;
@@ -123,9 +133,9 @@ public:
       target->enter(target);
       assert(false);
     }
-    char* stack = (char*)malloc(thread_stack_szb);
+    char* stack = stack_alloc();
     void** _cxt = (void**)cxt;
-    _cxt[_X86_64_SP_OFFSET] = &stack[thread_stack_szb];
+    _cxt[_X86_64_SP_OFFSET] = &stack[stack_szb()];
     return stack;
   }
   
@@ -158,6 +158,103 @@ public:
   
 };
   
+template <class Container>
+class prop_reduce_correct : public quickcheck::Property<Container> {
+public:
+  
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+  
+  bool holdsFor(const container_type& cont) {
+    value_type expected = 0;
+    cont.for_each([&] (value_type v) { expected += v; });
+    value_type result = pcontainer::reduce(cont, value_type(0), [] (value_type x, value_type y) {
+      return x + y;
+    });
+    return result == expected;
+  }
+  
+};
+  
+template <class Container>
+class prop_filter_correct : public quickcheck::Property<Container> {
+public:
+  
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+  
+  bool holdsFor(const container_type& cont) {
+    auto pred = [] (value_type v) { return v % 2 == 0; };
+    container_type expected;
+    cont.for_each([&] (value_type v) {
+      if (pred(v))
+        expected.push_back(v);
+    });
+    container_type result;
+    pcontainer::filter(cont, result, pred);
+    if (result.size() != expected.size())
+      return false;
+    for (size_type i = 0; i < expected.size(); i++)
+      if (result[i] != expected[i])
+        return false;
+    return true;
+  }
+  
+};
+  
+template <class Container>
+class prop_scan_correct : public quickcheck::Property<Container> {
+public:
+  
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+  
+  bool holdsFor(const container_type& _cont) {
+    container_type cont(_cont);
+    value_type total = pcontainer::scan(cont, value_type(0), [] (value_type x, value_type y) {
+      return x + y;
+    });
+    value_type expected = 0;
+    for (size_type i = 0; i < _cont.size(); i++) {
+      if (cont[i] != expected)
+        return false;
+      expected += _cont[i];
+    }
+    return total == expected;
+  }
+  
+};
+  
+template <class Container>
+class prop_tabulate_correct : public quickcheck::Property<Container> {
+public:
+  
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+  
+  bool holdsFor(const container_type& cont) {
+    container_type result(cont);
+    size_type n = cont.size() * 8;
+    pcontainer::tabulate(size_t(n), result, [] (size_t i) {
+      return value_type(3 * i + 1);
+    });
+    if (result.size() != cont.size() + n)
+      return false;
+    for (size_type i = 0; i < cont.size(); i++)
+      if (result[i] != cont[i])
+        return false;
+    for (size_type i = 0; i < n; i++)
+      if (result[cont.size() + i] != value_type(3 * i + 1))
+        return false;
+    return true;
+  }
+  
+};
+  
 /*---------------------------------------------------------------------*/
   
 int nb_tests;
@@ -167,6 +264,26 @@ void check_transfer_contents_to_array() {
   prop.check(nb_tests);
 }
   
+void check_reduce() {
+  prop_reduce_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+  
+void check_filter() {
+  prop_filter_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+  
+void check_scan() {
+  prop_scan_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+  
+void check_tabulate() {
+  prop_tabulate_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+  
 } // end namespace
 } // end namespace
 
@@ -183,6 +300,10 @@ int main(int argc, char ** argv) {
   auto run = [&] (bool sequential) {
     pasl::util::cmdline::argmap_dispatch c;
     c.add("transfer_contents_to_array",  [] { check_transfer_contents_to_array(); });
+    c.add("reduce",  [] { check_reduce(); });
+    c.add("filter",  [] { check_filter(); });
+    c.add("scan",  [] { check_scan(); });
+    c.add("tabulate",  [] { check_tabulate(); });
     pasl::util::cmdline::dispatch_by_argmap_with_default_all(c, "test");
   };
   auto output = [&] {